@@ -0,0 +1,76 @@
+#ifndef DOUBLEDOUBLE_H
+#define DOUBLEDOUBLE_H
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// An unevaluated sum hi + lo of two doubles, |lo| <= ulp(hi) / 2: 106 bits of
+		// mantissa from plain double arithmetic (Dekker, Knuth). It relies on every
+		// operation being rounded on its own, so no fused multiply-add contraction.
+		struct DoubleDouble
+		{
+			double hi;
+			double lo;
+
+			DoubleDouble(double value = 0.0) : hi(value), lo(0.0) {}
+			DoubleDouble(double high, double low) : hi(high), lo(low) {}
+
+			explicit operator double() const { return hi + lo; }
+
+			static DoubleDouble quickTwoSum(double a, double b)
+			{
+				const double s = a + b;
+				return { s, b - (s - a) };
+			}
+
+			static DoubleDouble twoSum(double a, double b)
+			{
+				const double s = a + b;
+				const double v = s - a;
+				return { s, (a - (s - v)) + (b - v) };
+			}
+
+			static DoubleDouble twoProduct(double a, double b)
+			{
+				// 2^27 + 1 splits a double into two halves of 26 bits.
+				constexpr double Split = 134217729.0;
+				const double p = a * b;
+				const double ta = Split * a;
+				const double ah = ta - (ta - a);
+				const double al = a - ah;
+				const double tb = Split * b;
+				const double bh = tb - (tb - b);
+				const double bl = b - bh;
+				return { p, (((ah * bh) - p) + (ah * bl) + (al * bh)) + (al * bl) };
+			}
+
+			friend DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b)
+			{
+				const DoubleDouble s = twoSum(a.hi, b.hi);
+				const DoubleDouble t = twoSum(a.lo, b.lo);
+				const DoubleDouble u = quickTwoSum(s.hi, s.lo + t.hi);
+				return quickTwoSum(u.hi, u.lo + t.lo);
+			}
+
+			friend DoubleDouble operator-(const DoubleDouble& a)
+			{
+				return { -a.hi, -a.lo };
+			}
+
+			friend DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b)
+			{
+				return a + (-b);
+			}
+
+			friend DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b)
+			{
+				const DoubleDouble p = twoProduct(a.hi, b.hi);
+				return quickTwoSum(p.hi, p.lo + ((a.hi * b.lo) + (a.lo * b.hi)));
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef ESCAPETIMEFORMULA_H
+#define ESCAPETIMEFORMULA_H
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// The maps z -> f(z) + c iterated by the escape-time kernel, written once on top of
+		// the Ops primitives of an instruction set or of plain scalar arithmetic. Every one
+		// is a type of its own, so the kernel loop is compiled and inlined for each of them
+		// instead of branching on the formula per iteration. The analytic ones also give
+		// f'(z) dz, the chain rule step of the derivative of an orbit.
+		namespace Formulas
+		{
+			struct Quadratic
+			{
+				template<class Ops, class Vector>
+				static void step(Vector a, Vector b, Vector ax, Vector ay, Vector& na, Vector& nb)
+				{
+					const Vector ab = Ops::mul(a, b);
+					na = Ops::add(Ops::sub(Ops::mul(a, a), Ops::mul(b, b)), ax);
+					nb = Ops::add(Ops::add(ab, ab), ay);
+				}
+
+				// 2 z dz
+				template<class Ops, class Vector>
+				static void derivative(Vector a, Vector b, Vector da, Vector db, Vector& nda, Vector& ndb)
+				{
+					const Vector x = Ops::sub(Ops::mul(a, da), Ops::mul(b, db));
+					const Vector y = Ops::add(Ops::mul(a, db), Ops::mul(b, da));
+					nda = Ops::add(x, x);
+					ndb = Ops::add(y, y);
+				}
+			};
+
+			// (|x| + i|y|)^2 + c
+			struct BurningShip
+			{
+				template<class Ops, class Vector>
+				static void step(Vector a, Vector b, Vector ax, Vector ay, Vector& na, Vector& nb)
+				{
+					Quadratic::step<Ops>(Ops::abs(a), Ops::abs(b), ax, ay, na, nb);
+				}
+			};
+
+			// z^Power + c, the power raised by squaring.
+			template<int Power>
+			struct Multibrot
+			{
+				static_assert(Power >= 1, "a positive power");
+
+				template<class Ops, class Vector>
+				static void power(Vector a, Vector b, Vector& ra, Vector& rb)
+				{
+					if constexpr (Power == 1) {
+						ra = a;
+						rb = b;
+					}
+					else if constexpr (Power % 2 == 0) {
+						Vector ha;
+						Vector hb;
+						Multibrot<Power / 2>::template power<Ops>(a, b, ha, hb);
+						const Vector ab = Ops::mul(ha, hb);
+						ra = Ops::sub(Ops::mul(ha, ha), Ops::mul(hb, hb));
+						rb = Ops::add(ab, ab);
+					}
+					else {
+						Vector pa;
+						Vector pb;
+						Multibrot<Power - 1>::template power<Ops>(a, b, pa, pb);
+						ra = Ops::sub(Ops::mul(pa, a), Ops::mul(pb, b));
+						rb = Ops::add(Ops::mul(pa, b), Ops::mul(pb, a));
+					}
+				}
+
+				template<class Ops, class Vector>
+				static void step(Vector a, Vector b, Vector ax, Vector ay, Vector& na, Vector& nb)
+				{
+					Vector ra;
+					Vector rb;
+					power<Ops>(a, b, ra, rb);
+					na = Ops::add(ra, ax);
+					nb = Ops::add(rb, ay);
+				}
+
+				// Power z^(Power - 1) dz
+				template<class Ops, class Vector>
+				static void derivative(Vector a, Vector b, Vector da, Vector db, Vector& nda, Vector& ndb)
+				{
+					Vector ra;
+					Vector rb;
+					Multibrot<Power - 1>::template power<Ops>(a, b, ra, rb);
+					const Vector power = Ops::set(Power);
+					nda = Ops::mul(power, Ops::sub(Ops::mul(ra, da), Ops::mul(rb, db)));
+					ndb = Ops::mul(power, Ops::add(Ops::mul(ra, db), Ops::mul(rb, da)));
+				}
+			};
+		}
+	}
+}
+
+#endif
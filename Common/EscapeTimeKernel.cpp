@@ -0,0 +1,331 @@
+#include "EscapeTimeFormula.h"
+#include "EscapeTimeKernel.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MANDELBROT_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+
+using namespace Mandelbrot::Common;
+
+#if defined(MANDELBROT_X86)
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		namespace Simd
+		{
+			// Defined in the per instruction set translation units.
+			void iterateSse2(EscapeTimeKernel::Formula formula,
+				const double* cx, const double* cy, double* zx, double* zy, double* dzx, double* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC);
+			void iterateSse2(EscapeTimeKernel::Formula formula,
+				const float* cx, const float* cy, float* zx, float* zy, float* dzx, float* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC);
+			void iterateAvx2(EscapeTimeKernel::Formula formula,
+				const double* cx, const double* cy, double* zx, double* zy, double* dzx, double* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC);
+			void iterateAvx2(EscapeTimeKernel::Formula formula,
+				const float* cx, const float* cy, float* zx, float* zy, float* dzx, float* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC);
+			void iterateAvx512(EscapeTimeKernel::Formula formula,
+				const double* cx, const double* cy, double* zx, double* zy, double* dzx, double* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC);
+			void iterateAvx512(EscapeTimeKernel::Formula formula,
+				const float* cx, const float* cy, float* zx, float* zy, float* dzx, float* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC);
+		}
+	}
+}
+#endif
+
+namespace
+{
+	// The Ops primitives of the formulas on plain arithmetic.
+	template<class Real>
+	struct ScalarOps
+	{
+		static Real add(const Real& a, const Real& b) { return a + b; }
+		static Real sub(const Real& a, const Real& b) { return a - b; }
+		static Real mul(const Real& a, const Real& b) { return a * b; }
+		static Real abs(const Real& a) { return double(a) < 0.0 ? -a : a; }
+		static Real set(double a) { return Real(a); }
+	};
+
+	template<class Real, class Formula, bool Derivative>
+	void iterateScalar(const Real* cx, const Real* cy, Real* zx, Real* zy, Real* dzx, Real* dzy,
+		int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+	{
+		const double epsilon = double(Real(periodEpsilon * periodEpsilon));
+		const Real dc = Real(fixedC ? 0.0 : 1.0);
+
+		for (int i = 0; i < count; ++i) {
+			const Real ax = cx[i];
+			const Real ay = cy[i];
+			Real a = zx[i];
+			Real b = zy[i];
+			Real da = Real(0.0);
+			Real db = Real(0.0);
+			if constexpr (Derivative) {
+				da = dzx[i];
+				db = dzy[i];
+			}
+			int numIterations = iterations[i];
+			Real sa = a;
+			Real sb = b;
+			int sinceSave = 0;
+			int interval = EscapeTimeKernel::PeriodInterval;
+
+			while (numIterations < maxIterations) {
+				++numIterations;
+				if constexpr (Derivative) {
+					Formula::template derivative<ScalarOps<Real>>(a, b, da, db, da, db);
+					da = da + dc;
+				}
+				Formula::template step<ScalarOps<Real>>(a, b, ax, ay, a, b);
+				if (EscapeTimeKernel::magnitude(a, b) > EscapeTimeKernel::Limit)
+					break;
+
+				const Real pa = a - sa;
+				const Real pb = b - sb;
+				if (EscapeTimeKernel::magnitude(pa, pb) < epsilon) {
+					numIterations = EscapeTimeKernel::Periodic;
+					break;
+				}
+				if (++sinceSave == interval) {
+					sa = a;
+					sb = b;
+					sinceSave = 0;
+					interval *= 2;
+				}
+			}
+
+			zx[i] = a;
+			zy[i] = b;
+			if constexpr (Derivative) {
+				dzx[i] = da;
+				dzy[i] = db;
+			}
+			iterations[i] = numIterations;
+		}
+	}
+
+	// The Burning Ship has no complex derivative, its orbits are iterated without.
+	template<class Real, bool Derivative>
+	void iterateScalar(EscapeTimeKernel::Formula formula, const Real* cx, const Real* cy, Real* zx, Real* zy,
+		Real* dzx, Real* dzy, int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+	{
+		typedef EscapeTimeKernel::Formula Formula;
+
+		switch (formula) {
+		case Formula::BurningShip:
+			iterateScalar<Real, Formulas::BurningShip, false>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			break;
+		case Formula::Cubic:
+			iterateScalar<Real, Formulas::Multibrot<3>, Derivative>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			break;
+		case Formula::Quartic:
+			iterateScalar<Real, Formulas::Multibrot<4>, Derivative>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			break;
+		case Formula::Quintic:
+			iterateScalar<Real, Formulas::Multibrot<5>, Derivative>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			break;
+		case Formula::Sextic:
+			iterateScalar<Real, Formulas::Multibrot<6>, Derivative>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			break;
+		default:
+			iterateScalar<Real, Formulas::Quadratic, Derivative>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			break;
+		}
+	}
+
+	// Without dzx and dzy the orbits are iterated alone.
+	template<class Real>
+	void iterateScalar(EscapeTimeKernel::Formula formula, const Real* cx, const Real* cy, Real* zx, Real* zy,
+		Real* dzx, Real* dzy, int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+	{
+		if (dzx)
+			iterateScalar<Real, true>(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+		else
+			iterateScalar<Real, false>(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+	}
+}
+
+EscapeTimeKernel::InstructionSet EscapeTimeKernel::selected = EscapeTimeKernel::detect();
+EscapeTimeKernel::Function EscapeTimeKernel::selectedFunction =
+	EscapeTimeKernel::function(EscapeTimeKernel::selected);
+EscapeTimeKernel::FloatFunction EscapeTimeKernel::selectedFloatFunction =
+	EscapeTimeKernel::floatFunction(EscapeTimeKernel::selected);
+
+void EscapeTimeKernel::iterate(Formula formula, const double* cx, const double* cy, double* zx, double* zy,
+	int* iterations, int count, int maxIterations, double periodEpsilon)
+{
+	selectedFunction(formula, cx, cy, zx, zy, nullptr, nullptr, iterations, count, maxIterations, periodEpsilon, false);
+}
+
+void EscapeTimeKernel::iterate(Formula formula, const float* cx, const float* cy, float* zx, float* zy,
+	int* iterations, int count, int maxIterations, double periodEpsilon)
+{
+	selectedFloatFunction(formula, cx, cy, zx, zy, nullptr, nullptr, iterations, count,
+		std::min(maxIterations, MaxFloatIterations), periodEpsilon, false);
+}
+
+void EscapeTimeKernel::iterate(Formula formula, const DoubleDouble* cx, const DoubleDouble* cy, DoubleDouble* zx, DoubleDouble* zy,
+	int* iterations, int count, int maxIterations, double periodEpsilon)
+{
+	iterateScalar<DoubleDouble>(formula, cx, cy, zx, zy, nullptr, nullptr, iterations, count, maxIterations, periodEpsilon, false);
+}
+
+#if defined(MANDELBROT_FLOAT128)
+void EscapeTimeKernel::iterate(Formula formula, const Float128* cx, const Float128* cy, Float128* zx, Float128* zy,
+	int* iterations, int count, int maxIterations, double periodEpsilon)
+{
+	iterateScalar<Float128>(formula, cx, cy, zx, zy, nullptr, nullptr, iterations, count, maxIterations, periodEpsilon, false);
+}
+#endif
+
+void EscapeTimeKernel::iterate(Formula formula, const double* cx, const double* cy, double* zx, double* zy,
+	double* dzx, double* dzy, int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+{
+	selectedFunction(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+}
+
+void EscapeTimeKernel::iterate(Formula formula, const float* cx, const float* cy, float* zx, float* zy,
+	float* dzx, float* dzy, int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+{
+	selectedFloatFunction(formula, cx, cy, zx, zy, dzx, dzy, iterations, count,
+		std::min(maxIterations, MaxFloatIterations), periodEpsilon, fixedC);
+}
+
+void EscapeTimeKernel::iterate(Formula formula, const DoubleDouble* cx, const DoubleDouble* cy, DoubleDouble* zx, DoubleDouble* zy,
+	DoubleDouble* dzx, DoubleDouble* dzy, int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+{
+	iterateScalar<DoubleDouble>(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+}
+
+#if defined(MANDELBROT_FLOAT128)
+void EscapeTimeKernel::iterate(Formula formula, const Float128* cx, const Float128* cy, Float128* zx, Float128* zy,
+	Float128* dzx, Float128* dzy, int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+{
+	iterateScalar<Float128>(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+}
+#endif
+
+EscapeTimeKernel::InstructionSet EscapeTimeKernel::detect()
+{
+#if defined(MANDELBROT_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	const int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	const bool sse2 = (info[3] & (1 << 26)) != 0;
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+
+	bool avx2 = false;
+	bool avx512 = false;
+	if (maxLeaf >= 7) {
+		__cpuidex(info, 7, 0);
+		avx2 = avx && (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+		avx512 = avx2 && (info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+	}
+
+	if (avx512)
+		return InstructionSet::AVX512;
+	if (avx2)
+		return InstructionSet::AVX2;
+	if (sse2)
+		return InstructionSet::SSE2;
+#elif defined(MANDELBROT_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return InstructionSet::AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return InstructionSet::AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return InstructionSet::SSE2;
+#endif
+	return InstructionSet::Scalar;
+}
+
+bool EscapeTimeKernel::setInstructionSet(InstructionSet set)
+{
+	if (int(set) > int(detect()))
+		return false;
+
+	selected = set;
+	selectedFunction = function(set);
+	selectedFloatFunction = floatFunction(set);
+	return true;
+}
+
+const char* EscapeTimeKernel::name(InstructionSet set)
+{
+	switch (set) {
+	case InstructionSet::SSE2:
+		return "SSE2";
+	case InstructionSet::AVX2:
+		return "AVX2";
+	case InstructionSet::AVX512:
+		return "AVX-512";
+	default:
+		return "scalar";
+	}
+}
+
+bool EscapeTimeKernel::fromName(const char* name, InstructionSet& set)
+{
+	if (std::strcmp(name, "scalar") == 0)
+		set = InstructionSet::Scalar;
+	else if (std::strcmp(name, "sse2") == 0)
+		set = InstructionSet::SSE2;
+	else if (std::strcmp(name, "avx2") == 0)
+		set = InstructionSet::AVX2;
+	else if (std::strcmp(name, "avx512") == 0)
+		set = InstructionSet::AVX512;
+	else
+		return false;
+
+	return true;
+}
+
+EscapeTimeKernel::Function EscapeTimeKernel::function(InstructionSet set)
+{
+#if defined(MANDELBROT_X86)
+	switch (set) {
+	case InstructionSet::SSE2:
+		return Simd::iterateSse2;
+	case InstructionSet::AVX2:
+		return Simd::iterateAvx2;
+	case InstructionSet::AVX512:
+		return Simd::iterateAvx512;
+	default:
+		break;
+	}
+#endif
+	return iterateScalar<double>;
+}
+
+EscapeTimeKernel::FloatFunction EscapeTimeKernel::floatFunction(InstructionSet set)
+{
+#if defined(MANDELBROT_X86)
+	switch (set) {
+	case InstructionSet::SSE2:
+		return Simd::iterateSse2;
+	case InstructionSet::AVX2:
+		return Simd::iterateAvx2;
+	case InstructionSet::AVX512:
+		return Simd::iterateAvx512;
+	default:
+		break;
+	}
+#endif
+	return iterateScalar<float>;
+}
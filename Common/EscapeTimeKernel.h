@@ -0,0 +1,112 @@
+#ifndef ESCAPETIMEKERNEL_H
+#define ESCAPETIMEKERNEL_H
+
+#include "DoubleDouble.h"
+
+#if defined(__SIZEOF_FLOAT128__) && (defined(__GNUC__) || defined(__clang__))
+#define MANDELBROT_FLOAT128
+#endif
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+#if defined(MANDELBROT_FLOAT128)
+		typedef __float128 Float128;
+#endif
+
+		// The escape-time iteration z = f(z) + c evaluated for a batch of pixels, z^2 + c
+		// unless another formula is asked for. An orbit is resumable: z and the iteration count are read and written back, so
+		// a later call with a higher budget continues where the previous one stopped.
+		// It comes in the numeric types of the precision tiers: float and double are
+		// vectorized, picked once per process by the detected CPU features with the scalar
+		// loop as a fallback; double-double and float128 are scalar only.
+		class EscapeTimeKernel
+		{
+		public:
+			enum class InstructionSet
+			{
+				Scalar,
+				SSE2,
+				AVX2,
+				AVX512
+			};
+
+			// f(z): z^2, the Burning Ship's (|x| + i|y|)^2 and the higher powers of z.
+			enum class Formula
+			{
+				Quadratic,
+				BurningShip,
+				Cubic,
+				Quartic,
+				Quintic,
+				Sextic
+			};
+
+			// Advances every orbit until |z| > 2 or its iteration count reaches maxIterations.
+			// The orbits passed in must not have escaped yet; a fresh Mandelbrot orbit starts
+			// at z = c with 0 iterations, a Julia one at the pixel with c fixed. An orbit has escaped on return if |z|^2 > Limit.
+			// An orbit coming back within periodEpsilon of an earlier point (Brent's cycle
+			// detection) is periodic, so inside the set; its count is set to Periodic.
+			// A zero periodEpsilon turns the detection off.
+			static void iterate(Formula formula, const double* cx, const double* cy, double* zx, double* zy,
+				int* iterations, int count, int maxIterations, double periodEpsilon);
+			static void iterate(Formula formula, const float* cx, const float* cy, float* zx, float* zy,
+				int* iterations, int count, int maxIterations, double periodEpsilon);
+			static void iterate(Formula formula, const DoubleDouble* cx, const DoubleDouble* cy, DoubleDouble* zx, DoubleDouble* zy,
+				int* iterations, int count, int maxIterations, double periodEpsilon);
+#if defined(MANDELBROT_FLOAT128)
+			static void iterate(Formula formula, const Float128* cx, const Float128* cy, Float128* zx, Float128* zy,
+				int* iterations, int count, int maxIterations, double periodEpsilon);
+#endif
+			// The same, carrying the derivative dz of every orbit along in dzx and dzy: dz/dc,
+			// dz' = f'(z) dz + 1, or with fixedC dz/dz0 of a Julia orbit, dz' = f'(z) dz. A
+			// fresh orbit starts at dz = 1. The Burning Ship has none, its dz is left as it is.
+			static void iterate(Formula formula, const double* cx, const double* cy, double* zx, double* zy,
+				double* dzx, double* dzy, int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC);
+			static void iterate(Formula formula, const float* cx, const float* cy, float* zx, float* zy,
+				float* dzx, float* dzy, int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC);
+			static void iterate(Formula formula, const DoubleDouble* cx, const DoubleDouble* cy, DoubleDouble* zx, DoubleDouble* zy,
+				DoubleDouble* dzx, DoubleDouble* dzy, int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC);
+#if defined(MANDELBROT_FLOAT128)
+			static void iterate(Formula formula, const Float128* cx, const Float128* cy, Float128* zx, Float128* zy,
+				Float128* dzx, Float128* dzy, int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC);
+#endif
+
+			// |z|^2 as compared against Limit, in the rounding of the type.
+			template<class Real>
+			static double magnitude(const Real& a, const Real& b) { return double((a * a) + (b * b)); }
+			static double magnitude(const DoubleDouble& a, const DoubleDouble& b) { return (a.hi * a.hi) + (b.hi * b.hi); }
+
+			static InstructionSet detect();
+			static InstructionSet instructionSet() { return selected; }
+			static bool setInstructionSet(InstructionSet set);
+
+			static const char* name(InstructionSet set);
+			static bool fromName(const char* name, InstructionSet& set);
+
+			static constexpr double Limit = 4.0;
+			static constexpr int Periodic = -1;
+			static constexpr int PeriodInterval = 8;
+			// The float kernel carries the counts in floats, its budget is capped here.
+			static constexpr int MaxFloatIterations = 1 << 24;
+
+		private:
+			typedef void (*Function)(Formula, const double*, const double*, double*, double*, double*, double*,
+				int*, int, int, double, bool);
+			typedef void (*FloatFunction)(Formula, const float*, const float*, float*, float*, float*, float*,
+				int*, int, int, double, bool);
+
+			static Function function(InstructionSet set);
+			static FloatFunction floatFunction(InstructionSet set);
+
+			static InstructionSet selected;
+			static Function selectedFunction;
+			static FloatFunction selectedFloatFunction;
+
+			EscapeTimeKernel() {};
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "EscapeTimeKernel.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+#include "EscapeTimeKernelSimd.h"
+
+
+namespace
+{
+	struct Ops
+	{
+		typedef double Real;
+		typedef __m512d Vector;
+		typedef __mmask8 Mask;
+
+		static constexpr int Lanes = 8;
+
+		static Vector set(double v) { return _mm512_set1_pd(v); }
+		static Vector zero() { return _mm512_setzero_pd(); }
+		static Vector load(const double* p) { return _mm512_load_pd(p); }
+		static void store(double* p, Vector v) { _mm512_store_pd(p, v); }
+
+		static Vector add(Vector a, Vector b) { return _mm512_add_pd(a, b); }
+		static Vector sub(Vector a, Vector b) { return _mm512_sub_pd(a, b); }
+		static Vector mul(Vector a, Vector b) { return _mm512_mul_pd(a, b); }
+		static Vector abs(Vector a) { return _mm512_abs_pd(a); }
+
+		static Mask all() { return 0xFF; }
+		static Mask merge(Mask a, Mask b) { return Mask(a | b); }
+		static Mask andNot(Mask m, Mask p) { return Mask(m & ~p); }
+		static bool none(Mask m) { return m == 0; }
+		static Mask less(Mask m, Vector a, Vector b) { return _mm512_mask_cmp_pd_mask(m, a, b, _CMP_LT_OQ); }
+		static Mask lessEqual(Mask m, Vector a, Vector b) { return _mm512_mask_cmp_pd_mask(m, a, b, _CMP_LE_OQ); }
+		static Vector select(Mask m, Vector a, Vector b) { return _mm512_mask_mov_pd(b, m, a); }
+		static Vector increment(Vector n, Mask m) { return _mm512_mask_add_pd(n, m, n, set(1.0)); }
+	};
+
+	struct FloatOps
+	{
+		typedef float Real;
+		typedef __m512 Vector;
+		typedef __mmask16 Mask;
+
+		static constexpr int Lanes = 16;
+
+		static Vector set(float v) { return _mm512_set1_ps(v); }
+		static Vector zero() { return _mm512_setzero_ps(); }
+		static Vector load(const float* p) { return _mm512_load_ps(p); }
+		static void store(float* p, Vector v) { _mm512_store_ps(p, v); }
+
+		static Vector add(Vector a, Vector b) { return _mm512_add_ps(a, b); }
+		static Vector sub(Vector a, Vector b) { return _mm512_sub_ps(a, b); }
+		static Vector mul(Vector a, Vector b) { return _mm512_mul_ps(a, b); }
+		static Vector abs(Vector a) { return _mm512_abs_ps(a); }
+
+		static Mask all() { return 0xFFFF; }
+		static Mask merge(Mask a, Mask b) { return Mask(a | b); }
+		static Mask andNot(Mask m, Mask p) { return Mask(m & ~p); }
+		static bool none(Mask m) { return m == 0; }
+		static Mask less(Mask m, Vector a, Vector b) { return _mm512_mask_cmp_ps_mask(m, a, b, _CMP_LT_OQ); }
+		static Mask lessEqual(Mask m, Vector a, Vector b) { return _mm512_mask_cmp_ps_mask(m, a, b, _CMP_LE_OQ); }
+		static Vector select(Mask m, Vector a, Vector b) { return _mm512_mask_mov_ps(b, m, a); }
+		static Vector increment(Vector n, Mask m) { return _mm512_mask_add_ps(n, m, n, set(1.0f)); }
+	};
+}
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		namespace Simd
+		{
+			void iterateAvx512(EscapeTimeKernel::Formula formula,
+				const double* cx, const double* cy, double* zx, double* zy, double* dzx, double* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+			{
+				dispatch<Ops>(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			}
+
+			void iterateAvx512(EscapeTimeKernel::Formula formula,
+				const float* cx, const float* cy, float* zx, float* zy, float* dzx, float* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+			{
+				dispatch<FloatOps>(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			}
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef ESCAPETIMEKERNELSIMD_H
+#define ESCAPETIMEKERNELSIMD_H
+
+#include "EscapeTimeFormula.h"
+#include "EscapeTimeKernel.h"
+#include <algorithm>
+
+// The generic vector loop of the escape-time kernel. Every instruction set has its own
+// translation unit which includes this header inside a target region, so the template
+// is compiled once per instruction set and formula on top of that unit's Ops primitives.
+// EscapeTimeKernel.h and <algorithm> must already be included before the target region
+// is opened, the formulas are compiled inside it.
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		namespace Simd
+		{
+			// With Derivative the orbit carries dz as well, dz' = f'(z) dz + dc.
+			template<class Ops, class Formula, bool Derivative>
+			struct Orbit
+			{
+				typedef typename Ops::Real Real;
+
+				typename Ops::Vector ax, ay, a, b, n, sa, sb, dza, dzb;
+				typename Ops::Mask active;
+
+				void load(const Real* bx, const Real* by, const Real* bzx, const Real* bzy,
+					const Real* bdx, const Real* bdy, const Real* bn, typename Ops::Vector limitIterations)
+				{
+					ax = Ops::load(bx);
+					ay = Ops::load(by);
+					a = Ops::load(bzx);
+					b = Ops::load(bzy);
+					if constexpr (Derivative) {
+						dza = Ops::load(bdx);
+						dzb = Ops::load(bdy);
+					}
+					n = Ops::load(bn);
+					active = Ops::less(Ops::all(), n, limitIterations);
+					save();
+				}
+
+				void save()
+				{
+					sa = a;
+					sb = b;
+				}
+
+				void step(typename Ops::Vector limit, typename Ops::Vector limitIterations,
+					typename Ops::Vector epsilon, typename Ops::Vector periodic, typename Ops::Vector dc)
+				{
+					typedef typename Ops::Vector Vector;
+					typedef typename Ops::Mask Mask;
+
+					if constexpr (Derivative) {
+						Vector nda;
+						Vector ndb;
+						Formula::template derivative<Ops>(a, b, dza, dzb, nda, ndb);
+						dza = Ops::select(active, Ops::add(nda, dc), dza);
+						dzb = Ops::select(active, ndb, dzb);
+					}
+
+					Vector na;
+					Vector nb;
+					Formula::template step<Ops>(a, b, ax, ay, na, nb);
+					a = Ops::select(active, na, a);
+					b = Ops::select(active, nb, b);
+					n = Ops::increment(n, active);
+
+					const Vector mag = Ops::add(Ops::mul(a, a), Ops::mul(b, b));
+					const Mask bounded = Ops::lessEqual(active, mag, limit);
+
+					// Back within epsilon of the saved point: the orbit is periodic.
+					const Vector da = Ops::sub(a, sa);
+					const Vector db = Ops::sub(b, sb);
+					const Mask cycle = Ops::less(bounded, Ops::add(Ops::mul(da, da), Ops::mul(db, db)), epsilon);
+					n = Ops::select(cycle, periodic, n);
+					active = Ops::less(Ops::andNot(bounded, cycle), n, limitIterations);
+				}
+			};
+
+			template<class Ops, class Formula, bool Derivative>
+			void iterate(const typename Ops::Real* cx, const typename Ops::Real* cy,
+				typename Ops::Real* zx, typename Ops::Real* zy, typename Ops::Real* dzx, typename Ops::Real* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+			{
+				typedef typename Ops::Real Real;
+
+				// Two independent lane groups are interleaved to hide the latency
+				// of the multiply chain of a single orbit.
+				constexpr int Width = 2 * Ops::Lanes;
+
+				// The iteration counts are carried in the vector type as well, floats hold
+				// them exactly up to 2^24.
+				const typename Ops::Vector limit = Ops::set(Real(EscapeTimeKernel::Limit));
+				const typename Ops::Vector limitIterations = Ops::set(Real(maxIterations));
+				const typename Ops::Vector epsilon = Ops::set(Real(periodEpsilon * periodEpsilon));
+				const typename Ops::Vector periodic = Ops::set(Real(EscapeTimeKernel::Periodic));
+				const typename Ops::Vector dc = Ops::set(Real(fixedC ? 0.0 : 1.0));
+				alignas(64) Real bx[Width];
+				alignas(64) Real by[Width];
+				alignas(64) Real bzx[Width];
+				alignas(64) Real bzy[Width];
+				alignas(64) Real bdx[Width];
+				alignas(64) Real bdy[Width];
+				alignas(64) Real bn[Width];
+
+				for (int i = 0; i < count; i += Width) {
+					// A partial group repeats its first pixel in the unused lanes so that
+					// they never keep the group alive longer than the real ones.
+					const int lanes = std::min(Width, count - i);
+					for (int k = 0; k < Width; ++k) {
+						const int j = i + (k < lanes ? k : 0);
+						bx[k] = cx[j];
+						by[k] = cy[j];
+						bzx[k] = zx[j];
+						bzy[k] = zy[j];
+						if constexpr (Derivative) {
+							bdx[k] = dzx[j];
+							bdy[k] = dzy[j];
+						}
+						bn[k] = Real(iterations[j]);
+					}
+
+					Orbit<Ops, Formula, Derivative> first;
+					Orbit<Ops, Formula, Derivative> second;
+					const int half = Ops::Lanes;
+					first.load(bx, by, bzx, bzy, bdx, bdy, bn, limitIterations);
+					second.load(bx + half, by + half, bzx + half, bzy + half, bdx + half, bdy + half, bn + half,
+						limitIterations);
+
+					// Brent: the point compared against is renewed after doubling intervals.
+					int sinceSave = 0;
+					int interval = EscapeTimeKernel::PeriodInterval;
+					while (!Ops::none(Ops::merge(first.active, second.active))) {
+						first.step(limit, limitIterations, epsilon, periodic, dc);
+						second.step(limit, limitIterations, epsilon, periodic, dc);
+						if (++sinceSave == interval) {
+							first.save();
+							second.save();
+							sinceSave = 0;
+							interval *= 2;
+						}
+					}
+
+					Ops::store(bzx, first.a);
+					Ops::store(bzx + half, second.a);
+					Ops::store(bzy, first.b);
+					Ops::store(bzy + half, second.b);
+					if constexpr (Derivative) {
+						Ops::store(bdx, first.dza);
+						Ops::store(bdx + half, second.dza);
+						Ops::store(bdy, first.dzb);
+						Ops::store(bdy + half, second.dzb);
+					}
+					Ops::store(bn, first.n);
+					Ops::store(bn + half, second.n);
+					for (int k = 0; k < lanes; ++k) {
+						zx[i + k] = bzx[k];
+						zy[i + k] = bzy[k];
+						if constexpr (Derivative) {
+							dzx[i + k] = bdx[k];
+							dzy[i + k] = bdy[k];
+						}
+						iterations[i + k] = int(bn[k]);
+					}
+				}
+			}
+
+			// The Burning Ship has no complex derivative, its orbits are iterated without.
+			template<class Ops, bool Derivative>
+			void dispatchFormula(EscapeTimeKernel::Formula formula, const typename Ops::Real* cx, const typename Ops::Real* cy,
+				typename Ops::Real* zx, typename Ops::Real* zy, typename Ops::Real* dzx, typename Ops::Real* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+			{
+				typedef EscapeTimeKernel::Formula Formula;
+
+				switch (formula) {
+				case Formula::BurningShip:
+					iterate<Ops, Formulas::BurningShip, false>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+					break;
+				case Formula::Cubic:
+					iterate<Ops, Formulas::Multibrot<3>, Derivative>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+					break;
+				case Formula::Quartic:
+					iterate<Ops, Formulas::Multibrot<4>, Derivative>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+					break;
+				case Formula::Quintic:
+					iterate<Ops, Formulas::Multibrot<5>, Derivative>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+					break;
+				case Formula::Sextic:
+					iterate<Ops, Formulas::Multibrot<6>, Derivative>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+					break;
+				default:
+					iterate<Ops, Formulas::Quadratic, Derivative>(cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+					break;
+				}
+			}
+
+			// Without dzx and dzy the orbits are iterated alone.
+			template<class Ops>
+			void dispatch(EscapeTimeKernel::Formula formula, const typename Ops::Real* cx, const typename Ops::Real* cy,
+				typename Ops::Real* zx, typename Ops::Real* zy, typename Ops::Real* dzx, typename Ops::Real* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+			{
+				if (dzx)
+					dispatchFormula<Ops, true>(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+				else
+					dispatchFormula<Ops, false>(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "EscapeTimeKernel.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+#include "EscapeTimeKernelSimd.h"
+
+
+namespace
+{
+	struct Ops
+	{
+		typedef double Real;
+		typedef __m128d Vector;
+		typedef __m128d Mask;
+
+		static constexpr int Lanes = 2;
+
+		static Vector set(double v) { return _mm_set1_pd(v); }
+		static Vector zero() { return _mm_setzero_pd(); }
+		static Vector load(const double* p) { return _mm_load_pd(p); }
+		static void store(double* p, Vector v) { _mm_store_pd(p, v); }
+
+		static Vector add(Vector a, Vector b) { return _mm_add_pd(a, b); }
+		static Vector sub(Vector a, Vector b) { return _mm_sub_pd(a, b); }
+		static Vector mul(Vector a, Vector b) { return _mm_mul_pd(a, b); }
+		static Vector abs(Vector a) { return _mm_andnot_pd(set(-0.0), a); }
+
+		static Mask all() { return _mm_castsi128_pd(_mm_set1_epi32(-1)); }
+		static Mask merge(Mask a, Mask b) { return _mm_or_pd(a, b); }
+		static Mask andNot(Mask m, Mask p) { return _mm_andnot_pd(p, m); }
+		static bool none(Mask m) { return _mm_movemask_pd(m) == 0; }
+		static Mask less(Mask m, Vector a, Vector b) { return _mm_and_pd(m, _mm_cmplt_pd(a, b)); }
+		static Mask lessEqual(Mask m, Vector a, Vector b) { return _mm_and_pd(m, _mm_cmple_pd(a, b)); }
+		static Vector select(Mask m, Vector a, Vector b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+		static Vector increment(Vector n, Mask m) { return _mm_add_pd(n, _mm_and_pd(m, set(1.0))); }
+	};
+
+	struct FloatOps
+	{
+		typedef float Real;
+		typedef __m128 Vector;
+		typedef __m128 Mask;
+
+		static constexpr int Lanes = 4;
+
+		static Vector set(float v) { return _mm_set1_ps(v); }
+		static Vector zero() { return _mm_setzero_ps(); }
+		static Vector load(const float* p) { return _mm_load_ps(p); }
+		static void store(float* p, Vector v) { _mm_store_ps(p, v); }
+
+		static Vector add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+		static Vector sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+		static Vector mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+		static Vector abs(Vector a) { return _mm_andnot_ps(set(-0.0f), a); }
+
+		static Mask all() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+		static Mask merge(Mask a, Mask b) { return _mm_or_ps(a, b); }
+		static Mask andNot(Mask m, Mask p) { return _mm_andnot_ps(p, m); }
+		static bool none(Mask m) { return _mm_movemask_ps(m) == 0; }
+		static Mask less(Mask m, Vector a, Vector b) { return _mm_and_ps(m, _mm_cmplt_ps(a, b)); }
+		static Mask lessEqual(Mask m, Vector a, Vector b) { return _mm_and_ps(m, _mm_cmple_ps(a, b)); }
+		static Vector select(Mask m, Vector a, Vector b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+		static Vector increment(Vector n, Mask m) { return _mm_add_ps(n, _mm_and_ps(m, set(1.0f))); }
+	};
+}
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		namespace Simd
+		{
+			void iterateSse2(EscapeTimeKernel::Formula formula,
+				const double* cx, const double* cy, double* zx, double* zy, double* dzx, double* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+			{
+				dispatch<Ops>(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			}
+
+			void iterateSse2(EscapeTimeKernel::Formula formula,
+				const float* cx, const float* cy, float* zx, float* zy, float* dzx, float* dzy,
+				int* iterations, int count, int maxIterations, double periodEpsilon, bool fixedC)
+			{
+				dispatch<FloatOps>(formula, cx, cy, zx, zy, dzx, dzy, iterations, count, maxIterations, periodEpsilon, fixedC);
+			}
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+#include "DoubleDouble.h"
+#include "EscapeTimeKernel.h"
+#include "ExponentialMap.h"
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
+#include "TilePool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+
+using namespace Mandelbrot::Common;
+
+namespace
+{
+	// A double-double takes the value as the double nearest to it plus the remainder.
+	template<class Real>
+	Real toReal(const FixedPoint& value)
+	{
+		const double high = value.toDouble();
+		if constexpr (std::is_same_v<Real, double>) {
+			return high;
+		}
+		else {
+			FixedPoint rest = value;
+			rest -= FixedPoint(high);
+			return Real(high) + Real(rest.toDouble());
+		}
+	}
+}
+
+ExponentialMap::ExponentialMap() :
+	m_fractal{ FrameRenderer::Family::Mandelbrot, FrameRenderer::MinPower, FrameRenderer::DefaultJuliaX, FrameRenderer::DefaultJuliaY },
+	m_formula(EscapeTimeKernel::Formula::Quadratic),
+	m_width(0),
+	m_height(0),
+	m_columns(0),
+	m_rows(0),
+	m_logRadius(0.0),
+	m_step(1.0)
+{
+}
+
+void ExponentialMap::setGeometry(const FixedPoint& centerX, const FixedPoint& centerY, double startScale, double endScale,
+	int width, int height, const FrameRenderer::Fractal& fractal)
+{
+	m_centerX = centerX;
+	m_centerY = centerY;
+	m_fractal = fractal;
+	m_formula = FrameRenderer::formula(fractal);
+	m_width = width;
+	m_height = height;
+
+	// The columns are a pixel apart on the circle through the corners, closer inside it.
+	const double twoPi = 2.0 * std::acos(-1.0);
+	const int halfWidth = width / 2;
+	const int halfHeight = height / 2;
+	const double corner = std::hypot(double(std::max(halfWidth, width - halfWidth)), double(std::max(halfHeight, height - halfHeight)));
+	m_columns = std::max(int(std::ceil(twoPi * corner)), 8);
+	m_step = twoPi / m_columns;
+	m_logRadius = std::log(0.5 * std::min(startScale, endScale));
+	const double logOuter = std::log(corner * std::max(startScale, endScale));
+	m_rows = int(std::ceil((logOuter - m_logRadius) / m_step)) + 2;
+	m_strip.assign((size_t)m_rows * m_columns, Interior);
+
+	// The centre pixel has no angle, it takes the innermost row.
+	const size_t pixels = (size_t)width * height;
+	m_pixelRows.resize(pixels);
+	m_pixelColumns.resize(pixels);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			const double dx = x - halfWidth;
+			const double dy = y - halfHeight;
+			const size_t i = ((size_t)y * width) + x;
+			const double angle = std::atan2(dy, dx);
+			m_pixelRows[i] = dx == 0.0 && dy == 0.0 ? -std::numeric_limits<float>::infinity()
+				: float(std::log(std::hypot(dx, dy)) / m_step);
+			m_pixelColumns[i] = float((angle < 0.0 ? angle + twoPi : angle) / m_step);
+		}
+	}
+}
+
+bool ExponentialMap::render(int maxIterations, const TilePool::Cancelled& cancelled)
+{
+	return TilePool::instance().run(m_rows, [this, maxIterations](int row) {
+		const double spacing = std::exp(m_logRadius + (row * m_step)) * m_step;
+		if (spacing >= FrameRenderer::DoubleScale)
+			renderRow<double>(row, maxIterations);
+		else
+			renderRow<DoubleDouble>(row, maxIterations);
+		}, cancelled);
+}
+
+void ExponentialMap::resample(double scaleFactor, float* smooth, size_t stride) const
+{
+	const double shift = (std::log(scaleFactor) - m_logRadius) / m_step;
+	for (int y = 0; y < m_height; ++y) {
+		const size_t start = (size_t)y * m_width;
+		float* line = smooth + (y * stride);
+		for (int x = 0; x < m_width; ++x)
+			line[x] = sample(std::max(double(m_pixelRows[start + x]) + shift, 0.0), m_pixelColumns[start + x]);
+	}
+}
+
+template<class Real>
+void ExponentialMap::renderRow(int row, int maxIterations)
+{
+	const double radius = std::exp(m_logRadius + (row * m_step));
+	const Real centerX = toReal<Real>(m_centerX);
+	const Real centerY = toReal<Real>(m_centerY);
+	const bool julia = m_fractal.family == FrameRenderer::Family::Julia;
+	std::vector<Real> cx(m_columns);
+	std::vector<Real> cy(m_columns);
+	std::vector<Real> zx(m_columns);
+	std::vector<Real> zy(m_columns);
+	std::vector<int> iterations(m_columns, 0);
+
+	// A Mandelbrot orbit starts at z = c, a Julia one at the sample with c fixed.
+	for (int j = 0; j < m_columns; ++j) {
+		const double angle = j * m_step;
+		zx[j] = centerX + Real(radius * std::cos(angle));
+		zy[j] = centerY + Real(radius * std::sin(angle));
+		cx[j] = julia ? Real(m_fractal.juliaX) : zx[j];
+		cy[j] = julia ? Real(m_fractal.juliaY) : zy[j];
+	}
+	EscapeTimeKernel::iterate(m_formula, cx.data(), cy.data(), zx.data(), zy.data(), iterations.data(), m_columns,
+		maxIterations, radius * m_step * FrameRenderer::PeriodTolerance);
+
+	float* line = m_strip.data() + ((size_t)row * m_columns);
+	for (int j = 0; j < m_columns; ++j) {
+		if (iterations[j] != EscapeTimeKernel::Periodic && EscapeTimeKernel::magnitude(zx[j], zy[j]) > EscapeTimeKernel::Limit)
+			line[j] = FrameRenderer::smoothCount(m_fractal, iterations[j], double(zx[j]), double(zy[j]), double(cx[j]), double(cy[j]));
+		else
+			line[j] = Interior;
+	}
+}
+
+float ExponentialMap::sample(double row, double column) const
+{
+	// Bilinear, unless one of the four samples is inside: the nearest one then.
+	const int r0 = std::min(int(row), m_rows - 2);
+	const double fr = std::min(row - r0, 1.0);
+	const double floorColumn = std::floor(column);
+	const double fc = column - floorColumn;
+	const int c0 = int(floorColumn) % m_columns;
+	const int c1 = (c0 + 1) % m_columns;
+	const float* line0 = stripLine(r0);
+	const float* line1 = stripLine(r0 + 1);
+	const float a = line0[c0];
+	const float b = line0[c1];
+	const float c = line1[c0];
+	const float d = line1[c1];
+	if (a < 0.0f || b < 0.0f || c < 0.0f || d < 0.0f) {
+		const float* line = fr < 0.5 ? line0 : line1;
+		return line[fc < 0.5 ? c0 : c1];
+	}
+
+	const double top = a + ((b - a) * fc);
+	const double bottom = c + ((d - c) * fc);
+	return float(top + ((bottom - top) * fr));
+}
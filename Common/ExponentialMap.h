@@ -0,0 +1,71 @@
+#ifndef EXPONENTIALMAP_H
+#define EXPONENTIALMAP_H
+
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
+#include "TilePool.h"
+#include <vector>
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// A zoom towards a point sampled once, in log-polar coordinates: the column of a
+		// sample is its angle around the centre and its row the logarithm of its radius, on
+		// the same step, so the samples are about square at every radius. Frames of any
+		// scale between the two ends are resampled from the strip, the rows of a deeper one
+		// are only shifted; the strip costs about as much as one frame for every halving of
+		// the scale.
+		//
+		// The strip goes from the corners of the first frame down to half a pixel of the
+		// last one, with as many columns as the corners' circle has pixels. The rows are
+		// iterated in doubles, and in double-double where doubles no longer tell their
+		// samples apart; frames past DoubleDoubleScale lose their detail.
+		class ExponentialMap
+		{
+		public:
+			ExponentialMap();
+
+			// The zoom from startScale to endScale, pixel spacings of frames of the given size.
+			void setGeometry(const FixedPoint& centerX, const FixedPoint& centerY, double startScale, double endScale,
+				int width, int height, const FrameRenderer::Fractal& fractal);
+
+			// Iterates every sample up to the budget, false when cancelled.
+			bool render(int maxIterations, const TilePool::Cancelled& cancelled);
+
+			// The continuous counts of the frame of the given pixel spacing, interpolated in the
+			// strip, Interior for the pixels inside the set, in rows of the given stride.
+			void resample(double scaleFactor, float* smooth, size_t stride) const;
+
+			int columns() const { return m_columns; }
+			int rows() const { return m_rows; }
+			const float* stripLine(int row) const { return m_strip.data() + ((size_t)row * m_columns); }
+
+			static constexpr float Interior = -1.0f;
+
+		private:
+			template<class Real>
+			void renderRow(int row, int maxIterations);
+			float sample(double row, double column) const;
+
+			FixedPoint m_centerX;
+			FixedPoint m_centerY;
+			FrameRenderer::Fractal m_fractal;
+			EscapeTimeKernel::Formula m_formula;
+			int m_width;
+			int m_height;
+			int m_columns;
+			int m_rows;
+			// The radius of row 0 and the step of the rows and columns, in radians.
+			double m_logRadius;
+			double m_step;
+			std::vector<float> m_strip;
+			// The log radius and angle of the frame's pixels at a pixel spacing of 1, in steps.
+			std::vector<float> m_pixelRows;
+			std::vector<float> m_pixelColumns;
+		};
+	}
+}
+
+#endif
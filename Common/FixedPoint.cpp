@@ -0,0 +1,336 @@
+#include "FixedPoint.h"
+#include <algorithm>
+#include <cmath>
+
+
+using namespace Mandelbrot::Common;
+
+namespace
+{
+	bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	constexpr int MaxExponent = 10000;
+}
+
+FixedPoint::FixedPoint() :
+	m_limbs(MinFractionLimbs + 1, 0),
+	m_negative(false)
+{
+}
+
+FixedPoint::FixedPoint(double value) :
+	m_limbs(MinFractionLimbs + 1, 0),
+	m_negative(false)
+{
+	if (value == 0.0 || !std::isfinite(value))
+		return;
+
+	// value = bits * 2^exponent with an integer mantissa.
+	int exponent;
+	const double mantissa = std::frexp(std::fabs(value), &exponent);
+	uint64_t bits = uint64_t(std::ldexp(mantissa, 53));
+	exponent -= 53;
+
+	const int fraction = std::clamp((-exponent + LimbBits - 1) / LimbBits, int(MinFractionLimbs), int(MaxFractionLimbs));
+	m_limbs.assign(fraction + 1, 0);
+	const int bitCount = int(m_limbs.size()) * LimbBits;
+	for (int position = exponent + (fraction * LimbBits); bits != 0; ++position, bits >>= 1) {
+		if ((bits & 1) != 0 && position >= 0 && position < bitCount)
+			m_limbs[position / LimbBits] |= uint32_t(1) << (position % LimbBits);
+	}
+	m_negative = value < 0.0 && !isZero();
+}
+
+bool FixedPoint::parse(const std::string& text, FixedPoint& value)
+{
+	size_t begin = 0;
+	size_t end = text.size();
+	while (begin < end && isSpace(text[begin]))
+		++begin;
+	while (end > begin && isSpace(text[end - 1]))
+		--end;
+
+	size_t i = begin;
+	bool negative = false;
+	if (i < end && (text[i] == '+' || text[i] == '-'))
+		negative = text[i++] == '-';
+
+	std::string digits;
+	long point = -1;
+	for (; i < end && (isDigit(text[i]) || text[i] == '.'); ++i) {
+		if (text[i] != '.')
+			digits += text[i];
+		else if (point >= 0)
+			return false;
+		else
+			point = long(digits.size());
+	}
+	if (digits.empty())
+		return false;
+	if (point < 0)
+		point = long(digits.size());
+
+	if (i < end && (text[i] == 'e' || text[i] == 'E')) {
+		++i;
+		bool negativeExponent = false;
+		if (i < end && (text[i] == '+' || text[i] == '-'))
+			negativeExponent = text[i++] == '-';
+		if (i == end)
+			return false;
+		long exponent = 0;
+		for (; i < end && isDigit(text[i]); ++i) {
+			exponent = (exponent * 10) + (text[i] - '0');
+			if (exponent > MaxExponent)
+				return false;
+		}
+		point += negativeExponent ? -exponent : exponent;
+	}
+	if (i != end)
+		return false;
+
+	std::string integer;
+	std::string fraction;
+	if (point <= 0) {
+		fraction = std::string(-point, '0') + digits;
+	}
+	else if (point >= long(digits.size())) {
+		integer = digits + std::string(point - digits.size(), '0');
+	}
+	else {
+		integer = digits.substr(0, point);
+		fraction = digits.substr(point);
+	}
+
+	integer.erase(0, std::min(integer.find_first_not_of('0'), integer.size()));
+	if (integer.size() > 10)
+		return false;
+	uint64_t integerPart = 0;
+	for (char c : integer)
+		integerPart = (integerPart * 10) + (c - '0');
+	if (integerPart > UINT32_MAX)
+		return false;
+
+	// log2(10) bits per decimal and a limb to spare for the truncation.
+	fraction.erase(fraction.find_last_not_of('0') + 1);
+	const int bits = int(std::ceil(fraction.size() * 3.3219280948873622)) + LimbBits;
+	const int limbs = std::clamp((bits + LimbBits - 1) / LimbBits, int(MinFractionLimbs), int(MaxFractionLimbs));
+	fraction.resize(std::min(fraction.size(), size_t(limbs * LimbBits * 0.30103) + 2));
+
+	// From the last decimal on: v = (v + d) / 10.
+	FixedPoint result;
+	result.m_limbs.assign(limbs + 1, 0);
+	for (auto it = fraction.rbegin(); it != fraction.rend(); ++it) {
+		result.m_limbs[limbs] = uint32_t(*it - '0');
+		uint64_t remainder = 0;
+		for (int k = limbs; k >= 0; --k) {
+			const uint64_t current = (remainder << LimbBits) | result.m_limbs[k];
+			result.m_limbs[k] = uint32_t(current / 10);
+			remainder = current % 10;
+		}
+	}
+	result.m_limbs[limbs] = uint32_t(integerPart);
+	result.m_negative = negative && !result.isZero();
+
+	value = result;
+	return true;
+}
+
+std::string FixedPoint::toString(int decimals) const
+{
+	// Every bit of the fraction is worth log10(2) decimals, the last of them is rounded.
+	const int fraction = fractionLimbs();
+	const int digits = decimals >= 0 ? decimals : int(fraction * LimbBits * 0.30103);
+
+	std::vector<uint32_t> part(m_limbs.begin(), m_limbs.end() - 1);
+	std::string text;
+	for (int d = 0; d <= digits; ++d) {
+		uint64_t carry = 0;
+		for (uint32_t& limb : part) {
+			const uint64_t product = (uint64_t(limb) * 10) + carry;
+			limb = uint32_t(product);
+			carry = product >> LimbBits;
+		}
+		text += char('0' + carry);
+	}
+
+	uint64_t integer = m_limbs.back();
+	const bool roundUp = text.back() >= '5';
+	text.pop_back();
+	if (roundUp) {
+		int d = int(text.size()) - 1;
+		for (; d >= 0 && text[d] == '9'; --d)
+			text[d] = '0';
+		if (d >= 0)
+			++text[d];
+		else
+			++integer;
+	}
+	text.erase(text.find_last_not_of('0') + 1);
+
+	std::string result = m_negative && (integer != 0 || !text.empty()) ? "-" : "";
+	result += std::to_string(integer);
+	if (!text.empty())
+		result += '.' + text;
+	return result;
+}
+
+double FixedPoint::toDouble() const
+{
+	const int fraction = fractionLimbs();
+	double result = 0.0;
+	for (int i = 0; i < int(m_limbs.size()); ++i)
+		result += std::ldexp(double(m_limbs[i]), (i - fraction) * LimbBits);
+	return m_negative ? -result : result;
+}
+
+void FixedPoint::setFractionLimbs(int limbs)
+{
+	const int fraction = fractionLimbs();
+	if (limbs > fraction)
+		m_limbs.insert(m_limbs.begin(), limbs - fraction, 0);
+	else if (limbs < fraction)
+		m_limbs.erase(m_limbs.begin(), m_limbs.begin() + (fraction - std::max(limbs, 0)));
+
+	if (isZero())
+		m_negative = false;
+}
+
+bool FixedPoint::isZero() const
+{
+	return std::all_of(m_limbs.begin(), m_limbs.end(), [](uint32_t limb) { return limb == 0; });
+}
+
+FixedPoint FixedPoint::operator-() const
+{
+	FixedPoint result(*this);
+	result.m_negative = !m_negative && !isZero();
+	return result;
+}
+
+FixedPoint& FixedPoint::operator+=(const FixedPoint& other)
+{
+	add(other, false);
+	return *this;
+}
+
+FixedPoint& FixedPoint::operator-=(const FixedPoint& other)
+{
+	add(other, true);
+	return *this;
+}
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		FixedPoint operator*(const FixedPoint& a, const FixedPoint& b)
+		{
+			const int fa = a.fractionLimbs();
+			const int fb = b.fractionLimbs();
+			const int fraction = std::max(fa, fb);
+			const size_t na = a.m_limbs.size();
+			const size_t nb = b.m_limbs.size();
+
+			std::vector<uint32_t> product(na + nb, 0);
+			for (size_t i = 0; i < na; ++i) {
+				const uint64_t ai = a.m_limbs[i];
+				if (ai == 0)
+					continue;
+				uint64_t carry = 0;
+				for (size_t j = 0; j < nb; ++j) {
+					const uint64_t t = product[i + j] + (ai * b.m_limbs[j]) + carry;
+					product[i + j] = uint32_t(t);
+					carry = t >> FixedPoint::LimbBits;
+				}
+				product[i + nb] = uint32_t(carry);
+			}
+
+			// The product has fa + fb fraction limbs, the lowest ones are dropped.
+			const size_t first = fa + fb - fraction;
+			FixedPoint result;
+			result.m_limbs.assign(product.begin() + first, product.begin() + first + fraction + 1);
+			result.m_negative = (a.m_negative != b.m_negative) && !result.isZero();
+			return result;
+		}
+	}
+}
+
+int FixedPoint::fractionLimbsFor(double step)
+{
+	if (!(step > 0.0) || step >= 1.0)
+		return MinFractionLimbs;
+
+	// 64 bits beyond the step keep the rounding of long orbits out of sight.
+	const int bits = int(std::ceil(-std::log2(step))) + 64;
+	return std::clamp((bits + LimbBits - 1) / LimbBits, int(MinFractionLimbs), int(MaxFractionLimbs));
+}
+
+int FixedPoint::decimalsFor(double step)
+{
+	if (!(step > 0.0) || step >= 1.0)
+		return 3;
+
+	return std::min(int(std::ceil(-std::log10(step))) + 3, int(MaxFractionLimbs * LimbBits * 0.30103));
+}
+
+void FixedPoint::add(const FixedPoint& other, bool negate)
+{
+	const int fraction = std::max(fractionLimbs(), other.fractionLimbs());
+	setFractionLimbs(fraction);
+
+	FixedPoint widened;
+	const FixedPoint* rhs = &other;
+	if (other.fractionLimbs() != fraction) {
+		widened = other;
+		widened.setFractionLimbs(fraction);
+		rhs = &widened;
+	}
+
+	const bool otherNegative = rhs->m_negative != negate;
+	const size_t size = m_limbs.size();
+	if (m_negative == otherNegative) {
+		uint64_t carry = 0;
+		for (size_t i = 0; i < size; ++i) {
+			const uint64_t sum = uint64_t(m_limbs[i]) + rhs->m_limbs[i] + carry;
+			m_limbs[i] = uint32_t(sum);
+			carry = sum >> LimbBits;
+		}
+	}
+	else if (compareMagnitude(*rhs) >= 0) {
+		int64_t borrow = 0;
+		for (size_t i = 0; i < size; ++i) {
+			const int64_t difference = int64_t(m_limbs[i]) - rhs->m_limbs[i] - borrow;
+			m_limbs[i] = uint32_t(difference);
+			borrow = difference < 0 ? 1 : 0;
+		}
+	}
+	else {
+		int64_t borrow = 0;
+		for (size_t i = 0; i < size; ++i) {
+			const int64_t difference = int64_t(rhs->m_limbs[i]) - m_limbs[i] - borrow;
+			m_limbs[i] = uint32_t(difference);
+			borrow = difference < 0 ? 1 : 0;
+		}
+		m_negative = otherNegative;
+	}
+
+	if (isZero())
+		m_negative = false;
+}
+
+int FixedPoint::compareMagnitude(const FixedPoint& other) const
+{
+	for (size_t i = m_limbs.size(); i-- > 0;) {
+		if (m_limbs[i] != other.m_limbs[i])
+			return m_limbs[i] < other.m_limbs[i] ? -1 : 1;
+	}
+	return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// A signed fixed-point number with a 32 bit integer part and as many 32 bit fraction
+		// limbs as the value needs. It carries the centre of a deep zoom, which must tell
+		// apart points far closer than a double can, and the reference orbit computed there.
+		// Magnitudes must stay below 2^32; a product is truncated to the wider fraction.
+		class FixedPoint
+		{
+		public:
+			FixedPoint();
+			// Exact, the fraction is widened down to the last bit of the value.
+			FixedPoint(double value);
+
+			// Decimal notation with an optional exponent, the fraction is sized to the digits.
+			static bool parse(const std::string& text, FixedPoint& value);
+			// All the digits of the fraction, or only the given number of decimals, the last one
+			// rounded half up.
+			std::string toString(int decimals = -1) const;
+			double toDouble() const;
+
+			int fractionLimbs() const { return int(m_limbs.size()) - 1; }
+			// Pads the fraction with zeros or truncates it.
+			void setFractionLimbs(int limbs);
+
+			bool isNegative() const { return m_negative; }
+			bool isZero() const;
+
+			FixedPoint operator-() const;
+			FixedPoint& operator+=(const FixedPoint& other);
+			FixedPoint& operator-=(const FixedPoint& other);
+			friend FixedPoint operator+(FixedPoint a, const FixedPoint& b) { return a += b; }
+			friend FixedPoint operator-(FixedPoint a, const FixedPoint& b) { return a -= b; }
+			friend FixedPoint operator*(const FixedPoint& a, const FixedPoint& b);
+			// Equal values, whatever their widths.
+			friend bool operator==(const FixedPoint& a, const FixedPoint& b) { return (a - b).isZero(); }
+			friend bool operator!=(const FixedPoint& a, const FixedPoint& b) { return !(a == b); }
+
+			// Enough fraction limbs to resolve steps of the given size, with some to spare.
+			static int fractionLimbsFor(double step);
+			// Enough decimals to place a point to a small part of the given step.
+			static int decimalsFor(double step);
+
+			static constexpr int LimbBits = 32;
+			static constexpr int MinFractionLimbs = 2;
+			static constexpr int MaxFractionLimbs = 128;
+
+		private:
+			void add(const FixedPoint& other, bool negate);
+			int compareMagnitude(const FixedPoint& other) const;
+
+			// The magnitude, least significant limb first; the last one is the integer part.
+			std::vector<uint32_t> m_limbs;
+			bool m_negative;
+		};
+	}
+}
+
+#endif
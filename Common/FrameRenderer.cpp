@@ -0,0 +1,1299 @@
+#include "EscapeTimeKernel.h"
+#include "FrameRenderer.h"
+#include "PerturbationKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+
+using namespace Mandelbrot::Common;
+
+namespace
+{
+	// The main cardioid and the period-2 bulb, the bulk of the interior at low zoom.
+	bool inMainBulbs(double x, double y)
+	{
+		const double y2 = y * y;
+		const double xq = x - 0.25;
+		const double q = (xq * xq) + y2;
+		if (q * (q + xq) <= 0.25 * y2)
+			return true;
+
+		const double xb = x + 1.0;
+		return (xb * xb) + y2 <= 0.0625;
+	}
+
+	// Wider types take the value as a sum of doubles, each one the remainder of the ones before.
+	template<class Real>
+	Real toReal(const FixedPoint& value)
+	{
+		if (sizeof(Real) <= sizeof(double))
+			return Real(value.toDouble());
+
+		Real result = Real(0.0);
+		FixedPoint rest = value;
+		for (int k = 0; k < 3; ++k) {
+			const double part = rest.toDouble();
+			result = result + Real(part);
+			rest -= FixedPoint(part);
+		}
+		return result;
+	}
+
+	// values[x, y] = values[x + dx, y + dy] wherever the latter is in the frame.
+	template<class T>
+	void translatePixels(std::vector<T>& values, int width, int height, int dx, int dy)
+	{
+		const int x0 = std::max(-dx, 0);
+		const int count = width - std::abs(dx);
+		// Every source row is read before it is overwritten.
+		for (int k = 0; k < height - std::abs(dy); ++k) {
+			const int y = dy >= 0 ? k : height - 1 - k;
+			T* row = values.data() + ((size_t)y * width);
+			const T* source = values.data() + ((size_t)(y + dy) * width);
+			std::memmove(row + x0, source + x0 + dx, count * sizeof(T));
+		}
+	}
+}
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		template<>
+		FrameRenderer::Plane<float>& FrameRenderer::plane<float>()
+		{
+			return m_floats;
+		}
+
+		template<>
+		FrameRenderer::Plane<double>& FrameRenderer::plane<double>()
+		{
+			return m_doubles;
+		}
+
+		template<>
+		FrameRenderer::Plane<DoubleDouble>& FrameRenderer::plane<DoubleDouble>()
+		{
+			return m_doubleDoubles;
+		}
+
+#if defined(MANDELBROT_FLOAT128)
+		template<>
+		FrameRenderer::Plane<Float128>& FrameRenderer::plane<Float128>()
+		{
+			return m_float128s;
+		}
+#endif
+	}
+}
+
+bool FrameRenderer::subdivision = true;
+bool FrameRenderer::symmetry = true;
+bool FrameRenderer::perturbation = true;
+bool FrameRenderer::distanceEstimation = false;
+
+FrameRenderer::FrameRenderer() :
+	m_geometry{ 0.0, 0.0, 0.0, 0, 0 },
+	m_fractal{ Family::Mandelbrot, MinPower, DefaultJuliaX, DefaultJuliaY },
+	m_formula(EscapeTimeKernel::Formula::Quadratic),
+	m_tilesX(0),
+	m_tilesY(0),
+	m_precision(Precision::Double),
+	m_samplesPerPixel(0),
+	m_estimateDistance(false),
+	m_power(2),
+	m_periodEpsilon(0.0),
+	m_fractionLimbs(FixedPoint::MinFractionLimbs),
+	m_rebaseAtEnd(false),
+	m_glitchedPixels(0),
+	m_iteratedPixels(0),
+	m_filledPixels(0),
+	m_changedPixels(0)
+{
+}
+
+void FrameRenderer::setGeometry(const Geometry& geometry, const Fractal& fractal)
+{
+	int dx = 0;
+	int dy = 0;
+	const bool translated = isTranslation(geometry, fractal, dx, dy);
+
+	m_geometry = geometry;
+	m_fractal = fractal;
+	m_formula = formula(fractal);
+	m_power = fractal.family == Family::Multibrot ? std::clamp(fractal.power, MinPower, MaxPower) : 2;
+	m_tilesX = (geometry.width + TileSize - 1) / TileSize;
+	m_tilesY = (geometry.height + TileSize - 1) / TileSize;
+	m_tiles.assign((size_t)m_tilesX * m_tilesY, Tile{ false, 0, 0, 0 });
+	std::vector<int> mirror(geometry.height, -1);
+	m_mirror.swap(mirror);
+	m_references.clear();
+
+	const Precision previous = m_precision;
+	m_precision = precisionFor(geometry.scaleFactor, fractal.family);
+	m_periodEpsilon = geometry.scaleFactor * PeriodTolerance;
+	m_estimateDistance = distanceEstimation && fractal.family != Family::BurningShip;
+	clearSamples();
+	if (translated) {
+		// A frame panned after its float previews goes on in double.
+		m_precision = previous;
+		if (translate(dx, dy, mirror))
+			return;
+		m_precision = precisionFor(geometry.scaleFactor, fractal.family);
+	}
+
+	reset();
+}
+
+void FrameRenderer::reset()
+{
+	// Only the plane of the frame's tier is kept.
+	m_floats = Plane<float>();
+	m_doubles = Plane<double>();
+	m_doubleDoubles = Plane<DoubleDouble>();
+#if defined(MANDELBROT_FLOAT128)
+	m_float128s = Plane<Float128>();
+#endif
+	switch (m_precision) {
+	case Precision::Float:
+		setCoordinates<float>();
+		break;
+	case Precision::DoubleDouble:
+		setCoordinates<DoubleDouble>();
+		break;
+#if defined(MANDELBROT_FLOAT128)
+	case Precision::Float128:
+		setCoordinates<Float128>();
+		break;
+#endif
+	case Precision::Perturbation:
+		setOffsets();
+		break;
+	default:
+		setCoordinates<double>();
+		break;
+	}
+
+	// The orbits themselves are set up by the first pass over each tile, in parallel.
+	const size_t pixels = (size_t)m_geometry.width * m_geometry.height;
+	m_iterations.resize(pixels);
+	m_index.resize(m_references.empty() ? 0 : pixels);
+	m_reference.resize(m_references.empty() ? 0 : pixels);
+	m_state.assign(pixels, Fresh);
+	// No pass has changed anything yet.
+	m_result.assign(pixels, Interior);
+	m_smooth.resize(pixels);
+	m_distance.assign(m_estimateDistance ? pixels : 0, Interior);
+}
+
+bool FrameRenderer::isTranslation(const Geometry& geometry, const Fractal& fractal, int& dx, int& dy) const
+{
+	if (m_tiles.empty() || !(fractal == m_fractal) || geometry.width != m_geometry.width
+		|| geometry.height != m_geometry.height || geometry.scaleFactor != m_geometry.scaleFactor
+		|| (distanceEstimation && fractal.family != Family::BurningShip) != m_estimateDistance)
+		return false;
+
+	// The orbits of a deep zoom are relative to references at the old centre.
+	const Precision precision = precisionFor(geometry.scaleFactor, fractal.family);
+	const bool previewed = precision == Precision::Float && m_precision == Precision::Double;
+	if ((precision != m_precision && !previewed) || precision == Precision::Perturbation)
+		return false;
+
+	const double x = (geometry.centerX - m_geometry.centerX).toDouble() / geometry.scaleFactor;
+	const double y = (geometry.centerY - m_geometry.centerY).toDouble() / geometry.scaleFactor;
+	if (!(std::fabs(x) < geometry.width) || !(std::fabs(y) < geometry.height))
+		return false;
+
+	dx = int(std::lround(x));
+	dy = int(std::lround(y));
+	return std::fabs(x - dx) <= TranslationTolerance && std::fabs(y - dy) <= TranslationTolerance;
+}
+
+bool FrameRenderer::translate(int dx, int dy, const std::vector<int>& mirror)
+{
+	switch (m_precision) {
+	case Precision::Float:
+		return translate<float>(dx, dy, mirror);
+	case Precision::DoubleDouble:
+		return translate<DoubleDouble>(dx, dy, mirror);
+#if defined(MANDELBROT_FLOAT128)
+	case Precision::Float128:
+		return translate<Float128>(dx, dy, mirror);
+#endif
+	case Precision::Double:
+		return translate<double>(dx, dy, mirror);
+	default:
+		return false;
+	}
+}
+
+template<class Real>
+bool FrameRenderer::translate(int dx, int dy, const std::vector<int>& mirror)
+{
+	Plane<Real>& plane = this->plane<Real>();
+	const std::vector<Real> previousX = std::move(plane.cx);
+	const std::vector<Real> previousY = std::move(plane.cy);
+	setCoordinates<Real>();
+
+	// Snapping the rows to the real axis, or no longer, moves them by up to half a pixel.
+	const int width = m_geometry.width;
+	const int height = m_geometry.height;
+	const double tolerance = m_geometry.scaleFactor * TranslationTolerance;
+	for (int x = std::max(-dx, 0); x < std::min(width, width - dx); ++x) {
+		if (std::fabs(double(plane.cx[x] - previousX[x + dx])) > tolerance)
+			return false;
+	}
+	for (int y = std::max(-dy, 0); y < std::min(height, height - dy); ++y) {
+		if (std::fabs(double(plane.cy[y] - previousY[y + dy])) > tolerance)
+			return false;
+	}
+
+	// The pixels kept go on with exactly the c of their orbits.
+	for (int x = std::max(-dx, 0); x < std::min(width, width - dx); ++x)
+		plane.cx[x] = previousX[x + dx];
+	for (int y = std::max(-dy, 0); y < std::min(height, height - dy); ++y)
+		plane.cy[y] = previousY[y + dy];
+
+	// The rows mirrored so far were never iterated, they take the conjugate orbits.
+	for (int y = 0; y < height; ++y) {
+		if (mirror[y] < 0)
+			continue;
+		for (int x = 0; x < width; ++x) {
+			const size_t i = offset(x, y);
+			const size_t source = offset(x, mirror[y]);
+			if (m_state[i] == Fresh) {
+				plane.zx[i] = plane.zx[source];
+				plane.zy[i] = -plane.zy[source];
+				if (m_estimateDistance) {
+					plane.dzx[i] = plane.dzx[source];
+					plane.dzy[i] = -plane.dzy[source];
+				}
+				m_iterations[i] = m_iterations[source];
+				m_state[i] = m_state[source];
+			}
+		}
+	}
+
+	translatePixels(plane.zx, width, height, dx, dy);
+	translatePixels(plane.zy, width, height, dx, dy);
+	translatePixels(m_iterations, width, height, dx, dy);
+	translatePixels(m_state, width, height, dx, dy);
+	translatePixels(m_result, width, height, dx, dy);
+	translatePixels(m_smooth, width, height, dx, dy);
+	if (m_estimateDistance) {
+		translatePixels(plane.dzx, width, height, dx, dy);
+		translatePixels(plane.dzy, width, height, dx, dy);
+		translatePixels(m_distance, width, height, dx, dy);
+	}
+
+	// The exposed strips are set up by the next pass, as in a new frame.
+	for (int y = 0; y < height; ++y) {
+		const bool exposed = y + dy < 0 || y + dy >= height;
+		for (int x = 0; x < width; ++x) {
+			if (exposed || x + dx < 0 || x + dx >= width) {
+				const size_t i = offset(x, y);
+				m_state[i] = Fresh;
+				m_result[i] = Interior;
+				m_smooth[i] = Interior;
+				if (m_estimateDistance)
+					m_distance[i] = Interior;
+			}
+		}
+	}
+	return true;
+}
+
+template<class Real>
+void FrameRenderer::setCoordinates()
+{
+	const Geometry& geometry = m_geometry;
+	const int halfWidth = geometry.width / 2;
+	const int halfHeight = geometry.height / 2;
+	const Real scaleFactor = Real(geometry.scaleFactor);
+	const Real centerX = toReal<Real>(geometry.centerX);
+	const Real centerY = toReal<Real>(geometry.centerY);
+	Plane<Real>& plane = this->plane<Real>();
+	plane.cx.resize(geometry.width);
+	plane.cy.resize(geometry.height);
+
+	for (int x = 0; x < geometry.width; ++x)
+		plane.cx[x] = centerX + Real((x - halfWidth) * geometry.scaleFactor);
+
+	const double axis = halfHeight - (geometry.centerY.toDouble() / geometry.scaleFactor);
+	if (symmetry && isConjugateSymmetric(m_fractal) && axis >= 0.0 && axis <= geometry.height - 1) {
+		// With the axis on a row or halfway between two, rows y and 2 * axis - y are
+		// exact conjugates.
+		const double snapped = std::round(2.0 * axis) / 2.0;
+		const int sum = int(2.0 * snapped);
+		const bool mirrorUpper = snapped < (geometry.height - 1) / 2.0;
+		for (int y = 0; y < geometry.height; ++y) {
+			plane.cy[y] = Real(y - snapped) * scaleFactor;
+			const int source = sum - y;
+			if (source != y && source >= 0 && source < geometry.height && ((2 * y < sum) == mirrorUpper))
+				m_mirror[y] = source;
+		}
+	}
+	else {
+		for (int y = 0; y < geometry.height; ++y)
+			plane.cy[y] = centerY + Real((y - halfHeight) * geometry.scaleFactor);
+	}
+
+	const size_t pixels = (size_t)geometry.width * geometry.height;
+	plane.zx.resize(pixels);
+	plane.zy.resize(pixels);
+	plane.dzx.resize(m_estimateDistance ? pixels : 0);
+	plane.dzy.resize(m_estimateDistance ? pixels : 0);
+}
+
+void FrameRenderer::setOffsets()
+{
+	// Offsets from the centre, which is the first reference.
+	const Geometry& geometry = m_geometry;
+	const int halfWidth = geometry.width / 2;
+	const int halfHeight = geometry.height / 2;
+	m_doubles.cx.resize(geometry.width);
+	m_doubles.cy.resize(geometry.height);
+	for (int x = 0; x < geometry.width; ++x)
+		m_doubles.cx[x] = (x - halfWidth) * geometry.scaleFactor;
+	for (int y = 0; y < geometry.height; ++y)
+		m_doubles.cy[y] = (y - halfHeight) * geometry.scaleFactor;
+
+	const size_t pixels = (size_t)geometry.width * geometry.height;
+	m_doubles.zx.resize(pixels);
+	m_doubles.zy.resize(pixels);
+	m_doubles.dzx.resize(m_estimateDistance ? pixels : 0);
+	m_doubles.dzy.resize(m_estimateDistance ? pixels : 0);
+
+	m_fractionLimbs = std::max({ FixedPoint::fractionLimbsFor(geometry.scaleFactor),
+		geometry.centerX.fractionLimbs(), geometry.centerY.fractionLimbs() });
+	m_references.resize(1);
+	m_references[0].orbit.reset(geometry.centerX, geometry.centerY, m_fractionLimbs);
+	m_references[0].offsetX = 0.0;
+	m_references[0].offsetY = 0.0;
+}
+
+FrameRenderer::Precision FrameRenderer::precisionFor(double scaleFactor, Family family)
+{
+	if (scaleFactor >= FloatScale)
+		return Precision::Float;
+	if (scaleFactor >= DoubleScale)
+		return Precision::Double;
+	if (perturbation && family == Family::Mandelbrot)
+		return Precision::Perturbation;
+	if (scaleFactor >= DoubleDoubleScale)
+		return Precision::DoubleDouble;
+
+	// Perturbation is for the Mandelbrot set only, the others go on in the widest type.
+#if defined(MANDELBROT_FLOAT128)
+	if (scaleFactor >= Float128Scale || family != Family::Mandelbrot)
+		return Precision::Float128;
+#else
+	if (family != Family::Mandelbrot)
+		return Precision::DoubleDouble;
+#endif
+	return Precision::Perturbation;
+}
+
+const char* FrameRenderer::name(Precision precision)
+{
+	switch (precision) {
+	case Precision::Float:
+		return "float";
+	case Precision::DoubleDouble:
+		return "double-double";
+	case Precision::Float128:
+		return "float128";
+	case Precision::Perturbation:
+		return "perturbation";
+	default:
+		return "double";
+	}
+}
+
+const char* FrameRenderer::name(Family family)
+{
+	switch (family) {
+	case Family::Julia:
+		return "julia";
+	case Family::BurningShip:
+		return "burningship";
+	case Family::Multibrot:
+		return "multibrot";
+	default:
+		return "mandelbrot";
+	}
+}
+
+bool FrameRenderer::fromName(const char* name, Family& family)
+{
+	if (std::strcmp(name, "mandelbrot") == 0)
+		family = Family::Mandelbrot;
+	else if (std::strcmp(name, "julia") == 0)
+		family = Family::Julia;
+	else if (std::strcmp(name, "burningship") == 0)
+		family = Family::BurningShip;
+	else if (std::strcmp(name, "multibrot") == 0)
+		family = Family::Multibrot;
+	else
+		return false;
+
+	return true;
+}
+
+EscapeTimeKernel::Formula FrameRenderer::formula(const Fractal& fractal)
+{
+	switch (fractal.family) {
+	case Family::BurningShip:
+		return EscapeTimeKernel::Formula::BurningShip;
+	case Family::Multibrot:
+		switch (std::clamp(fractal.power, MinPower, MaxPower)) {
+		case 3:
+			return EscapeTimeKernel::Formula::Cubic;
+		case 4:
+			return EscapeTimeKernel::Formula::Quartic;
+		case 5:
+			return EscapeTimeKernel::Formula::Quintic;
+		default:
+			return EscapeTimeKernel::Formula::Sextic;
+		}
+	default:
+		return EscapeTimeKernel::Formula::Quadratic;
+	}
+}
+
+bool FrameRenderer::isConjugateSymmetric(const Fractal& fractal)
+{
+	// |y| breaks it for the Burning Ship, a complex c for a Julia set.
+	switch (fractal.family) {
+	case Family::BurningShip:
+		return false;
+	case Family::Julia:
+		return fractal.juliaY == 0.0;
+	default:
+		return true;
+	}
+}
+
+float FrameRenderer::smoothCount(const Fractal& fractal, int iterations, double zx, double zy, double cx, double cy)
+{
+	const int power = fractal.family == Family::Multibrot ? std::clamp(fractal.power, MinPower, MaxPower) : 2;
+
+	// Far beyond the escape radius log2 |z| is raised to the power d by every step, the
+	// few steps past it make the count continuous across the bands.
+	for (int k = 0; k < SmoothSteps; ++k) {
+		if (fractal.family == Family::BurningShip) {
+			zx = std::fabs(zx);
+			zy = std::fabs(zy);
+		}
+		double px = zx;
+		double py = zy;
+		for (int p = 1; p < power; ++p) {
+			const double t = (px * zx) - (py * zy);
+			py = (px * zy) + (py * zx);
+			px = t;
+		}
+		zx = px + cx;
+		zy = py + cy;
+	}
+
+	const double log2Radius = 0.5 * std::log2((zx * zx) + (zy * zy));
+	return float(std::max(iterations + SmoothSteps + 1 - (std::log2(log2Radius) / std::log2(double(power))), 0.0));
+}
+
+float FrameRenderer::distanceEstimate(int iterations, double zx, double zy, double dzx, double dzy,
+	double cx, double cy) const
+{
+	// Carried on until z^(1 / d^n) is close to the Böttcher coordinate it tends to, with
+	// dz' = d z^(d-1) dz + 1, a Julia set's without the 1.
+	const double dc = m_fractal.family == Family::Julia ? 0.0 : 1.0;
+	int steps = 0;
+	for (; steps < MaxDistanceSteps && (zx * zx) + (zy * zy) < DistanceLimit; ++steps) {
+		double px = 1.0;
+		double py = 0.0;
+		for (int p = 1; p < m_power; ++p) {
+			const double t = (px * zx) - (py * zy);
+			py = (px * zy) + (py * zx);
+			px = t;
+		}
+		const double dx = (m_power * ((px * dzx) - (py * dzy))) + dc;
+		dzy = m_power * ((px * dzy) + (py * dzx));
+		dzx = dx;
+		const double t = (px * zx) - (py * zy) + cx;
+		zy = (px * zy) + (py * zx) + cy;
+		zx = t;
+	}
+
+	// A derivative beyond the type is of a pixel on the set for all it can tell.
+	const double radius = std::hypot(zx, zy);
+	const double derivative = std::hypot(dzx, dzy);
+	if (!std::isfinite(derivative) || !(derivative > 0.0))
+		return 0.0f;
+
+	// With G = log |z| / d^n and |G'| = |dz| / (|z| d^n) the distance is at least
+	// sinh(G) / (2 e^G |G'|), which tends to log |z| |z| / (2 |dz|) close to the set.
+	const double log = std::log(radius);
+	const double power = std::pow(double(m_power), iterations + steps);
+	const double bound = power < 1e12 ? -0.25 * std::expm1(-2.0 * log / power) * power : 0.5 * log;
+	return float(bound * radius / derivative / m_geometry.scaleFactor);
+}
+
+void FrameRenderer::fillSmooth(std::vector<float>& values, int x0, int y0, int width, int height)
+{
+	// The mean of the linear interpolations between opposite sides.
+	const int x1 = x0 + width - 1;
+	const int y1 = y0 + height - 1;
+	for (int y = y0 + 1; y < y1; ++y) {
+		const float ty = float(y - y0) / (height - 1);
+		const float left = values[offset(x0, y)];
+		const float right = values[offset(x1, y)];
+		for (int x = x0 + 1; x < x1; ++x) {
+			const float tx = float(x - x0) / (width - 1);
+			const float top = values[offset(x, y0)];
+			const float bottom = values[offset(x, y1)];
+			const float across = left + ((right - left) * tx);
+			const float down = top + ((bottom - top) * ty);
+			values[offset(x, y)] = 0.5f * (across + down);
+		}
+	}
+}
+
+bool FrameRenderer::isFarFromSet(int x0, int y0, int width, int height) const
+{
+	// The disks free of the set around the escaped border cover the inside.
+	const float distance = FillDistance * std::max(width, height);
+	const auto far = [this, distance](int x, int y) {
+		const size_t i = offset(x, y);
+		return m_result[i] >= 0 && m_distance[i] >= distance;
+	};
+	const int x1 = x0 + width - 1;
+	const int y1 = y0 + height - 1;
+	for (int x = x0; x <= x1; ++x) {
+		if (!far(x, y0) || !far(x, y1))
+			return false;
+	}
+	for (int y = y0 + 1; y < y1; ++y) {
+		if (!far(x0, y) || !far(x1, y))
+			return false;
+	}
+	return true;
+}
+
+bool FrameRenderer::renderPass(int maxIterations, const TilePool::Cancelled& cancelled, bool boundaryOnly)
+{
+	// The float passes only preview the frame, the first pass past them starts it over in double.
+	if (m_precision == Precision::Float && maxIterations > FloatIterations) {
+		m_precision = Precision::Double;
+		m_tiles.assign(m_tiles.size(), Tile{ false, 0, 0, 0 });
+		m_mirror.assign(m_geometry.height, -1);
+		reset();
+	}
+
+	m_iteratedPixels = 0;
+	m_filledPixels = 0;
+	for (Tile& tile : m_tiles)
+		tile.changed = 0;
+	clearSamples();
+	m_boundary.clear();
+	if (boundaryOnly) {
+		// Nothing has escaped yet, there is no boundary to go by.
+		m_boundary.resize(m_tiles.size());
+		for (int i = 0; i < int(m_tiles.size()); ++i)
+			m_boundary[i] = isNearBoundary(i);
+		if (std::find(m_boundary.begin(), m_boundary.end(), 1) == m_boundary.end())
+			m_boundary.clear();
+	}
+
+	for (;;) {
+		for (Reference& reference : m_references)
+			reference.orbit.extend(maxIterations);
+		m_rebaseAtEnd = int(m_references.size()) >= MaxReferences;
+		m_glitchedPixels = 0;
+
+		bool finished;
+		switch (m_precision) {
+		case Precision::Float:
+			finished = renderTiles<float>(maxIterations, cancelled);
+			break;
+		case Precision::DoubleDouble:
+			finished = renderTiles<DoubleDouble>(maxIterations, cancelled);
+			break;
+#if defined(MANDELBROT_FLOAT128)
+		case Precision::Float128:
+			finished = renderTiles<Float128>(maxIterations, cancelled);
+			break;
+#endif
+		default:
+			finished = renderTiles<double>(maxIterations, cancelled);
+			break;
+		}
+		if (!finished)
+			return false;
+
+		if (m_glitchedPixels == 0)
+			break;
+		addReference();
+	}
+
+	m_changedPixels = 0;
+	for (const Tile& tile : m_tiles)
+		m_changedPixels += tile.changed;
+	mirrorRows();
+	return true;
+}
+
+bool FrameRenderer::antialias(int maxSamples, int maxIterations, const TilePool::Cancelled& cancelled)
+{
+	clearSamples();
+	const int grid = int(std::sqrt(double(std::min(maxSamples, MaxSamples))));
+	if (grid < 2)
+		return true;
+
+	const int width = m_geometry.width;
+	const int height = m_geometry.height;
+	m_sampledRows.resize(height + 1);
+	for (int y = 0; y < height; ++y) {
+		m_sampledRows[y] = int(m_sampledX.size());
+		for (int x = 0; x < width; ++x) {
+			// Nothing of the set in the pixel, it only crosses bands.
+			if (m_estimateDistance && m_distance[offset(x, y)] >= ClearDistance)
+				continue;
+			if (isEdge(x, y)) {
+				m_sampledX.push_back(x);
+				m_sampledY.push_back(y);
+			}
+		}
+	}
+	m_sampledRows[height] = int(m_sampledX.size());
+	m_samplesPerPixel = grid * grid;
+	m_samples.resize(m_sampledX.size() * m_samplesPerPixel);
+	m_sampleDistances.resize(m_estimateDistance ? m_samples.size() : 0);
+
+	bool finished;
+	switch (m_precision) {
+	case Precision::Float:
+		finished = sample<float>(grid, maxIterations, cancelled);
+		break;
+	case Precision::DoubleDouble:
+		finished = sample<DoubleDouble>(grid, maxIterations, cancelled);
+		break;
+#if defined(MANDELBROT_FLOAT128)
+	case Precision::Float128:
+		finished = sample<Float128>(grid, maxIterations, cancelled);
+		break;
+#endif
+	default:
+		finished = sample<double>(grid, maxIterations, cancelled);
+		break;
+	}
+	if (!finished)
+		clearSamples();
+	return finished;
+}
+
+int FrameRenderer::sampledPixels(int y, const int*& x, const float*& samples, const float*& distances) const
+{
+	if (m_sampledRows.empty())
+		return 0;
+
+	const int first = m_sampledRows[y];
+	x = m_sampledX.data() + first;
+	samples = m_samples.data() + ((size_t)first * m_samplesPerPixel);
+	distances = m_sampleDistances.empty() ? nullptr : m_sampleDistances.data() + ((size_t)first * m_samplesPerPixel);
+	return m_sampledRows[y + 1] - first;
+}
+
+int FrameRenderer::estimateIterations(int maxIterations, double tolerance) const
+{
+	// The escapes of every octave of the budget are taken to decay geometrically.
+	long long last = 0;
+	long long previous = 0;
+	for (int result : m_result) {
+		if (result > maxIterations / 2)
+			++last;
+		else if (result > maxIterations / 4)
+			++previous;
+	}
+
+	// Without a single escape the frame tells nothing yet.
+	if (std::none_of(m_tiles.begin(), m_tiles.end(), [](const Tile& tile) { return tile.escaped > 0; }))
+		return MaxEstimatedIterations;
+	const double remaining = tolerance * double(m_result.size());
+	if (last <= remaining)
+		return maxIterations;
+	const double decay = previous > last ? double(last) / previous : 0.9;
+	const double octaves = std::ceil(std::log(remaining / last) / std::log(decay));
+	return int(std::min(maxIterations * std::exp2(octaves), double(MaxEstimatedIterations)));
+}
+
+bool FrameRenderer::isNearBoundary(int tile) const
+{
+	const int tileX = tile % m_tilesX;
+	const int tileY = tile / m_tilesX;
+	for (int y = std::max(tileY - 1, 0); y <= std::min(tileY + 1, m_tilesY - 1); ++y) {
+		for (int x = std::max(tileX - 1, 0); x <= std::min(tileX + 1, m_tilesX - 1); ++x) {
+			if (m_tiles[(size_t)y * m_tilesX + x].escaped > 0)
+				return true;
+		}
+	}
+	return false;
+}
+
+bool FrameRenderer::isEdge(int x, int y) const
+{
+	// Interior next to escaped, or bands too narrow for the pixel.
+	const float value = m_smooth[offset(x, y)];
+	const auto differs = [this, value](int nx, int ny) {
+		const float other = m_smooth[offset(nx, ny)];
+		return (value < 0.0f) != (other < 0.0f) || std::fabs(value - other) > EdgeContrast;
+	};
+	return (x > 0 && differs(x - 1, y)) || (x + 1 < m_geometry.width && differs(x + 1, y))
+		|| (y > 0 && differs(x, y - 1)) || (y + 1 < m_geometry.height && differs(x, y + 1));
+}
+
+void FrameRenderer::clearSamples()
+{
+	m_sampledX.clear();
+	m_sampledY.clear();
+	m_sampledRows.clear();
+	m_samples.clear();
+	m_sampleDistances.clear();
+	m_samplesPerPixel = 0;
+}
+
+void FrameRenderer::setResult(Tile& tile, size_t i, int value)
+{
+	if (m_result[i] != value) {
+		m_result[i] = value;
+		++tile.changed;
+	}
+}
+
+bool FrameRenderer::isMirrored(int y0, int height) const
+{
+	for (int y = y0; y < y0 + height; ++y) {
+		if (m_mirror[y] < 0)
+			return false;
+	}
+	return true;
+}
+
+void FrameRenderer::mirrorRows()
+{
+	const int width = m_geometry.width;
+	for (int y = 0; y < m_geometry.height; ++y) {
+		if (m_mirror[y] >= 0) {
+			const int* row = m_result.data() + offset(0, y);
+			const int* source = m_result.data() + offset(0, m_mirror[y]);
+			for (int x = 0; x < width; ++x)
+				m_changedPixels += row[x] != source[x];
+			std::memcpy(m_result.data() + offset(0, y), m_result.data() + offset(0, m_mirror[y]),
+				width * sizeof(int));
+			std::memcpy(m_smooth.data() + offset(0, y), m_smooth.data() + offset(0, m_mirror[y]),
+				width * sizeof(float));
+			if (m_estimateDistance) {
+				std::memcpy(m_distance.data() + offset(0, y), m_distance.data() + offset(0, m_mirror[y]),
+					width * sizeof(float));
+			}
+			m_filledPixels += width;
+		}
+	}
+}
+
+void FrameRenderer::addReference()
+{
+	// The glitched pixel nearest to the centroid of them all.
+	const int width = m_geometry.width;
+	const int height = m_geometry.height;
+	double sumX = 0.0;
+	double sumY = 0.0;
+	long long count = 0;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			if (m_index[offset(x, y)] == PerturbationKernel::Glitched) {
+				sumX += x;
+				sumY += y;
+				++count;
+			}
+		}
+	}
+
+	const double meanX = sumX / count;
+	const double meanY = sumY / count;
+	int bestX = 0;
+	int bestY = 0;
+	double bestDistance = -1.0;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			if (m_index[offset(x, y)] != PerturbationKernel::Glitched)
+				continue;
+			const double distance = ((x - meanX) * (x - meanX)) + ((y - meanY) * (y - meanY));
+			if (bestDistance < 0.0 || distance < bestDistance) {
+				bestDistance = distance;
+				bestX = x;
+				bestY = y;
+			}
+		}
+	}
+
+	Reference reference;
+	reference.offsetX = m_doubles.cx[bestX];
+	reference.offsetY = m_doubles.cy[bestY];
+	reference.orbit.reset(m_geometry.centerX + FixedPoint(reference.offsetX),
+		m_geometry.centerY + FixedPoint(reference.offsetY), m_fractionLimbs);
+	const unsigned char id = (unsigned char)m_references.size();
+	m_references.push_back(reference);
+
+	// Glitched orbits start over relative to the new reference.
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			const size_t i = offset(x, y);
+			if (m_index[i] == PerturbationKernel::Glitched) {
+				m_doubles.zx[i] = m_doubles.cx[x] - reference.offsetX;
+				m_doubles.zy[i] = m_doubles.cy[y] - reference.offsetY;
+				if (m_estimateDistance) {
+					m_doubles.dzx[i] = 1.0;
+					m_doubles.dzy[i] = 0.0;
+				}
+				m_iterations[i] = 0;
+				m_index[i] = 1;
+				m_reference[i] = id;
+			}
+		}
+	}
+}
+
+template<class Real>
+bool FrameRenderer::sample(int grid, int maxIterations, const TilePool::Cancelled& cancelled)
+{
+	// As many whole pixels as a batch holds, each on a grid of points centred in it.
+	const int samples = grid * grid;
+	const int pixels = int(m_sampledX.size());
+	const int perBatch = Batch<Real>::Capacity / samples;
+	const double step = m_geometry.scaleFactor / grid;
+	const double start = 0.5 * (step - m_geometry.scaleFactor);
+	return TilePool::instance().run((pixels + perBatch - 1) / perBatch,
+		[this, grid, samples, pixels, perBatch, step, start, maxIterations](int task) {
+		const Plane<Real>& plane = this->plane<Real>();
+		const int first = task * perBatch;
+		const int last = std::min(pixels, first + perBatch);
+		Batch<Real> batch;
+		batch.count = 0;
+		batch.reference = 0;
+		for (int p = first; p < last; ++p) {
+			for (int j = 0; j < samples; ++j) {
+				const size_t s = ((size_t)p * samples) + j;
+				const Real x = plane.cx[m_sampledX[p]] + Real(start + ((j % grid) * step));
+				const Real y = plane.cy[m_sampledY[p]] + Real(start + ((j / grid) * step));
+				if (m_references.empty() && m_fractal.family == Family::Mandelbrot && inMainBulbs(double(x), double(y))) {
+					m_samples[s] = Interior;
+					if (m_estimateDistance)
+						m_sampleDistances[s] = Interior;
+					continue;
+				}
+
+				// Deep zooms go by the reference at the centre, the offsets are from it.
+				const int k = batch.count++;
+				batch.pixel[k] = s;
+				batch.cx[k] = m_fractal.family == Family::Julia ? Real(m_fractal.juliaX) : x;
+				batch.cy[k] = m_fractal.family == Family::Julia ? Real(m_fractal.juliaY) : y;
+				batch.zx[k] = x;
+				batch.zy[k] = y;
+				batch.dzx[k] = Real(1.0);
+				batch.dzy[k] = Real(0.0);
+				batch.iterations[k] = 0;
+				batch.index[k] = 1;
+			}
+		}
+		iterate(batch, maxIterations);
+
+		const ReferenceOrbit* orbit = m_references.empty() ? nullptr : &m_references[0].orbit;
+		const double originX = orbit ? m_geometry.centerX.toDouble() : 0.0;
+		const double originY = orbit ? m_geometry.centerY.toDouble() : 0.0;
+		for (int k = 0; k < batch.count; ++k) {
+			const size_t s = batch.pixel[k];
+			Real zx = batch.zx[k];
+			Real zy = batch.zy[k];
+			if (orbit) {
+				// A glitched sample takes the pixel's own count.
+				if (batch.index[k] == PerturbationKernel::Glitched) {
+					const int p = int(s / samples);
+					m_samples[s] = m_smooth[offset(m_sampledX[p], m_sampledY[p])];
+					if (m_estimateDistance)
+						m_sampleDistances[s] = m_distance[offset(m_sampledX[p], m_sampledY[p])];
+					continue;
+				}
+				zx = zx + Real(orbit->x()[batch.index[k]]);
+				zy = zy + Real(orbit->y()[batch.index[k]]);
+			}
+
+			if (batch.iterations[k] != EscapeTimeKernel::Periodic && EscapeTimeKernel::magnitude(zx, zy) > EscapeTimeKernel::Limit) {
+				m_samples[s] = smoothCount(m_fractal, batch.iterations[k], double(zx), double(zy),
+					originX + double(batch.cx[k]), originY + double(batch.cy[k]));
+				if (m_estimateDistance) {
+					m_sampleDistances[s] = distanceEstimate(batch.iterations[k], double(zx), double(zy),
+						double(batch.dzx[k]), double(batch.dzy[k]), originX + double(batch.cx[k]), originY + double(batch.cy[k]));
+				}
+			}
+			else {
+				m_samples[s] = Interior;
+				if (m_estimateDistance)
+					m_sampleDistances[s] = Interior;
+			}
+		}
+		}, cancelled);
+}
+
+template<class Real>
+bool FrameRenderer::renderTiles(int maxIterations, const TilePool::Cancelled& cancelled)
+{
+	return TilePool::instance().run(m_tilesX * m_tilesY,
+		[this, maxIterations, &cancelled](int tile) { renderTile<Real>(tile, maxIterations, cancelled); },
+		cancelled);
+}
+
+template<class Real>
+void FrameRenderer::renderTile(int index, int maxIterations, const TilePool::Cancelled& cancelled)
+{
+	const int x0 = (index % m_tilesX) * TileSize;
+	const int y0 = (index / m_tilesX) * TileSize;
+	const int width = std::min(TileSize, m_geometry.width - x0);
+	const int height = std::min(TileSize, m_geometry.height - y0);
+
+	// Copied from the conjugate rows once the pass is done.
+	if (isMirrored(y0, height))
+		return;
+	if (!m_boundary.empty() && !m_boundary[index])
+		return;
+
+	Tile& tile = m_tiles[index];
+	if (!tile.initialized)
+		initializeTile<Real>(tile, x0, y0, width, height);
+	if (tile.unresolved == 0)
+		// Every orbit has escaped or is known to be inside, the results are final.
+		return;
+
+	Batch<Real> batch;
+	batch.count = 0;
+	batch.reference = 0;
+	if (subdivision)
+		subdivide(tile, batch, x0, y0, width, height, maxIterations, cancelled);
+	else
+		compute(tile, batch, x0, y0, width, height, maxIterations, cancelled);
+}
+
+template<class Real>
+void FrameRenderer::initializeTile(Tile& tile, int x0, int y0, int width, int height)
+{
+	Plane<Real>& plane = this->plane<Real>();
+	int unresolved = 0;
+	int escaped = 0;
+	for (int y = y0; y < y0 + height; ++y) {
+		for (int x = x0; x < x0 + width; ++x) {
+			// The pixels kept from a translated frame go on where they were.
+			const size_t i = offset(x, y);
+			if (m_state[i] != Fresh) {
+				unresolved += m_state[i] == Pending;
+				escaped += m_state[i] == Escaped;
+				continue;
+			}
+
+			plane.zx[i] = plane.cx[x];
+			plane.zy[i] = plane.cy[y];
+			if (m_estimateDistance) {
+				plane.dzx[i] = Real(1.0);
+				plane.dzy[i] = Real(0.0);
+			}
+			m_iterations[i] = 0;
+			if (!m_references.empty()) {
+				m_index[i] = 1;
+				m_reference[i] = 0;
+				m_state[i] = Pending;
+				++unresolved;
+			}
+			else if (m_fractal.family == Family::Mandelbrot && inMainBulbs(double(plane.cx[x]), double(plane.cy[y]))) {
+				m_state[i] = Inside;
+				m_result[i] = Interior;
+				m_smooth[i] = Interior;
+			}
+			else {
+				m_state[i] = Pending;
+				++unresolved;
+			}
+		}
+	}
+
+	tile.initialized = true;
+	tile.unresolved = unresolved;
+	tile.escaped = escaped;
+}
+
+template<class Real>
+void FrameRenderer::subdivide(Tile& tile, Batch<Real>& batch, int x0, int y0, int width, int height,
+	int maxIterations, const TilePool::Cancelled& cancelled)
+{
+	if (cancelled && cancelled())
+		return;
+
+	// Too little inside to be worth a border of its own.
+	if (width <= 4 || height <= 4) {
+		compute(tile, batch, x0, y0, width, height, maxIterations, cancelled);
+		return;
+	}
+
+	const int x1 = x0 + width - 1;
+	const int y1 = y0 + height - 1;
+	for (int x = x0; x <= x1; ++x) {
+		queue(tile, batch, x, y0, maxIterations);
+		queue(tile, batch, x, y1, maxIterations);
+	}
+	for (int y = y0 + 1; y < y1; ++y) {
+		queue(tile, batch, x0, y, maxIterations);
+		queue(tile, batch, x1, y, maxIterations);
+	}
+	flush(tile, batch, maxIterations);
+
+	const int value = m_result[offset(x0, y0)];
+	bool uniform = value != Glitch;
+	for (int x = x0; x <= x1 && uniform; ++x)
+		uniform = m_result[offset(x, y0)] == value && m_result[offset(x, y1)] == value;
+	for (int y = y0 + 1; y < y1 && uniform; ++y)
+		uniform = m_result[offset(x0, y)] == value && m_result[offset(x1, y)] == value;
+
+	if (uniform) {
+		// An escaped border stays as it is in later passes and so does the fill, its pixels
+		// are resolved.
+		for (int y = y0 + 1; y < y1; ++y) {
+			for (int x = x0 + 1; x < x1; ++x) {
+				const size_t i = offset(x, y);
+				setResult(tile, i, value);
+				if (value != Interior && m_state[i] == Pending) {
+					m_state[i] = Escaped;
+					m_iterations[i] = value;
+					--tile.unresolved;
+					++tile.escaped;
+				}
+			}
+		}
+		if (value == Interior) {
+			for (int y = y0 + 1; y < y1; ++y)
+				std::fill(m_smooth.begin() + offset(x0 + 1, y), m_smooth.begin() + offset(x1, y), float(Interior));
+		}
+		else {
+			fillSmooth(m_smooth, x0, y0, width, height);
+			if (m_estimateDistance)
+				fillSmooth(m_distance, x0, y0, width, height);
+		}
+		m_filledPixels += (long long)(width - 2) * (height - 2);
+		return;
+	}
+
+	// No part of the set inside, the counts are interpolated as across a uniform border.
+	if (m_estimateDistance && isFarFromSet(x0, y0, width, height)) {
+		fillSmooth(m_smooth, x0, y0, width, height);
+		fillSmooth(m_distance, x0, y0, width, height);
+		for (int y = y0 + 1; y < y1; ++y) {
+			for (int x = x0 + 1; x < x1; ++x) {
+				const size_t i = offset(x, y);
+				const int count = int(m_smooth[i]);
+				setResult(tile, i, count);
+				if (m_state[i] == Pending) {
+					m_state[i] = Escaped;
+					m_iterations[i] = count;
+					--tile.unresolved;
+					++tile.escaped;
+				}
+			}
+		}
+		m_filledPixels += (long long)(width - 2) * (height - 2);
+		return;
+	}
+
+	// The border is known, the four quarters are split from the inside only.
+	const int innerWidth = width - 2;
+	const int innerHeight = height - 2;
+	const int leftWidth = innerWidth / 2;
+	const int topHeight = innerHeight / 2;
+	subdivide(tile, batch, x0 + 1, y0 + 1, leftWidth, topHeight, maxIterations, cancelled);
+	subdivide(tile, batch, x0 + 1 + leftWidth, y0 + 1, innerWidth - leftWidth, topHeight, maxIterations, cancelled);
+	subdivide(tile, batch, x0 + 1, y0 + 1 + topHeight, leftWidth, innerHeight - topHeight, maxIterations, cancelled);
+	subdivide(tile, batch, x0 + 1 + leftWidth, y0 + 1 + topHeight, innerWidth - leftWidth, innerHeight - topHeight,
+		maxIterations, cancelled);
+}
+
+template<class Real>
+void FrameRenderer::compute(Tile& tile, Batch<Real>& batch, int x0, int y0, int width, int height,
+	int maxIterations, const TilePool::Cancelled& cancelled)
+{
+	for (int y = y0; y < y0 + height; ++y) {
+		// Interior tiles may take long at high budgets, a restart shouldn't wait for them.
+		if (cancelled && cancelled())
+			return;
+
+		if (batch.count + width > Batch<Real>::Capacity)
+			flush(tile, batch, maxIterations);
+		for (int x = x0; x < x0 + width; ++x)
+			queue(tile, batch, x, y, maxIterations);
+	}
+	flush(tile, batch, maxIterations);
+}
+
+template<class Real>
+void FrameRenderer::queue(Tile& tile, Batch<Real>& batch, int x, int y, int maxIterations)
+{
+	const Plane<Real>& plane = this->plane<Real>();
+	const size_t i = offset(x, y);
+	if (m_state[i] == Escaped) {
+		setResult(tile, i, m_iterations[i]);
+	}
+	else if (m_state[i] == Inside || m_iterations[i] >= maxIterations) {
+		setResult(tile, i, Interior);
+		m_smooth[i] = Interior;
+	}
+	else if (m_references.empty()) {
+		// A Julia orbit starts at the pixel, c is the same for all.
+		const int k = batch.count++;
+		batch.pixel[k] = i;
+		batch.cx[k] = m_fractal.family == Family::Julia ? Real(m_fractal.juliaX) : plane.cx[x];
+		batch.cy[k] = m_fractal.family == Family::Julia ? Real(m_fractal.juliaY) : plane.cy[y];
+		batch.zx[k] = plane.zx[i];
+		batch.zy[k] = plane.zy[i];
+		if (m_estimateDistance) {
+			batch.dzx[k] = plane.dzx[i];
+			batch.dzy[k] = plane.dzy[i];
+		}
+		batch.iterations[k] = m_iterations[i];
+	}
+	else {
+		// A batch is iterated against a single reference.
+		if (batch.count > 0 && batch.reference != m_reference[i])
+			flush(tile, batch, maxIterations);
+		batch.reference = m_reference[i];
+
+		const Reference& reference = m_references[batch.reference];
+		const int k = batch.count++;
+		batch.pixel[k] = i;
+		batch.cx[k] = plane.cx[x] - Real(reference.offsetX);
+		batch.cy[k] = plane.cy[y] - Real(reference.offsetY);
+		batch.zx[k] = plane.zx[i];
+		batch.zy[k] = plane.zy[i];
+		if (m_estimateDistance) {
+			batch.dzx[k] = plane.dzx[i];
+			batch.dzy[k] = plane.dzy[i];
+		}
+		batch.iterations[k] = m_iterations[i];
+		batch.index[k] = m_index[i];
+	}
+}
+
+template<class Real>
+void FrameRenderer::iterate(Batch<Real>& batch, int maxIterations)
+{
+	if (m_estimateDistance) {
+		EscapeTimeKernel::iterate(m_formula, batch.cx, batch.cy, batch.zx, batch.zy, batch.dzx, batch.dzy,
+			batch.iterations, batch.count, maxIterations, m_periodEpsilon, m_fractal.family == Family::Julia);
+	}
+	else {
+		EscapeTimeKernel::iterate(m_formula, batch.cx, batch.cy, batch.zx, batch.zy, batch.iterations,
+			batch.count, maxIterations, m_periodEpsilon);
+	}
+}
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// A deep zoom is iterated in doubles as perturbations of its reference orbits.
+		template<>
+		void FrameRenderer::iterate<double>(Batch<double>& batch, int maxIterations)
+		{
+			if (m_references.empty() && m_estimateDistance) {
+				EscapeTimeKernel::iterate(m_formula, batch.cx, batch.cy, batch.zx, batch.zy, batch.dzx, batch.dzy,
+					batch.iterations, batch.count, maxIterations, m_periodEpsilon, m_fractal.family == Family::Julia);
+			}
+			else if (m_references.empty()) {
+				EscapeTimeKernel::iterate(m_formula, batch.cx, batch.cy, batch.zx, batch.zy, batch.iterations,
+					batch.count, maxIterations, m_periodEpsilon);
+			}
+			else if (m_estimateDistance) {
+				PerturbationKernel::iterate(m_references[batch.reference].orbit, batch.cx, batch.cy,
+					batch.zx, batch.zy, batch.dzx, batch.dzy, batch.index, batch.iterations, batch.count,
+					maxIterations, m_rebaseAtEnd);
+			}
+			else {
+				PerturbationKernel::iterate(m_references[batch.reference].orbit, batch.cx, batch.cy,
+					batch.zx, batch.zy, batch.index, batch.iterations, batch.count, maxIterations, m_rebaseAtEnd);
+			}
+		}
+	}
+}
+
+template<class Real>
+void FrameRenderer::flush(Tile& tile, Batch<Real>& batch, int maxIterations)
+{
+	if (batch.count == 0)
+		return;
+
+	iterate(batch, maxIterations);
+	m_iteratedPixels += batch.count;
+
+	Plane<Real>& plane = this->plane<Real>();
+	const ReferenceOrbit* orbit = m_references.empty() ? nullptr : &m_references[batch.reference].orbit;
+	// The c of the continuous count, a deep zoom's only roughly.
+	double originX = 0.0;
+	double originY = 0.0;
+	if (orbit) {
+		originX = m_geometry.centerX.toDouble() + m_references[batch.reference].offsetX;
+		originY = m_geometry.centerY.toDouble() + m_references[batch.reference].offsetY;
+	}
+	int glitched = 0;
+	for (int k = 0; k < batch.count; ++k) {
+		const size_t i = batch.pixel[k];
+		plane.zx[i] = batch.zx[k];
+		plane.zy[i] = batch.zy[k];
+		if (m_estimateDistance) {
+			plane.dzx[i] = batch.dzx[k];
+			plane.dzy[i] = batch.dzy[k];
+		}
+		m_iterations[i] = batch.iterations[k];
+
+		Real zx = batch.zx[k];
+		Real zy = batch.zy[k];
+		if (orbit) {
+			m_index[i] = batch.index[k];
+			if (batch.index[k] == PerturbationKernel::Glitched) {
+				m_result[i] = Glitch;
+				++glitched;
+				continue;
+			}
+			zx = zx + Real(orbit->x()[batch.index[k]]);
+			zy = zy + Real(orbit->y()[batch.index[k]]);
+		}
+
+		if (batch.iterations[k] == EscapeTimeKernel::Periodic) {
+			m_state[i] = Inside;
+			setResult(tile, i, Interior);
+			m_smooth[i] = Interior;
+			--tile.unresolved;
+		}
+		else if (EscapeTimeKernel::magnitude(zx, zy) > EscapeTimeKernel::Limit) {
+			m_state[i] = Escaped;
+			setResult(tile, i, batch.iterations[k]);
+			m_smooth[i] = smoothCount(m_fractal, batch.iterations[k], double(zx), double(zy),
+				originX + double(batch.cx[k]), originY + double(batch.cy[k]));
+			if (m_estimateDistance) {
+				m_distance[i] = distanceEstimate(batch.iterations[k], double(zx), double(zy),
+					double(batch.dzx[k]), double(batch.dzy[k]), originX + double(batch.cx[k]), originY + double(batch.cy[k]));
+			}
+			++tile.escaped;
+			--tile.unresolved;
+		}
+		else {
+			setResult(tile, i, Interior);
+			m_smooth[i] = Interior;
+		}
+	}
+	m_glitchedPixels += glitched;
+	batch.count = 0;
+}
@@ -0,0 +1,329 @@
+#ifndef FRAMERENDERER_H
+#define FRAMERENDERER_H
+
+#include "DoubleDouble.h"
+#include "EscapeTimeKernel.h"
+#include "FixedPoint.h"
+#include "ReferenceOrbit.h"
+#include "TilePool.h"
+#include <atomic>
+#include <functional>
+#include <vector>
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// The escape-time computation of a whole frame, split into square tiles which are
+		// scheduled on the TilePool. Every pixel keeps its orbit between passes, so a pass with
+		// a higher budget only continues the unresolved ones. Colouring is left to the caller.
+		class FrameRenderer
+		{
+		public:
+			enum class Precision
+			{
+				Float,
+				Double,
+				DoubleDouble,
+				Float128,
+				Perturbation
+			};
+
+			// Each on a kernel loop of its own. Only the Mandelbrot set has the closed-form
+			// interior test and perturbation, deep frames of the others stay in the widest type.
+			enum class Family
+			{
+				Mandelbrot,
+				Julia,
+				BurningShip,
+				Multibrot
+			};
+
+			// The power is used by Multibrot sets, the constant by Julia sets.
+			struct Fractal
+			{
+				Family family;
+				int power;
+				double juliaX;
+				double juliaY;
+
+				friend bool operator==(const Fractal& a, const Fractal& b)
+				{
+					return a.family == b.family && a.power == b.power && a.juliaX == b.juliaX && a.juliaY == b.juliaY;
+				}
+			};
+
+			struct Geometry
+			{
+				FixedPoint centerX;
+				FixedPoint centerY;
+				double scaleFactor;
+				int width;
+				int height;
+			};
+
+			FrameRenderer();
+
+			// Starts a new frame, all orbits are reset. A frame moved by whole pixels from the
+			// last one keeps the orbits of the pixels still in view, the passes then only have
+			// to start the exposed strips; deep zooms on references start over regardless.
+			void setGeometry(const Geometry& geometry, const Fractal& fractal);
+			const Geometry& geometry() const { return m_geometry; }
+			const Fractal& fractal() const { return m_fractal; }
+
+			// Continues every unresolved pixel up to the given budget, false when cancelled. A
+			// frame in float starts over in double with the first budget past FloatIterations.
+			// With boundaryOnly the tiles with no escaped pixel in or next to them are taken
+			// for the interior and left as they are.
+			bool renderPass(int maxIterations, const TilePool::Cancelled& cancelled, bool boundaryOnly = false);
+
+			// The iteration counts, Interior for the pixels which stayed bounded, and the continuous
+			// counts n + 1 - log_d(log2 |z|) of the escaped ones.
+			const int* scanLine(int y) const { return m_result.data() + offset(0, y); }
+			const float* smoothLine(int y) const { return m_smooth.data() + offset(0, y); }
+			// The distance of the escaped pixels to the set in pixel spacings, negative for the
+			// others; null unless the frame estimates distances.
+			const float* distanceLine(int y) const { return m_distance.empty() ? nullptr : m_distance.data() + offset(0, y); }
+
+			// The pixels the last pass had to iterate and the ones it filled by subdivision
+			// or mirroring.
+			long long iteratedPixels() const { return m_iteratedPixels; }
+			long long filledPixels() const { return m_filledPixels; }
+			// The pixels whose result the last pass changed.
+			long long changedPixels() const { return m_changedPixels; }
+			// The budget past which fewer than the given fraction of pixels would still escape,
+			// extrapolated from the escapes in the last octaves of the budget just rendered.
+			int estimateIterations(int maxIterations, double tolerance) const;
+			// Supersamples the pixels whose neighbours' counts differ sharply, on a regular grid of
+			// up to maxSamples points in each, at the budget of the last pass. The samples are
+			// dropped by the next pass or frame. False when cancelled.
+			bool antialias(int maxSamples, int maxIterations, const TilePool::Cancelled& cancelled);
+			// The supersampled pixels of a row: their x and, one pixel after another,
+			// samplesPerPixel() continuous counts each, and as many distances unless
+			// distances is null.
+			int sampledPixels(int y, const int*& x, const float*& samples, const float*& distances) const;
+			int samplesPerPixel() const { return m_samplesPerPixel; }
+			long long sampledPixelCount() const { return (long long)m_sampledX.size(); }
+			// The kernel loop of a fractal.
+			static EscapeTimeKernel::Formula formula(const Fractal& fractal);
+			// The continuous count of an orbit of c which escaped to z after that many iterations.
+			static float smoothCount(const Fractal& fractal, int iterations, double zx, double zy, double cx, double cy);
+			// The tier the frame is iterated in and, for a deep zoom, its reference orbits. Pixels
+			// which outlive an escaped reference are iterated again relative to a new one among them.
+			Precision precision() const { return m_precision; }
+			int referenceCount() const { return int(m_references.size()); }
+
+			// The cheapest type still accurate at the scale; past double, perturbation or, with it
+			// off, double-double and float128 where the compiler has it.
+			static Precision precisionFor(double scaleFactor, Family family);
+			static const char* name(Precision precision);
+			static const char* name(Family family);
+			static bool fromName(const char* name, Family& family);
+
+			// Exact per-pixel rendering when off, for validation. Subdivision only iterates the
+			// border of a rectangle and fills a uniform one, or else splits it in four; pixels
+			// filled as interior keep their orbit for a later pass.
+			static void setSubdivision(bool on) { subdivision = on; }
+			static bool isSubdivision() { return subdivision; }
+			// With the real axis in view the rows are snapped by less than half a pixel to it,
+			// and those of the smaller side are copied from their conjugates.
+			static void setSymmetry(bool on) { symmetry = on; }
+			static bool isSymmetry() { return symmetry; }
+			static void setPerturbation(bool on) { perturbation = on; }
+			static bool isPerturbation() { return perturbation; }
+			// The frames started from then on estimate distances, but the Burning Ship's, from the
+			// derivative of the orbits and the Koebe quarter theorem. A lower bound, which for
+			// Julia sets only holds when they are connected.
+			static void setDistanceEstimation(bool on) { distanceEstimation = on; }
+			static bool isDistanceEstimation() { return distanceEstimation; }
+
+			static constexpr int Interior = -1;
+			static constexpr int TileSize = 64;
+			// The periodicity tolerance of the kernel, as a fraction of the pixel spacing.
+			static constexpr double PeriodTolerance = 1.0 / 1024;
+			// How far a kept pixel may be off its new coordinates, in pixels.
+			static constexpr double TranslationTolerance = 1.0 / 1024;
+			// The smallest pixel spacing of each tier. Float keeps the pixels some thousand units
+			// in the last place apart, but its boundary is off by some pixels against double,
+			// so it only previews the frame up to FloatIterations.
+			static constexpr double FloatScale = 2e-3;
+			static constexpr int FloatIterations = 128;
+			static constexpr double DoubleScale = 1e-13;
+			static constexpr double DoubleDoubleScale = 1e-29;
+			static constexpr double Float128Scale = 1e-31;
+			static constexpr int MaxReferences = 8;
+			static constexpr int MinPower = 3;
+			static constexpr int MaxPower = 6;
+			static constexpr double DefaultJuliaX = -0.8;
+			static constexpr double DefaultJuliaY = 0.156;
+			static constexpr int MaxEstimatedIterations = 1 << 22;
+			static constexpr int MaxSamples = 64;
+			// The difference of the continuous counts of neighbours which makes an edge.
+			static constexpr float EdgeContrast = 1.0f;
+			// A rectangle is filled when all of its border is at least this many times its
+			// longer side away from the set.
+			static constexpr float FillDistance = 0.5f;
+			// A pixel this far from the set, in pixel spacings, has none of it inside and isn't
+			// supersampled.
+			static constexpr float ClearDistance = 0.75f;
+
+		private:
+			enum State : unsigned char
+			{
+				Pending,
+				Escaped,
+				Inside,
+				// Not set up yet.
+				Fresh
+			};
+
+			struct Reference
+			{
+				ReferenceOrbit orbit;
+				double offsetX;
+				double offsetY;
+			};
+
+			struct Tile
+			{
+				bool initialized;
+				int unresolved;
+				int escaped;
+				int changed;
+			};
+
+			// The coordinates of the pixel rows and columns and the orbits, in one numeric type.
+			// A deep zoom keeps the offsets from the centre and the perturbations in doubles.
+			template<class Real>
+			struct Plane
+			{
+				std::vector<Real> cx;
+				std::vector<Real> cy;
+				std::vector<Real> zx;
+				std::vector<Real> zy;
+				// dz, with distance estimation only.
+				std::vector<Real> dzx;
+				std::vector<Real> dzy;
+			};
+
+			template<class Real>
+			struct Batch
+			{
+				static constexpr int Capacity = 4 * TileSize;
+
+				int count;
+				size_t pixel[Capacity];
+				Real cx[Capacity];
+				Real cy[Capacity];
+				Real zx[Capacity];
+				Real zy[Capacity];
+				Real dzx[Capacity];
+				Real dzy[Capacity];
+				int iterations[Capacity];
+				int index[Capacity];
+				int reference;
+			};
+
+			size_t offset(int x, int y) const { return (size_t)y * m_geometry.width + x; }
+			// Conjugate points have the same orbit up to conjugation.
+			static bool isConjugateSymmetric(const Fractal& fractal);
+			float distanceEstimate(int iterations, double zx, double zy, double dzx, double dzy, double cx, double cy) const;
+			void fillSmooth(std::vector<float>& values, int x0, int y0, int width, int height);
+			bool isFarFromSet(int x0, int y0, int width, int height) const;
+			void setResult(Tile& tile, size_t i, int value);
+			bool isNearBoundary(int tile) const;
+			bool isEdge(int x, int y) const;
+			void clearSamples();
+			template<class Real>
+			bool sample(int grid, int maxIterations, const TilePool::Cancelled& cancelled);
+			bool isTranslation(const Geometry& geometry, const Fractal& fractal, int& dx, int& dy) const;
+			bool translate(int dx, int dy, const std::vector<int>& mirror);
+			template<class Real>
+			bool translate(int dx, int dy, const std::vector<int>& mirror);
+			bool isMirrored(int y0, int height) const;
+			void mirrorRows();
+			void addReference();
+			template<class Real>
+			Plane<Real>& plane();
+			// Sets up the orbits of a new frame in its tier.
+			void reset();
+			template<class Real>
+			void setCoordinates();
+			void setOffsets();
+			template<class Real>
+			bool renderTiles(int maxIterations, const TilePool::Cancelled& cancelled);
+			template<class Real>
+			void renderTile(int tile, int maxIterations, const TilePool::Cancelled& cancelled);
+			template<class Real>
+			void initializeTile(Tile& tile, int x0, int y0, int width, int height);
+			template<class Real>
+			void subdivide(Tile& tile, Batch<Real>& batch, int x0, int y0, int width, int height,
+				int maxIterations, const TilePool::Cancelled& cancelled);
+			template<class Real>
+			void compute(Tile& tile, Batch<Real>& batch, int x0, int y0, int width, int height,
+				int maxIterations, const TilePool::Cancelled& cancelled);
+			template<class Real>
+			void queue(Tile& tile, Batch<Real>& batch, int x, int y, int maxIterations);
+			template<class Real>
+			void flush(Tile& tile, Batch<Real>& batch, int maxIterations);
+			template<class Real>
+			void iterate(Batch<Real>& batch, int maxIterations);
+
+			Geometry m_geometry;
+			Fractal m_fractal;
+			EscapeTimeKernel::Formula m_formula;
+			int m_tilesX;
+			int m_tilesY;
+			std::vector<Tile> m_tiles;
+			std::vector<unsigned char> m_boundary;
+			Precision m_precision;
+			Plane<float> m_floats;
+			Plane<double> m_doubles;
+			Plane<DoubleDouble> m_doubleDoubles;
+#if defined(MANDELBROT_FLOAT128)
+			Plane<Float128> m_float128s;
+#endif
+			std::vector<int> m_iterations;
+			std::vector<int> m_index;
+			std::vector<unsigned char> m_reference;
+			std::vector<int> m_mirror;
+			std::vector<unsigned char> m_state;
+			std::vector<int> m_result;
+			std::vector<float> m_smooth;
+			std::vector<float> m_distance;
+			std::vector<int> m_sampledX;
+			std::vector<int> m_sampledY;
+			// Where each row starts in the supersampled pixels.
+			std::vector<int> m_sampledRows;
+			std::vector<float> m_samples;
+			std::vector<float> m_sampleDistances;
+			int m_samplesPerPixel;
+			bool m_estimateDistance;
+			int m_power;
+			double m_periodEpsilon;
+			std::vector<Reference> m_references;
+			int m_fractionLimbs;
+			bool m_rebaseAtEnd;
+			std::atomic<long long> m_glitchedPixels;
+			std::atomic<long long> m_iteratedPixels;
+			std::atomic<long long> m_filledPixels;
+			long long m_changedPixels;
+
+			// The result of a glitched pixel until it is iterated again.
+			static constexpr int Glitch = -2;
+			// The steps an escaped orbit is carried on for its continuous count.
+			static constexpr int SmoothSteps = 2;
+			// The |z|^2 past which an escaped orbit gives its distance, and the steps it may take to get there.
+			static constexpr double DistanceLimit = 1e8;
+			static constexpr int MaxDistanceSteps = 64;
+
+			static bool subdivision;
+			static bool symmetry;
+			static bool perturbation;
+			static bool distanceEstimation;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,306 @@
+#include "EscapeTimeFormula.h"
+#include "EscapeTimeKernel.h"
+#include "FrameRenderer.h"
+#include "OrbitDensity.h"
+#include "TilePool.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+
+using namespace Mandelbrot::Common;
+
+namespace
+{
+	struct ScalarOps
+	{
+		static double add(double a, double b) { return a + b; }
+		static double sub(double a, double b) { return a - b; }
+		static double mul(double a, double b) { return a * b; }
+		static double abs(double a) { return std::fabs(a); }
+		static double set(double a) { return a; }
+	};
+
+	// The main cardioid and the period-2 bulb, whose orbits never escape.
+	bool inMainBulbs(double x, double y)
+	{
+		const double y2 = y * y;
+		const double xq = x - 0.25;
+		const double q = (xq * xq) + y2;
+		if (q * (q + xq) <= 0.25 * y2)
+			return true;
+
+		const double xb = x + 1.0;
+		return (xb * xb) + y2 <= 0.0625;
+	}
+}
+
+OrbitDensity::OrbitDensity() :
+	m_geometry{ FixedPoint(), FixedPoint(), 1.0, 0, 0 },
+	m_fractal{ FrameRenderer::Family::Mandelbrot, FrameRenderer::MinPower, FrameRenderer::DefaultJuliaX, FrameRenderer::DefaultJuliaY },
+	m_power(2),
+	m_left(0.0),
+	m_top(0.0),
+	m_histogramCount(0),
+	m_peak(0.0f),
+	m_samples(0)
+{
+}
+
+void OrbitDensity::setGeometry(const FrameRenderer::Geometry& geometry, const FrameRenderer::Fractal& fractal)
+{
+	m_geometry = geometry;
+	m_fractal = fractal;
+	m_power = fractal.family == FrameRenderer::Family::Multibrot
+		? std::clamp(fractal.power, FrameRenderer::MinPower, FrameRenderer::MaxPower) : 2;
+	m_left = geometry.centerX.toDouble() - ((geometry.width / 2) * geometry.scaleFactor);
+	m_top = geometry.centerY.toDouble() - ((geometry.height / 2) * geometry.scaleFactor);
+
+	// The chains are seeded by their index, a frame takes the same samples on every run;
+	// only the order they are added in, and so their rounding, changes.
+	const size_t pixels = (size_t)geometry.width * geometry.height;
+	const int count = TilePool::instance().threadCount();
+	const size_t fitting = MaxHistogramBytes / std::max<size_t>(pixels * sizeof(float), 1);
+	const int histograms = int(std::clamp<size_t>(fitting, 1, size_t(count)));
+	if (histograms != m_histogramCount) {
+		m_histograms.reset(new Histogram[histograms]);
+		m_histogramCount = histograms;
+	}
+	for (int i = 0; i < histograms; ++i)
+		m_histograms[i].counts.assign(pixels, 0.0f);
+
+	m_chains.resize(count);
+	for (int i = 0; i < count; ++i) {
+		Chain& chain = m_chains[i];
+		chain.home = i % histograms;
+		chain.random.seed(i + 1);
+		chain.started = false;
+		chain.x = 0.0;
+		chain.y = 0.0;
+		chain.held = 0;
+		chain.traced = 0;
+		chain.proposed = 0;
+		chain.accepted = 0;
+		chain.splats.clear();
+		chain.splats.reserve(SplatCapacity);
+	}
+	m_density.assign(pixels, 0.0f);
+	m_peak = 0.0f;
+	m_samples = 0;
+}
+
+bool OrbitDensity::accumulate(long long samples, int maxIterations, const TilePool::Cancelled& cancelled)
+{
+	if (m_chains.empty() || m_density.empty())
+		return true;
+
+	const int count = int(m_chains.size());
+	const bool completed = TilePool::instance().run(count,
+		[this, samples, maxIterations, count, &cancelled](int i) {
+			const long long share = (samples / count) + (i < samples % count ? 1 : 0);
+			Chain& chain = m_chains[i];
+			if (m_fractal.family == FrameRenderer::Family::BurningShip)
+				run<Formulas::BurningShip>(chain, share, maxIterations, cancelled);
+			else if (m_power == 3)
+				run<Formulas::Multibrot<3>>(chain, share, maxIterations, cancelled);
+			else if (m_power == 4)
+				run<Formulas::Multibrot<4>>(chain, share, maxIterations, cancelled);
+			else if (m_power == 5)
+				run<Formulas::Multibrot<5>>(chain, share, maxIterations, cancelled);
+			else if (m_power == 6)
+				run<Formulas::Multibrot<6>>(chain, share, maxIterations, cancelled);
+			else
+				run<Formulas::Quadratic>(chain, share, maxIterations, cancelled);
+		}, cancelled);
+	if (!completed)
+		return false;
+
+	// The rows are merged in parallel, every one from all the histograms at once.
+	TilePool::instance().run(m_geometry.height, [this](int y) { merge(y); }, []() { return false; });
+	for (Chain& chain : m_chains) {
+		m_samples += chain.traced;
+		chain.traced = 0;
+	}
+	m_peak = *std::max_element(m_density.begin(), m_density.end());
+	return true;
+}
+
+double OrbitDensity::acceptance() const
+{
+	long long proposed = 0;
+	long long accepted = 0;
+	for (const Chain& chain : m_chains) {
+		proposed += chain.proposed;
+		accepted += chain.accepted;
+	}
+	return proposed > 0 ? double(accepted) / double(proposed) : 0.0;
+}
+
+template<class Formula>
+void OrbitDensity::run(Chain& chain, long long samples, int maxIterations, const TilePool::Cancelled& cancelled)
+{
+	// Mutations are spread over the orders of magnitude from the frame's extent down, so
+	// they explore both around a productive point and its far surroundings.
+	const double span = std::min(m_geometry.scaleFactor * std::max(m_geometry.width, m_geometry.height), 2.0 * Extent);
+	const double twoPi = 2.0 * std::acos(-1.0);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	std::vector<uint32_t> pixels;
+
+	// The current point is traced again with the budget of this pass.
+	if (chain.started) {
+		release(chain);
+		chain.started = trace<Formula>(chain.x, chain.y, maxIterations, chain.pixels);
+	}
+
+	for (long long i = 0; i < samples; ++i) {
+		if (i % CancelInterval == 0 && cancelled && cancelled()) {
+			release(chain);
+			flush(chain);
+			return;
+		}
+
+		double x;
+		double y;
+		if (!chain.started || unit(chain.random) < JumpProbability) {
+			x = Extent * ((2.0 * unit(chain.random)) - 1.0);
+			y = Extent * ((2.0 * unit(chain.random)) - 1.0);
+		}
+		else {
+			const double radius = span * std::pow(MinMutation, unit(chain.random));
+			const double angle = twoPi * unit(chain.random);
+			x = chain.x + (radius * std::cos(angle));
+			y = chain.y + (radius * std::sin(angle));
+		}
+		++chain.traced;
+
+		const bool productive = trace<Formula>(x, y, maxIterations, pixels);
+		if (!chain.started) {
+			if (productive) {
+				chain.started = true;
+				chain.x = x;
+				chain.y = y;
+				chain.pixels.swap(pixels);
+				chain.held = 1;
+			}
+			continue;
+		}
+
+		// Metropolis: the proposals are symmetric, the ratio of the pixels crossed decides.
+		++chain.proposed;
+		if (productive && (pixels.size() >= chain.pixels.size()
+			|| unit(chain.random) * chain.pixels.size() < pixels.size())) {
+			release(chain);
+			++chain.accepted;
+			chain.x = x;
+			chain.y = y;
+			chain.pixels.swap(pixels);
+		}
+		++chain.held;
+	}
+	release(chain);
+	flush(chain);
+}
+
+template<class Formula>
+bool OrbitDensity::trace(double x, double y, int maxIterations, std::vector<uint32_t>& pixels) const
+{
+	pixels.clear();
+	if (std::fabs(x) > Extent || std::fabs(y) > Extent)
+		return false;
+
+	const bool julia = m_fractal.family == FrameRenderer::Family::Julia;
+	if (m_fractal.family == FrameRenderer::Family::Mandelbrot && inMainBulbs(x, y))
+		return false;
+
+	const double ax = julia ? m_fractal.juliaX : x;
+	const double ay = julia ? m_fractal.juliaY : y;
+	const double inverse = 1.0 / m_geometry.scaleFactor;
+	const double epsilon = PeriodEpsilon * PeriodEpsilon;
+	double a = x;
+	double b = y;
+	double sa = a;
+	double sb = b;
+	int sinceSave = 0;
+	int interval = EscapeTimeKernel::PeriodInterval;
+
+	for (int i = 0; i < maxIterations; ++i) {
+		const double px = std::floor(((a - m_left) * inverse) + 0.5);
+		const double py = std::floor(((b - m_top) * inverse) + 0.5);
+		if (px >= 0.0 && px < m_geometry.width && py >= 0.0 && py < m_geometry.height)
+			pixels.push_back(uint32_t((int(py) * m_geometry.width) + int(px)));
+
+		Formula::template step<ScalarOps>(a, b, ax, ay, a, b);
+		if ((a * a) + (b * b) > EscapeTimeKernel::Limit)
+			return !pixels.empty();
+
+		const double pa = a - sa;
+		const double pb = b - sb;
+		if ((pa * pa) + (pb * pb) < epsilon)
+			break;
+		if (++sinceSave == interval) {
+			sa = a;
+			sb = b;
+			sinceSave = 0;
+			interval *= 2;
+		}
+	}
+
+	pixels.clear();
+	return false;
+}
+
+void OrbitDensity::release(Chain& chain)
+{
+	if (chain.held == 0 || chain.pixels.empty())
+		return;
+
+	// Weighted by the inverse of the chance the chain had to be on the point.
+	const float weight = float(double(chain.held) / double(chain.pixels.size()));
+	for (uint32_t pixel : chain.pixels) {
+		if (chain.splats.size() == SplatCapacity)
+			flush(chain);
+		chain.splats.push_back(Splat{ pixel, weight });
+	}
+	chain.held = 0;
+}
+
+void OrbitDensity::flush(Chain& chain)
+{
+	if (chain.splats.empty())
+		return;
+
+	// A busy histogram is passed over, the chain only waits when all of them are.
+	Histogram* histogram = nullptr;
+	std::unique_lock<std::mutex> lock;
+	for (int k = 0; k < m_histogramCount && !histogram; ++k) {
+		Histogram& candidate = m_histograms[(chain.home + k) % m_histogramCount];
+		lock = std::unique_lock<std::mutex>(candidate.mutex, std::try_to_lock);
+		if (lock.owns_lock())
+			histogram = &candidate;
+	}
+	if (!histogram) {
+		histogram = &m_histograms[chain.home];
+		lock = std::unique_lock<std::mutex>(histogram->mutex);
+	}
+
+	float* counts = histogram->counts.data();
+	for (const Splat& splat : chain.splats)
+		counts[splat.pixel] += splat.weight;
+	chain.splats.clear();
+}
+
+void OrbitDensity::merge(int y)
+{
+	const size_t start = (size_t)y * m_geometry.width;
+	float* density = m_density.data() + start;
+	for (int i = 0; i < m_histogramCount; ++i) {
+		float* counts = m_histograms[i].counts.data() + start;
+		for (int x = 0; x < m_geometry.width; ++x) {
+			density[x] += counts[x];
+			counts[x] = 0.0f;
+		}
+	}
+}
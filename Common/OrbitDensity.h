@@ -0,0 +1,125 @@
+#ifndef ORBITDENSITY_H
+#define ORBITDENSITY_H
+
+#include "FrameRenderer.h"
+#include "TilePool.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// The Buddhabrot of a fractal: how often the orbits which escape pass through each
+		// pixel of the frame, for c sampled across the plane, or the starting point of a
+		// Julia set. Most points never cross the frame, so the samples are drawn by
+		// Metropolis chains, one per worker of the TilePool: a chain mostly mutates its last
+		// productive point, whose orbit crossed the frame, and now and then jumps anywhere.
+		// An orbit counts with the inverse of the pixels it crosses, which undoes the
+		// preference for productive points. A chain gathers the splats of its orbits in a
+		// buffer of SplatCapacity, flushed under a lock into one of a few shared histograms;
+		// they are added up at the end of each pass, which refines the frame progressively.
+		// A histogram is 4 bytes a pixel, 33 MB at 4K, so they are as many as fit in
+		// MaxHistogramBytes, from one up to one per chain. The orbits are traced in doubles,
+		// deep zooms are beyond it.
+		class OrbitDensity
+		{
+		public:
+			OrbitDensity();
+
+			// Starts a new frame, the densities are reset.
+			void setGeometry(const FrameRenderer::Geometry& geometry, const FrameRenderer::Fractal& fractal);
+			const FrameRenderer::Geometry& geometry() const { return m_geometry; }
+
+			// Samples that many more points in all, counting the orbits which escape within
+			// the budget. False when cancelled; the samples taken so far are added with the
+			// next pass then.
+			bool accumulate(long long samples, int maxIterations, const TilePool::Cancelled& cancelled);
+
+			const float* densityLine(int y) const { return m_density.data() + ((size_t)y * m_geometry.width); }
+			float peak() const { return m_peak; }
+			long long samples() const { return m_samples; }
+			int chainCount() const { return int(m_chains.size()); }
+			int histogramCount() const { return m_histogramCount; }
+			// The share of the mutations the chains took.
+			double acceptance() const;
+
+			// The chance of a jump anywhere instead of a mutation.
+			static constexpr double JumpProbability = 0.2;
+			// Mutations move a point by up to the frame's extent, and down to this fraction of it.
+			static constexpr double MinMutation = 1e-4;
+			// The points are sampled in the square of this half side around 0.
+			static constexpr double Extent = 2.0;
+			// All the shared histograms together, the density of the frame besides.
+			static constexpr size_t MaxHistogramBytes = size_t(256) << 20;
+			// The splats a chain gathers before it takes a histogram's lock, 8 bytes each.
+			static constexpr size_t SplatCapacity = 16384;
+
+		private:
+			struct Splat
+			{
+				uint32_t pixel;
+				float weight;
+			};
+
+			struct Chain
+			{
+				// The histogram it flushes into first.
+				int home;
+				std::mt19937_64 random;
+				bool started;
+				double x;
+				double y;
+				// The pixels its orbit crosses, one per point of it.
+				std::vector<uint32_t> pixels;
+				// The samples which stayed on the point since it was taken.
+				long long held;
+				long long traced;
+				long long proposed;
+				long long accepted;
+				std::vector<Splat> splats;
+			};
+
+			struct Histogram
+			{
+				std::mutex mutex;
+				std::vector<float> counts;
+			};
+
+			template<class Formula>
+			void run(Chain& chain, long long samples, int maxIterations, const TilePool::Cancelled& cancelled);
+			// The pixels crossed by the orbit of a point, false unless it escapes through the frame.
+			template<class Formula>
+			bool trace(double x, double y, int maxIterations, std::vector<uint32_t>& pixels) const;
+			// Adds the samples held on the current point of the chain to its splats.
+			void release(Chain& chain);
+			// Adds the splats to the first histogram free from the chain's own on.
+			void flush(Chain& chain);
+			void merge(int y);
+
+			FrameRenderer::Geometry m_geometry;
+			FrameRenderer::Fractal m_fractal;
+			int m_power;
+			// The plane at the corner of the frame, pixel centres at whole steps from it.
+			double m_left;
+			double m_top;
+			std::vector<Chain> m_chains;
+			std::unique_ptr<Histogram[]> m_histograms;
+			int m_histogramCount;
+			std::vector<float> m_density;
+			float m_peak;
+			long long m_samples;
+
+			// A cancelled pass is noticed within this many samples.
+			static constexpr int CancelInterval = 256;
+			// Orbits coming back this close to an earlier point are taken for periodic.
+			static constexpr double PeriodEpsilon = 1e-12;
+		};
+	}
+}
+
+#endif
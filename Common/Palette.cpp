@@ -0,0 +1,193 @@
+#include "EscapeTimeKernel.h"
+#include "Palette.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MANDELBROT_X86
+#endif
+
+
+using namespace Mandelbrot::Common;
+
+#if defined(MANDELBROT_X86)
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		namespace Simd
+		{
+			// Defined in the per instruction set translation units.
+			bool colorizeSse2(const uint32_t* colors, int mask, const float* smooth, uint32_t* pixels, int count);
+			bool colorizeAvx2(const uint32_t* colors, int mask, const float* smooth, uint32_t* pixels, int count);
+		}
+	}
+}
+#endif
+
+namespace
+{
+	int powerOfTwo(int size)
+	{
+		int result = 1;
+		while (result < size)
+			result *= 2;
+		return result;
+	}
+
+	// The vectorized passes interpolate in the same float operations, pixel for pixel.
+	int blend(uint32_t a, uint32_t b, int shift, float t)
+	{
+		const float from = float((a >> shift) & 0xff);
+		const float to = float((b >> shift) & 0xff);
+		return int(from + ((to - from) * t));
+	}
+
+	bool colorizeScalar(const uint32_t* colors, int mask, const float* smooth, uint32_t* pixels, int count)
+	{
+		bool escaped = false;
+		for (int i = 0; i < count; ++i) {
+			if (smooth[i] < 0.0f) {
+				pixels[i] = Palette::Black;
+				continue;
+			}
+
+			const int k = int(smooth[i]);
+			const float t = smooth[i] - float(k);
+			const uint32_t a = colors[k & mask];
+			const uint32_t b = colors[(k + 1) & mask];
+			pixels[i] = Palette::Black | (uint32_t(blend(a, b, 16, t)) << 16) | (uint32_t(blend(a, b, 8, t)) << 8)
+				| uint32_t(blend(a, b, 0, t));
+			escaped = true;
+		}
+		return escaped;
+	}
+}
+
+std::mutex Palette::cacheMutex;
+std::list<std::shared_ptr<const Palette>> Palette::cache;
+
+Palette::Palette(const Parameters& parameters) :
+	m_parameters(parameters)
+{
+	const int size = powerOfTwo(parameters.size);
+	m_parameters.size = size;
+
+	const double r = (parameters.color >> 16) & 0xff;
+	const double g = (parameters.color >> 8) & 0xff;
+	const double b = parameters.color & 0xff;
+	m_colors.resize(size);
+	for (int i = 0; i < size; ++i)
+		m_colors[i] = fromWaveLength(380.0 + (i * 400.0 / size), r, g, b, parameters.gamma);
+}
+
+std::shared_ptr<const Palette> Palette::find(const Parameters& parameters)
+{
+	Parameters key = parameters;
+	key.size = powerOfTwo(parameters.size);
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	for (auto it = cache.begin(); it != cache.end(); ++it) {
+		if ((*it)->m_parameters == key) {
+			cache.splice(cache.begin(), cache, it);
+			return cache.front();
+		}
+	}
+
+	cache.push_front(std::make_shared<const Palette>(key));
+	if (int(cache.size()) > CacheSize)
+		cache.pop_back();
+	return cache.front();
+}
+
+bool Palette::colorize(const float* smooth, uint32_t* pixels, int count) const
+{
+	const int mask = size() - 1;
+	switch (EscapeTimeKernel::instructionSet()) {
+#if defined(MANDELBROT_X86)
+	// A gather of 16 lanes brings nothing over 8, AVX-512 takes the AVX2 pass.
+	case EscapeTimeKernel::InstructionSet::AVX512:
+	case EscapeTimeKernel::InstructionSet::AVX2:
+		return Simd::colorizeAvx2(colors(), mask, smooth, pixels, count);
+	case EscapeTimeKernel::InstructionSet::SSE2:
+		return Simd::colorizeSse2(colors(), mask, smooth, pixels, count);
+#endif
+	default:
+		return colorizeScalar(colors(), mask, smooth, pixels, count);
+	}
+}
+
+void Palette::shade(const float* distance, uint32_t* pixels, int count)
+{
+	for (int i = 0; i < count; ++i) {
+		if (distance[i] < 0.0f || distance[i] >= BoundaryWidth)
+			continue;
+
+		const float t = distance[i] / BoundaryWidth;
+		const uint32_t color = pixels[i];
+		pixels[i] = Black | (uint32_t(float((color >> 16) & 0xff) * t) << 16) | (uint32_t(float((color >> 8) & 0xff) * t) << 8)
+			| uint32_t(float(color & 0xff) * t);
+	}
+}
+
+uint32_t Palette::average(const float* smooth, const float* distance, int count) const
+{
+	// A few samples at a time, the channels are summed apart.
+	constexpr int Group = 16;
+	uint32_t colors[Group];
+	int r = 0;
+	int g = 0;
+	int b = 0;
+	for (int i = 0; i < count; i += Group) {
+		const int n = std::min(Group, count - i);
+		colorize(smooth + i, colors, n);
+		if (distance)
+			shade(distance + i, colors, n);
+		for (int k = 0; k < n; ++k) {
+			r += (colors[k] >> 16) & 0xff;
+			g += (colors[k] >> 8) & 0xff;
+			b += colors[k] & 0xff;
+		}
+	}
+	return Black | (uint32_t((r + (count / 2)) / count) << 16) | (uint32_t((g + (count / 2)) / count) << 8)
+		| uint32_t((b + (count / 2)) / count);
+}
+
+uint32_t Palette::fromWaveLength(double wave, double r, double g, double b, double gamma)
+{
+	if (wave >= 380.0 && wave <= 440.0) {
+		r = -1.0 * (wave - 440.0) / (440.0 - 380.0);
+		b = 1.0;
+	}
+	else if (wave >= 440.0 && wave <= 490.0) {
+		g = (wave - 440.0) / (490.0 - 440.0);
+		b = 1.0;
+	}
+	else if (wave >= 490.0 && wave <= 510.0) {
+		g = 1.0;
+		b = -1.0 * (wave - 510.0) / (510.0 - 490.0);
+	}
+	else if (wave >= 510.0 && wave <= 580.0) {
+		r = (wave - 510.0) / (580.0 - 510.0);
+		g = 1.0;
+	}
+	else if (wave >= 580.0 && wave <= 645.0) {
+		r = 1.0;
+		g = -1.0 * (wave - 645.0) / (645.0 - 580.0);
+	}
+	else if (wave >= 645.0 && wave <= 780.0) {
+		r = 1.0;
+	}
+
+	double s = 1.0;
+	if (wave > 700.0)
+		s = 0.3 + 0.7 * (780.0 - wave) / (780.0 - 700.0);
+	else if (wave < 420.0)
+		s = 0.3 + 0.7 * (wave - 380.0) / (420.0 - 380.0);
+
+	r = std::pow(r * s, gamma);
+	g = std::pow(g * s, gamma);
+	b = std::pow(b * s, gamma);
+	return Black | ((uint32_t(int(r * 255)) & 0xff) << 16) | ((uint32_t(int(g * 255)) & 0xff) << 8)
+		| (uint32_t(int(b * 255)) & 0xff);
+}
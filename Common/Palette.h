@@ -0,0 +1,74 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// The colours of the continuous iteration counts: a visible spectrum tinted by
+		// a base colour, wrapping around after size counts. Palettes are built once per
+		// set of parameters and shared from a small cache, the colouring of a frame only
+		// looks them up, vectorized on the instruction set of the escape-time kernel.
+		class Palette
+		{
+		public:
+			struct Parameters
+			{
+				// 0xAARRGGBB as a QRgb.
+				uint32_t color;
+				// Rounded up to a power of two.
+				int size;
+				double gamma;
+
+				friend bool operator==(const Parameters& a, const Parameters& b)
+				{
+					return a.color == b.color && a.size == b.size && a.gamma == b.gamma;
+				}
+			};
+
+			explicit Palette(const Parameters& parameters);
+
+			// The palette of the parameters, built only when no recent one matches.
+			static std::shared_ptr<const Palette> find(const Parameters& parameters);
+
+			const Parameters& parameters() const { return m_parameters; }
+			const uint32_t* colors() const { return m_colors.data(); }
+			int size() const { return int(m_colors.size()); }
+
+			// Colours count pixels from their continuous iteration counts, between the two
+			// entries around each count; negative counts are interior and black. Returns
+			// whether any pixel escaped.
+			bool colorize(const float* smooth, uint32_t* pixels, int count) const;
+			// Darkens the pixels closer to the set than BoundaryWidth pixel spacings, by their
+			// distance; negative distances are left as they are.
+			static void shade(const float* distance, uint32_t* pixels, int count);
+			// The mean colour of the samples of a pixel, shaded by their distances unless null.
+			uint32_t average(const float* smooth, const float* distance, int count) const;
+
+			static uint32_t fromWaveLength(double wave, double r, double g, double b, double gamma);
+
+			static constexpr int DefaultSize = 512;
+			static constexpr double DefaultGamma = 0.8;
+			static constexpr int CacheSize = 16;
+			static constexpr uint32_t Black = 0xff000000;
+			static constexpr float BoundaryWidth = 1.0f;
+
+		private:
+			Parameters m_parameters;
+			std::vector<uint32_t> m_colors;
+
+			// The most recently used first.
+			static std::mutex cacheMutex;
+			static std::list<std::shared_ptr<const Palette>> cache;
+		};
+	}
+}
+
+#endif
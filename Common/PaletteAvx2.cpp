@@ -0,0 +1,93 @@
+#include "Palette.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+
+using Mandelbrot::Common::Palette;
+
+namespace
+{
+	template<int Shift>
+	__m256 channel(__m256i color)
+	{
+		return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(color, Shift), _mm256_set1_epi32(0xff)));
+	}
+
+	template<int Shift>
+	__m256i blend(__m256i a, __m256i b, __m256 t)
+	{
+		const __m256 from = channel<Shift>(a);
+		const __m256 to = channel<Shift>(b);
+		return _mm256_slli_epi32(_mm256_cvttps_epi32(_mm256_add_ps(from, _mm256_mul_ps(_mm256_sub_ps(to, from), t))), Shift);
+	}
+}
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		namespace Simd
+		{
+			bool colorizeAvx2(const uint32_t* colors, int mask, const float* smooth, uint32_t* pixels, int count)
+			{
+				constexpr int Lanes = 8;
+
+				const int* table = reinterpret_cast<const int*>(colors);
+				const __m256i indexMask = _mm256_set1_epi32(mask);
+				const __m256i one = _mm256_set1_epi32(1);
+				const __m256i black = _mm256_set1_epi32(int(Palette::Black));
+				alignas(32) float partial[Lanes];
+				alignas(32) uint32_t partialPixels[Lanes];
+				int escaped = 0;
+
+				for (int i = 0; i < count; i += Lanes) {
+					// A partial group goes through a copy, its unused lanes interior.
+					const int lanes = std::min(Lanes, count - i);
+					const float* in = smooth + i;
+					uint32_t* out = pixels + i;
+					if (lanes < Lanes) {
+						for (int k = 0; k < Lanes; ++k)
+							partial[k] = k < lanes ? in[k] : -1.0f;
+						in = partial;
+						out = partialPixels;
+					}
+
+					// Interior counts are negative, their indices are masked into the table all the same.
+					const __m256 s = _mm256_loadu_ps(in);
+					const __m256 inside = _mm256_cmp_ps(s, _mm256_setzero_ps(), _CMP_LT_OQ);
+					const __m256i k = _mm256_cvttps_epi32(s);
+					const __m256 t = _mm256_sub_ps(s, _mm256_cvtepi32_ps(k));
+					const __m256i a = _mm256_i32gather_epi32(table, _mm256_and_si256(k, indexMask), 4);
+					const __m256i b = _mm256_i32gather_epi32(table, _mm256_and_si256(_mm256_add_epi32(k, one), indexMask), 4);
+
+					const __m256i color = _mm256_or_si256(_mm256_or_si256(black, blend<16>(a, b, t)),
+						_mm256_or_si256(blend<8>(a, b, t), blend<0>(a, b, t)));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+						_mm256_blendv_epi8(color, black, _mm256_castps_si256(inside)));
+					escaped |= ~_mm256_movemask_ps(inside) & ((1 << lanes) - 1);
+
+					if (lanes < Lanes)
+						std::copy(partialPixels, partialPixels + lanes, pixels + i);
+				}
+				return escaped != 0;
+			}
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
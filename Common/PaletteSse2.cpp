@@ -0,0 +1,104 @@
+#include "Palette.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+
+using Mandelbrot::Common::Palette;
+
+namespace
+{
+	template<int Shift>
+	__m128 channel(__m128i color)
+	{
+		return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(color, Shift), _mm_set1_epi32(0xff)));
+	}
+
+	template<int Shift>
+	__m128i blend(__m128i a, __m128i b, __m128 t)
+	{
+		const __m128 from = channel<Shift>(a);
+		const __m128 to = channel<Shift>(b);
+		return _mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), t))), Shift);
+	}
+}
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		namespace Simd
+		{
+			bool colorizeSse2(const uint32_t* colors, int mask, const float* smooth, uint32_t* pixels, int count)
+			{
+				constexpr int Lanes = 4;
+
+				const __m128i indexMask = _mm_set1_epi32(mask);
+				const __m128i one = _mm_set1_epi32(1);
+				const __m128i black = _mm_set1_epi32(int(Palette::Black));
+				alignas(16) float partial[Lanes];
+				alignas(16) uint32_t partialPixels[Lanes];
+				alignas(16) int first[Lanes];
+				alignas(16) int second[Lanes];
+				alignas(16) uint32_t from[Lanes];
+				alignas(16) uint32_t to[Lanes];
+				int escaped = 0;
+
+				for (int i = 0; i < count; i += Lanes) {
+					// A partial group goes through a copy, its unused lanes interior.
+					const int lanes = std::min(Lanes, count - i);
+					const float* in = smooth + i;
+					uint32_t* out = pixels + i;
+					if (lanes < Lanes) {
+						for (int k = 0; k < Lanes; ++k)
+							partial[k] = k < lanes ? in[k] : -1.0f;
+						in = partial;
+						out = partialPixels;
+					}
+
+					// Interior counts are negative, their indices are masked into the table all the same.
+					// Without a gather the entries are looked up one by one.
+					const __m128 s = _mm_loadu_ps(in);
+					const __m128 inside = _mm_cmplt_ps(s, _mm_setzero_ps());
+					const __m128i k = _mm_cvttps_epi32(s);
+					const __m128 t = _mm_sub_ps(s, _mm_cvtepi32_ps(k));
+					_mm_store_si128(reinterpret_cast<__m128i*>(first), _mm_and_si128(k, indexMask));
+					_mm_store_si128(reinterpret_cast<__m128i*>(second), _mm_and_si128(_mm_add_epi32(k, one), indexMask));
+					for (int lane = 0; lane < Lanes; ++lane) {
+						from[lane] = colors[first[lane]];
+						to[lane] = colors[second[lane]];
+					}
+					const __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(from));
+					const __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(to));
+
+					const __m128i color = _mm_or_si128(_mm_or_si128(black, blend<16>(a, b, t)),
+						_mm_or_si128(blend<8>(a, b, t), blend<0>(a, b, t)));
+					const __m128i interior = _mm_castps_si128(inside);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+						_mm_or_si128(_mm_and_si128(interior, black), _mm_andnot_si128(interior, color)));
+					escaped |= ~_mm_movemask_ps(inside) & ((1 << lanes) - 1);
+
+					if (lanes < Lanes)
+						std::copy(partialPixels, partialPixels + lanes, pixels + i);
+				}
+				return escaped != 0;
+			}
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,93 @@
+#include "EscapeTimeKernel.h"
+#include "PerturbationKernel.h"
+
+
+using namespace Mandelbrot::Common;
+
+namespace
+{
+	template<bool Derivative>
+	void iteratePerturbation(const ReferenceOrbit& reference, const double* dcx, const double* dcy,
+		double* dzx, double* dzy, double* ddx, double* ddy, int* index, int* iterations, int count,
+		int maxIterations, bool rebaseAtEnd)
+	{
+		const double* rx = reference.x();
+		const double* ry = reference.y();
+		const int last = reference.length() - 1;
+
+		for (int i = 0; i < count; ++i) {
+			const double cx = dcx[i];
+			const double cy = dcy[i];
+			double a = dzx[i];
+			double b = dzy[i];
+			double da = Derivative ? ddx[i] : 0.0;
+			double db = Derivative ? ddy[i] : 0.0;
+			int m = index[i];
+			int numIterations = iterations[i];
+
+			while (numIterations < maxIterations) {
+				if (m == last) {
+					if (!rebaseAtEnd) {
+						m = PerturbationKernel::Glitched;
+						break;
+					}
+					a += rx[m];
+					b += ry[m];
+					m = 0;
+				}
+
+				++numIterations;
+				const double x = rx[m];
+				const double y = ry[m];
+				if constexpr (Derivative) {
+					// dz' = 2 z dz + 1 of z = Z + dz.
+					const double za = x + a;
+					const double zb = y + b;
+					const double da2 = (2 * ((za * da) - (zb * db))) + 1.0;
+					db = 2 * ((za * db) + (zb * da));
+					da = da2;
+				}
+				const double a2 = (2 * ((x * a) - (y * b))) + ((a * a) - (b * b)) + cx;
+				b = (2 * ((x * b) + (y * a))) + (2 * a * b) + cy;
+				a = a2;
+				++m;
+
+				const double za = rx[m] + a;
+				const double zb = ry[m] + b;
+				const double mag = (za * za) + (zb * zb);
+				if (mag > EscapeTimeKernel::Limit)
+					break;
+				if (mag < (a * a) + (b * b)) {
+					a = za;
+					b = zb;
+					m = 0;
+				}
+			}
+
+			dzx[i] = a;
+			dzy[i] = b;
+			if constexpr (Derivative) {
+				ddx[i] = da;
+				ddy[i] = db;
+			}
+			index[i] = m;
+			iterations[i] = numIterations;
+		}
+	}
+}
+
+void PerturbationKernel::iterate(const ReferenceOrbit& reference, const double* dcx, const double* dcy,
+	double* dzx, double* dzy, int* index, int* iterations, int count, int maxIterations,
+	bool rebaseAtEnd)
+{
+	iteratePerturbation<false>(reference, dcx, dcy, dzx, dzy, nullptr, nullptr, index, iterations, count,
+		maxIterations, rebaseAtEnd);
+}
+
+void PerturbationKernel::iterate(const ReferenceOrbit& reference, const double* dcx, const double* dcy,
+	double* dzx, double* dzy, double* ddx, double* ddy, int* index, int* iterations, int count,
+	int maxIterations, bool rebaseAtEnd)
+{
+	iteratePerturbation<true>(reference, dcx, dcy, dzx, dzy, ddx, ddy, index, iterations, count,
+		maxIterations, rebaseAtEnd);
+}
@@ -0,0 +1,41 @@
+#ifndef PERTURBATIONKERNEL_H
+#define PERTURBATIONKERNEL_H
+
+#include "ReferenceOrbit.h"
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// The escape-time iteration of a deep zoom, relative to a reference orbit: every
+		// pixel only carries its distance dz to the reference, iterated in doubles as
+		// dz' = 2 Z dz + dz^2 + dc, so the precision lives in the reference alone.
+		class PerturbationKernel
+		{
+		public:
+			// Advances every orbit z = Z[index] + dz like EscapeTimeKernel::iterate. A fresh
+			// orbit has dz = dc, index 1 and 0 iterations; the orbit has escaped on return if
+			// |Z[index] + dz|^2 > Limit. An orbit which comes closer to 0 than to the reference
+			// is rebased onto its start (z becomes dz at index 0), which keeps dz small.
+			// The reference must hold maxIterations + 2 points unless it escaped. An orbit
+			// running past the end of an escaped reference is imprecise: it is stopped with
+			// its index set to Glitched, unless rebaseAtEnd lets it restart from index 0.
+			static void iterate(const ReferenceOrbit& reference, const double* dcx, const double* dcy,
+				double* dzx, double* dzy, int* index, int* iterations, int count, int maxIterations,
+				bool rebaseAtEnd);
+			// The same, carrying dz/dc of the whole orbit z along in ddx and ddy as
+			// EscapeTimeKernel::iterate does.
+			static void iterate(const ReferenceOrbit& reference, const double* dcx, const double* dcy,
+				double* dzx, double* dzy, double* ddx, double* ddy, int* index, int* iterations, int count,
+				int maxIterations, bool rebaseAtEnd);
+
+			static constexpr int Glitched = -1;
+
+		private:
+			PerturbationKernel() {};
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,229 @@
+#include "PixelCodec.h"
+#include <cstring>
+
+
+using namespace Mandelbrot::Common;
+
+namespace
+{
+	constexpr uint8_t RawMagic[4] = { 'M', 'R', 'G', 'B' };
+	constexpr uint8_t QoiMagic[4] = { 'q', 'o', 'i', 'f' };
+
+	constexpr uint8_t QoiIndex = 0x00;
+	constexpr uint8_t QoiDiff = 0x40;
+	constexpr uint8_t QoiLuma = 0x80;
+	constexpr uint8_t QoiRun = 0xc0;
+	constexpr uint8_t QoiRgb = 0xfe;
+	constexpr uint8_t QoiRgba = 0xff;
+	constexpr uint8_t QoiMask = 0xc0;
+	constexpr int QoiMaxRun = 62;
+
+	inline int qoiHash(uint32_t pixel)
+	{
+		return (((pixel >> 16) & 0xff) * 3 + ((pixel >> 8) & 0xff) * 5 + (pixel & 0xff) * 7 + (pixel >> 24) * 11) % 64;
+	}
+
+	inline uint8_t* writeBigEndian(uint8_t* out, uint32_t value)
+	{
+		*out++ = uint8_t(value >> 24);
+		*out++ = uint8_t(value >> 16);
+		*out++ = uint8_t(value >> 8);
+		*out++ = uint8_t(value);
+		return out;
+	}
+
+	inline uint8_t* writeLittleEndian(uint8_t* out, uint32_t value)
+	{
+		*out++ = uint8_t(value);
+		*out++ = uint8_t(value >> 8);
+		*out++ = uint8_t(value >> 16);
+		*out++ = uint8_t(value >> 24);
+		return out;
+	}
+}
+
+void PixelCodec::writeRawHeader(uint8_t* header, int width, int height, size_t stride)
+{
+	std::memcpy(header, RawMagic, sizeof(RawMagic));
+	header = writeLittleEndian(header + sizeof(RawMagic), uint32_t(width));
+	header = writeLittleEndian(header, uint32_t(height));
+	writeLittleEndian(header, uint32_t(stride));
+}
+
+bool PixelCodec::readRawHeader(const uint8_t* data, size_t size, int& width, int& height, size_t& stride)
+{
+	if (size < RawHeaderSize || std::memcmp(data, RawMagic, sizeof(RawMagic)) != 0)
+		return false;
+
+	const uint32_t w = readLittleEndian(data + 4);
+	const uint32_t h = readLittleEndian(data + 8);
+	const uint32_t s = readLittleEndian(data + 12);
+	if (w == 0 || h == 0 || w > 0x7fffffff || h > 0x7fffffff || s < w
+		|| (size - RawHeaderSize) / 4 / s < h)
+		return false;
+
+	width = int(w);
+	height = int(h);
+	stride = s;
+	return true;
+}
+
+size_t PixelCodec::qoiBound(int width, int height)
+{
+	// Each pixel an RGB chunk at worst.
+	return QoiHeaderSize + (size_t(width) * height * 4) + QoiEndSize;
+}
+
+size_t PixelCodec::encodeQoi(const uint32_t* pixels, int width, int height, size_t stride, uint8_t* result)
+{
+	uint8_t* out = result;
+	std::memcpy(out, QoiMagic, sizeof(QoiMagic));
+	out = writeBigEndian(out + sizeof(QoiMagic), uint32_t(width));
+	out = writeBigEndian(out, uint32_t(height));
+	// RGB, sRGB with linear alpha.
+	*out++ = 3;
+	*out++ = 0;
+
+	// The index starts transparent, no opaque pixel matches it.
+	uint32_t index[64] = {};
+	uint32_t previous = 0xff000000;
+	int run = 0;
+	for (int y = 0; y < height; ++y) {
+		const uint32_t* line = pixels + (y * stride);
+		for (int x = 0; x < width; ++x) {
+			const uint32_t pixel = line[x] | 0xff000000;
+			if (pixel == previous) {
+				if (++run == QoiMaxRun) {
+					*out++ = uint8_t(QoiRun | (run - 1));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0) {
+				*out++ = uint8_t(QoiRun | (run - 1));
+				run = 0;
+			}
+
+			const int hash = qoiHash(pixel);
+			if (index[hash] == pixel) {
+				*out++ = uint8_t(QoiIndex | hash);
+			}
+			else {
+				index[hash] = pixel;
+				// The differences wrap around, as bytes.
+				const int dr = int8_t(((pixel >> 16) & 0xff) - ((previous >> 16) & 0xff));
+				const int dg = int8_t(((pixel >> 8) & 0xff) - ((previous >> 8) & 0xff));
+				const int db = int8_t((pixel & 0xff) - (previous & 0xff));
+				const int drg = dr - dg;
+				const int dbg = db - dg;
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+					*out++ = uint8_t(QoiDiff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+				}
+				else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+					*out++ = uint8_t(QoiLuma | (dg + 32));
+					*out++ = uint8_t(((drg + 8) << 4) | (dbg + 8));
+				}
+				else {
+					*out++ = QoiRgb;
+					*out++ = uint8_t(pixel >> 16);
+					*out++ = uint8_t(pixel >> 8);
+					*out++ = uint8_t(pixel);
+				}
+			}
+			previous = pixel;
+		}
+	}
+	if (run > 0)
+		*out++ = uint8_t(QoiRun | (run - 1));
+
+	std::memset(out, 0, QoiEndSize - 1);
+	out += QoiEndSize - 1;
+	*out++ = 1;
+	return size_t(out - result);
+}
+
+bool PixelCodec::readQoiHeader(const uint8_t* data, size_t size, int& width, int& height)
+{
+	if (size < QoiHeaderSize + QoiEndSize || std::memcmp(data, QoiMagic, sizeof(QoiMagic)) != 0)
+		return false;
+
+	const uint32_t w = readBigEndian(data + 4);
+	const uint32_t h = readBigEndian(data + 8);
+	if (w == 0 || h == 0 || w > 0x7fffffff || h > 0x7fffffff || (data[12] != 3 && data[12] != 4))
+		return false;
+
+	width = int(w);
+	height = int(h);
+	return true;
+}
+
+bool PixelCodec::decodeQoi(const uint8_t* data, size_t size, uint32_t* pixels, size_t stride)
+{
+	int width;
+	int height;
+	if (!readQoiHeader(data, size, width, height))
+		return false;
+
+	const uint8_t* in = data + QoiHeaderSize;
+	const uint8_t* end = data + size - QoiEndSize;
+	uint32_t index[64] = {};
+	uint32_t pixel = 0xff000000;
+	int run = 0;
+	for (int y = 0; y < height; ++y) {
+		uint32_t* line = pixels + (y * stride);
+		for (int x = 0; x < width; ++x) {
+			if (run > 0) {
+				--run;
+			}
+			else {
+				if (in >= end)
+					return false;
+				const uint8_t op = *in++;
+				if (op == QoiRgb || op == QoiRgba) {
+					const size_t length = op == QoiRgb ? 3 : 4;
+					if (size_t(end - in) < length)
+						return false;
+					const uint32_t alpha = op == QoiRgb ? (pixel & 0xff000000) : (uint32_t(in[3]) << 24);
+					pixel = alpha | (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | in[2];
+					in += length;
+				}
+				else if ((op & QoiMask) == QoiIndex) {
+					pixel = index[op];
+				}
+				else if ((op & QoiMask) == QoiDiff) {
+					const uint32_t r = (((pixel >> 16) & 0xff) + ((op >> 4) & 3) - 2) & 0xff;
+					const uint32_t g = (((pixel >> 8) & 0xff) + ((op >> 2) & 3) - 2) & 0xff;
+					const uint32_t b = ((pixel & 0xff) + (op & 3) - 2) & 0xff;
+					pixel = (pixel & 0xff000000) | (r << 16) | (g << 8) | b;
+				}
+				else if ((op & QoiMask) == QoiLuma) {
+					if (in >= end)
+						return false;
+					const uint8_t next = *in++;
+					const int dg = (op & 0x3f) - 32;
+					const uint32_t r = (((pixel >> 16) & 0xff) + dg - 8 + ((next >> 4) & 0x0f)) & 0xff;
+					const uint32_t g = (((pixel >> 8) & 0xff) + dg) & 0xff;
+					const uint32_t b = ((pixel & 0xff) + dg - 8 + (next & 0x0f)) & 0xff;
+					pixel = (pixel & 0xff000000) | (r << 16) | (g << 8) | b;
+				}
+				else {
+					run = op & 0x3f;
+				}
+				index[qoiHash(pixel)] = pixel;
+			}
+			// The frames are opaque.
+			line[x] = pixel | 0xff000000;
+		}
+	}
+	return true;
+}
+
+uint32_t PixelCodec::readBigEndian(const uint8_t* data)
+{
+	return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | data[3];
+}
+
+uint32_t PixelCodec::readLittleEndian(const uint8_t* data)
+{
+	return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+}
@@ -0,0 +1,46 @@
+#ifndef PIXELCODEC_H
+#define PIXELCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// The binary bodies of the rendered frames, shared by the server and its clients.
+		// The pixels are 0xffRRGGBB words, the rows of a QImage::Format_RGB32 image, with a
+		// stride in words. A raw frame is RawHeaderSize bytes, the magic and the width, the
+		// height and the stride as 32 bits little-endian words, followed by its rows as they
+		// are in memory. A QOI frame is the "Quite OK Image" format with 3 channels, lossless
+		// and an order of magnitude faster to write than a deflated PNG.
+		class PixelCodec
+		{
+		public:
+			static void writeRawHeader(uint8_t* header, int width, int height, size_t stride);
+			// False unless a raw frame of a consistent size starts the data.
+			static bool readRawHeader(const uint8_t* data, size_t size, int& width, int& height, size_t& stride);
+
+			// The size of the longest QOI encoding of such a frame.
+			static size_t qoiBound(int width, int height);
+			// Returns the size of the encoding written to result, at most qoiBound() bytes.
+			static size_t encodeQoi(const uint32_t* pixels, int width, int height, size_t stride, uint8_t* result);
+			static bool readQoiHeader(const uint8_t* data, size_t size, int& width, int& height);
+			// False if the data ends before the frame, whose size was read from its header.
+			static bool decodeQoi(const uint8_t* data, size_t size, uint32_t* pixels, size_t stride);
+
+			static constexpr const char* RawContentType = "application/vnd.mandelbrot.rgb32";
+			static constexpr const char* QoiContentType = "image/qoi";
+			static constexpr size_t RawHeaderSize = 16;
+			static constexpr size_t QoiHeaderSize = 14;
+			static constexpr size_t QoiEndSize = 8;
+
+		private:
+			static uint32_t readBigEndian(const uint8_t* data);
+			static uint32_t readLittleEndian(const uint8_t* data);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,51 @@
+#include "EscapeTimeKernel.h"
+#include "ReferenceOrbit.h"
+
+
+using namespace Mandelbrot::Common;
+
+ReferenceOrbit::ReferenceOrbit() :
+	m_escaped(false)
+{
+}
+
+void ReferenceOrbit::reset(const FixedPoint& cx, const FixedPoint& cy, int fractionLimbs)
+{
+	m_cx = cx;
+	m_cx.setFractionLimbs(fractionLimbs);
+	m_cy = cy;
+	m_cy.setFractionLimbs(fractionLimbs);
+	m_zx = FixedPoint();
+	m_zx.setFractionLimbs(fractionLimbs);
+	m_zy = m_zx;
+
+	m_x.assign(1, 0.0);
+	m_y.assign(1, 0.0);
+	m_escaped = false;
+}
+
+void ReferenceOrbit::extend(int maxIterations)
+{
+	const size_t length = size_t(maxIterations) + 2;
+	if (m_escaped || m_x.size() >= length)
+		return;
+
+	m_x.reserve(length);
+	m_y.reserve(length);
+	while (m_x.size() < length) {
+		const FixedPoint xy = m_zx * m_zy;
+		m_zx = (m_zx * m_zx) - (m_zy * m_zy) + m_cx;
+		m_zy = xy + xy + m_cy;
+
+		const double x = m_zx.toDouble();
+		const double y = m_zy.toDouble();
+		m_x.push_back(x);
+		m_y.push_back(y);
+
+		// The fixed point integer part is only safe for a bounded orbit.
+		if ((x * x) + (y * y) > EscapeTimeKernel::Limit) {
+			m_escaped = true;
+			break;
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef REFERENCEORBIT_H
+#define REFERENCEORBIT_H
+
+#include "FixedPoint.h"
+#include <vector>
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// The orbit Z0 = 0, Zn+1 = Zn^2 + C of a single point, computed in fixed point and
+		// kept rounded to doubles for the perturbation kernel. It grows on demand, so the
+		// passes of a frame only pay for the iterations added by their higher budget.
+		class ReferenceOrbit
+		{
+		public:
+			ReferenceOrbit();
+
+			// Starts over for the point C, iterated with the given fraction limbs.
+			void reset(const FixedPoint& cx, const FixedPoint& cy, int fractionLimbs);
+			// Grows the orbit to maxIterations + 2 points unless it escapes before.
+			void extend(int maxIterations);
+
+			int length() const { return int(m_x.size()); }
+			bool isEscaped() const { return m_escaped; }
+			const double* x() const { return m_x.data(); }
+			const double* y() const { return m_y.data(); }
+
+		private:
+			FixedPoint m_cx;
+			FixedPoint m_cy;
+			FixedPoint m_zx;
+			FixedPoint m_zy;
+			std::vector<double> m_x;
+			std::vector<double> m_y;
+			bool m_escaped;
+		};
+	}
+}
+
+#endif
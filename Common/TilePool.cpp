@@ -0,0 +1,145 @@
+#include "TilePool.h"
+#include <algorithm>
+
+
+using namespace Mandelbrot::Common;
+
+int TilePool::defaultThreadCount = 0;
+thread_local int TilePool::threadPriority = 0;
+
+TilePool::TilePool(int threads) :
+	m_next(0),
+	m_added(0),
+	m_stop(false)
+{
+	if (threads <= 0)
+		threads = int(std::thread::hardware_concurrency());
+	threads = std::max(threads, 1);
+
+	for (int i = 0; i < threads; ++i)
+		m_threads.emplace_back(&TilePool::work, this, i);
+}
+
+TilePool::~TilePool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& thread : m_threads)
+		thread.join();
+}
+
+bool TilePool::run(int count, const Task& task, const Cancelled& cancelled)
+{
+	if (count > 0) {
+		const int workers = threadCount();
+		auto batch = std::make_shared<Batch>();
+		batch->task = task;
+		batch->cancelled = cancelled;
+		batch->queues.reset(new Queue[workers]);
+		batch->priority = threadPriority;
+		batch->unclaimed = count;
+		batch->pending = count;
+		for (int w = 0; w < workers; ++w) {
+			const int first = int((long long)count * w / workers);
+			const int last = int((long long)count * (w + 1) / workers);
+			for (int i = first; i < last; ++i)
+				batch->queues[w].tasks.push_back(i);
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_batches.push_back(batch);
+		++m_added;
+		m_wake.notify_all();
+		m_done.wait(lock, [&batch] { return batch->pending == 0; });
+		m_batches.erase(std::find(m_batches.begin(), m_batches.end(), batch));
+	}
+
+	return !(cancelled && cancelled());
+}
+
+TilePool& TilePool::instance()
+{
+	static TilePool pool(defaultThreadCount);
+	return pool;
+}
+
+void TilePool::work(int worker)
+{
+	std::shared_ptr<Batch> batch;
+	unsigned added = 0;
+	for (;;) {
+		// The batch is kept, without the pool's lock, until its queues are drained or
+		// another one is added.
+		int index;
+		if (!batch || m_added != added || !take(*batch, worker, index)) {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			for (;;) {
+				if (m_stop)
+					return;
+
+				added = m_added;
+				batch = claim();
+				if (batch && take(*batch, worker, index))
+					break;
+				if (!batch)
+					m_wake.wait(lock);
+			}
+		}
+
+		if (!(batch->cancelled && batch->cancelled()))
+			batch->task(index);
+		finish(*batch);
+	}
+}
+
+std::shared_ptr<TilePool::Batch> TilePool::claim()
+{
+	const size_t count = m_batches.size();
+	size_t chosen = count;
+	for (size_t k = 0; k < count; ++k) {
+		const size_t i = (m_next + k) % count;
+		if (m_batches[i]->unclaimed > 0 && (chosen == count || m_batches[i]->priority > m_batches[chosen]->priority))
+			chosen = i;
+	}
+	if (chosen == count)
+		return nullptr;
+
+	m_next = chosen + 1;
+	return m_batches[chosen];
+}
+
+bool TilePool::take(Batch& batch, int worker, int& index)
+{
+	const int workers = threadCount();
+	for (int k = 0; k < workers; ++k) {
+		Queue& queue = batch.queues[(worker + k) % workers];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			// The own queue is consumed from the front, the victims' ones from the back.
+			if (k == 0) {
+				index = queue.tasks.front();
+				queue.tasks.pop_front();
+			}
+			else {
+				index = queue.tasks.back();
+				queue.tasks.pop_back();
+			}
+			--batch.unclaimed;
+			return true;
+		}
+	}
+	return false;
+}
+
+void TilePool::finish(Batch& batch)
+{
+	if (--batch.pending == 0) {
+		// Under the lock, for run() not to miss the notification between its check and its wait.
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_done.notify_all();
+	}
+}
@@ -0,0 +1,90 @@
+#ifndef TILEPOOL_H
+#define TILEPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Mandelbrot
+{
+	namespace Common
+	{
+		// A fixed set of worker threads running batches of independent tasks. Every worker
+		// owns a deque seeded with a contiguous run of the batch; it pops from its front
+		// and, once empty, steals from the back of the others, so a few expensive tiles
+		// don't leave the rest of the machine idle; the pool's lock is only taken to pick a
+		// batch once they are drained. Batches run from several threads share the workers,
+		// those of the highest priority first and the others in turns, and a new batch makes
+		// every worker pick again.
+		class TilePool
+		{
+		public:
+			typedef std::function<void(int)> Task;
+			typedef std::function<bool()> Cancelled;
+
+			explicit TilePool(int threads = 0);
+			~TilePool();
+
+			TilePool(const TilePool&) = delete;
+			TilePool& operator=(const TilePool&) = delete;
+
+			int threadCount() const { return int(m_threads.size()); }
+
+			// Runs task(0) ... task(count - 1) and blocks until all of them have finished.
+			// Tasks not yet started when cancelled() turns true are dropped; returns false then.
+			bool run(int count, const Task& task, const Cancelled& cancelled);
+
+			// Of the batches run from the calling thread from now on, 0 by default.
+			static void setPriority(int priority) { threadPriority = priority; }
+
+			// The process wide pool, created on the first use with the configured size.
+			static TilePool& instance();
+			static void setDefaultThreadCount(int threads) { defaultThreadCount = threads; }
+
+		private:
+			struct Queue
+			{
+				std::mutex mutex;
+				std::deque<int> tasks;
+			};
+
+			struct Batch
+			{
+				Task task;
+				Cancelled cancelled;
+				std::unique_ptr<Queue[]> queues;
+				int priority;
+				// The tasks no worker has taken yet, and those not finished.
+				std::atomic<int> unclaimed;
+				std::atomic<int> pending;
+			};
+
+			void work(int worker);
+			std::shared_ptr<Batch> claim();
+			bool take(Batch& batch, int worker, int& index);
+			void finish(Batch& batch);
+
+			std::vector<std::thread> m_threads;
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+			std::condition_variable m_done;
+			std::vector<std::shared_ptr<Batch>> m_batches;
+			// Where the turns among the batches of the same priority resume.
+			size_t m_next;
+			// Counts the batches added, for the workers to notice them.
+			std::atomic<unsigned> m_added;
+			bool m_stop;
+
+			static int defaultThreadCount;
+			static thread_local int threadPriority;
+		};
+	}
+}
+
+#endif
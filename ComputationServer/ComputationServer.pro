@@ -6,12 +6,24 @@ TEMPLATE = app
 
 VERSION = 1.0.0.0
 
-HEADERS = Server.h RenderThread.h HttpProtocol.h
+INCLUDEPATH += ../Common
 
-SOURCES = main.cpp Server.cpp RenderThread.cpp HttpProtocol.cpp
+HEADERS = Server.h Connection.h RenderScheduler.h RenderThread.h HttpProtocol.h ImageCodec.h ResponseWriter.h TileCache.h TileStore.h \
+	../Common/DoubleDouble.h ../Common/EscapeTimeFormula.h ../Common/EscapeTimeKernel.h ../Common/EscapeTimeKernelSimd.h \
+	../Common/FixedPoint.h ../Common/FrameRenderer.h ../Common/Palette.h ../Common/PerturbationKernel.h ../Common/PixelCodec.h \
+	../Common/ReferenceOrbit.h ../Common/TilePool.h
+
+SOURCES = main.cpp Server.cpp Connection.cpp RenderScheduler.cpp RenderThread.cpp HttpProtocol.cpp ImageCodec.cpp ResponseWriter.cpp TileCache.cpp TileStore.cpp \
+	../Common/EscapeTimeKernel.cpp ../Common/EscapeTimeKernelSse2.cpp ../Common/EscapeTimeKernelAvx2.cpp ../Common/EscapeTimeKernelAvx512.cpp \
+	../Common/FixedPoint.cpp ../Common/FrameRenderer.cpp \
+	../Common/Palette.cpp ../Common/PaletteSse2.cpp ../Common/PaletteAvx2.cpp ../Common/PerturbationKernel.cpp ../Common/PixelCodec.cpp \
+	../Common/ReferenceOrbit.cpp ../Common/TilePool.cpp
 
 CONFIG += debug
 
+# The vectorized kernels must round like the scalar one, no fused multiply-add.
+gcc: QMAKE_CXXFLAGS += -ffp-contract=off
+
 # install
 target.path = ./ComputationServer
 INSTALLS += target
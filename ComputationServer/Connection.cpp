@@ -0,0 +1,210 @@
+#include "Connection.h"
+#include "HttpProtocol.h"
+#include "ResponseWriter.h"
+#include <QAbstractSocket>
+#include <QByteArray>
+#include <QImage>
+#include <QObject>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtGlobal>
+#include <algorithm>
+
+
+using namespace Mandelbrot::ComputationServer;
+
+qintptr Connection::lastId = 0;
+int Connection::idleTimeout = Connection::DefaultIdleTimeout;
+int Connection::maxRequests = Connection::DefaultMaxRequests;
+
+Connection::Connection(QTcpSocket* socket, QObject* parent) :
+	QObject(parent),
+	m_socket(socket),
+	m_writer(socket),
+	m_scanned(0),
+	m_skipped(0),
+	m_id(++lastId),
+	m_state(State::Reading),
+	m_keepAlive(false),
+	m_served(0)
+{
+	m_socket->setParent(this);
+	// The requests sent ahead of their turn are left to the socket, up to this.
+	m_socket->setReadBufferSize(MaxHeaderSize);
+	m_timer.setSingleShot(true);
+	connect(m_socket, &QIODevice::readyRead, this, &Connection::receive);
+	connect(m_socket, &QIODevice::bytesWritten, this, [this]() {
+		if (m_state == State::Closing)
+			m_timer.start(WriteTimeout);
+		});
+	connect(&m_writer, &ResponseWriter::progressed, this, [this]() { m_timer.start(WriteTimeout); });
+	connect(&m_writer, &ResponseWriter::finished, this, &Connection::complete);
+	connect(m_socket, &QAbstractSocket::disconnected, this, [this]() { emit closed(this); });
+	connect(&m_timer, &QTimer::timeout, this, &Connection::expire);
+	m_timer.start(ReadTimeout);
+
+	// The bytes which came with the connection don't signal again.
+	if (m_socket->bytesAvailable() > 0)
+		QTimer::singleShot(0, this, &Connection::receive);
+}
+
+void Connection::reply(const QByteArray& header, const QByteArray& body)
+{
+	if (beginReply())
+		m_writer.start(header, body);
+}
+
+void Connection::reply(const QByteArray& header, const QImage& image)
+{
+	if (beginReply())
+		m_writer.start(header, image);
+}
+
+void Connection::receive()
+{
+	if (m_state != State::Reading)
+		return;
+
+	m_buffer.append(m_socket->readAll());
+
+	// The body of the request before is not used, nothing but GET is implemented.
+	const qsizetype skipped = std::min(m_skipped, m_buffer.size());
+	if (skipped > 0) {
+		m_buffer.remove(0, skipped);
+		m_skipped -= skipped;
+	}
+
+	const qsizetype end = headerEnd(m_buffer, m_scanned);
+	if (end < 0) {
+		if (m_buffer.size() > MaxHeaderSize)
+			reject(HttpProtocol::StatusCode::REQUEST_HEADER_FIELDS_TOO_LARGE,
+				HttpProtocol::ReasonPhrase::REQUEST_HEADER_FIELDS_TOO_LARGE);
+		return;
+	}
+
+	const QByteArray header = m_buffer.left(end);
+	const qsizetype length = contentLength(header);
+	if (length < 0) {
+		reject(HttpProtocol::StatusCode::BAD_REQUEST, HttpProtocol::ReasonPhrase::BAD_REQUEST);
+		return;
+	}
+
+	m_buffer.remove(0, end);
+	m_scanned = 0;
+	m_skipped = length;
+	m_keepAlive = keepAliveFor(header, m_served);
+	m_timer.stop();
+	m_state = State::Dispatched;
+	emit requestReceived(this, header);
+}
+
+void Connection::expire()
+{
+	switch (m_state) {
+	case State::Reading:
+		// Nothing asked, nothing to answer.
+		if (m_buffer.isEmpty()) {
+			m_state = State::Closing;
+			m_timer.start(WriteTimeout);
+			m_socket->disconnectFromHost();
+		}
+		else
+			reject(HttpProtocol::StatusCode::REQUEST_TIMEOUT, HttpProtocol::ReasonPhrase::REQUEST_TIMEOUT);
+		break;
+	case State::Writing:
+	case State::Closing:
+		m_socket->abort();
+		break;
+	default:
+		break;
+	}
+}
+
+void Connection::complete()
+{
+	if (m_keepAlive) {
+		// The next request may be waiting already.
+		m_state = State::Reading;
+		m_timer.start(idleTimeout);
+		QTimer::singleShot(0, this, &Connection::receive);
+	}
+	else {
+		// Closed once the last chunk has been written.
+		m_state = State::Closing;
+		m_timer.start(WriteTimeout);
+		m_socket->disconnectFromHost();
+	}
+}
+
+void Connection::reject(int statusCode, const char* reasonPhrase)
+{
+	// Where the next request would start is unknown.
+	m_timer.stop();
+	m_state = State::Dispatched;
+	m_keepAlive = false;
+	emit requestRejected(this, statusCode, reasonPhrase);
+}
+
+qsizetype Connection::headerEnd(QByteArray& buffer, qsizetype& scanned)
+{
+	// Line by line from the last incomplete one, a line is ended by LF or CR LF.
+	for (;;) {
+		const qsizetype newline = buffer.indexOf('\n', scanned);
+		if (newline < 0)
+			return -1;
+
+		const qsizetype length = newline - scanned;
+		if (length == 0 || (length == 1 && buffer[scanned] == '\r')) {
+			if (scanned > 0)
+				return newline + 1;
+			// Blank lines before a request line are ignored.
+			buffer.remove(0, newline + 1);
+			continue;
+		}
+		scanned = newline + 1;
+	}
+}
+
+QByteArray Connection::field(const QByteArray& header, const char* name)
+{
+	const QByteArray prefix = QByteArray(name).toLower() + HttpProtocol::DELIMITER_FIELD;
+	for (const QByteArray& line : header.split('\n')) {
+		if (line.toLower().startsWith(prefix))
+			return line.mid(prefix.size()).trimmed();
+	}
+	return QByteArray();
+}
+
+qsizetype Connection::contentLength(const QByteArray& header)
+{
+	const QByteArray value = field(header, HttpProtocol::HeaderField::Name::CONTENT_LENGTH);
+	if (value.isNull())
+		return 0;
+
+	bool ok = false;
+	const qsizetype length = value.toLongLong(&ok);
+	return ok && length >= 0 ? length : -1;
+}
+
+bool Connection::keepAliveFor(const QByteArray& header, int served)
+{
+	// Persistent by default since HTTP/1.1, asked for before.
+	const QByteArray requestLine = header.left(header.indexOf('\n')).trimmed();
+	const QByteArray connection = field(header, HttpProtocol::HeaderField::Name::CONNECTION).toLower();
+	const bool persistent = requestLine.endsWith(HttpProtocol::VERSION)
+		? !connection.contains(HttpProtocol::HeaderField::Value::CONNECTION_CLOSE)
+		: connection.contains(HttpProtocol::HeaderField::Value::CONNECTION_KEEP_ALIVE);
+	return persistent && served + 1 < maxRequests;
+}
+
+bool Connection::beginReply()
+{
+	if (m_state != State::Dispatched)
+		return false;
+
+	// Given up on when the client reads nothing for a while.
+	++m_served;
+	m_state = State::Writing;
+	m_timer.start(WriteTimeout);
+	return true;
+}
@@ -0,0 +1,109 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include "ResponseWriter.h"
+#include <QByteArray>
+#include <QImage>
+#include <QObject>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtGlobal>
+
+
+namespace Mandelbrot
+{
+	namespace ComputationServer
+	{
+		// A client's socket driven by its signals, nothing waits on it. The bytes are gathered
+		// until the blank line ending the header, the request is handed over then, and its
+		// response is written back. The connection is kept for the next requests unless the
+		// client or the limit of requests closes it; those sent ahead wait in the socket until
+		// the response before is written, so the responses keep the order of the requests.
+		// A request left incomplete, an idle connection or a response left unread is given up
+		// on by a timer.
+		class Connection : public QObject
+		{
+			Q_OBJECT
+
+		public:
+			enum class State
+			{
+				Reading,
+				Dispatched,
+				Writing,
+				Closing
+			};
+
+			// Takes the ownership of the socket.
+			explicit Connection(QTcpSocket* socket, QObject* parent = nullptr);
+
+			// Unique in the process, unlike the socket descriptors which are reused.
+			qintptr id() const { return m_id; }
+			State state() const { return m_state; }
+			// Whether the connection stays open after the response to the dispatched request.
+			bool isKeepAlive() const { return m_keepAlive; }
+			// The requests answered so far.
+			int served() const { return m_served; }
+
+			// The response to the dispatched request, its body sent from where it is.
+			void reply(const QByteArray& header, const QByteArray& body = QByteArray());
+			void reply(const QByteArray& header, const QImage& image);
+
+			// The parsing of the requests, on its own. The offset past the blank line ending the
+			// header, or -1 while it hasn't arrived; the search resumes from scanned.
+			static qsizetype headerEnd(QByteArray& buffer, qsizetype& scanned);
+			// -1 for an invalid length, 0 without one.
+			static qsizetype contentLength(const QByteArray& header);
+			// Whether the connection stays open after the response, with that many answered before.
+			static bool keepAliveFor(const QByteArray& header, int served);
+
+			static void setIdleTimeout(int ms) { idleTimeout = ms; }
+			static int idleTimeoutMs() { return idleTimeout; }
+			static void setMaxRequests(int n) { maxRequests = n; }
+			static int maxRequestCount() { return maxRequests; }
+
+			static constexpr int ReadTimeout = 3000;
+			static constexpr int WriteTimeout = 30000;
+			static constexpr int DefaultIdleTimeout = 5000;
+			static constexpr int DefaultMaxRequests = 100;
+			static constexpr qsizetype MaxHeaderSize = 16384;
+
+		signals:
+			// The header with its request line, up to and including the blank line.
+			void requestReceived(Connection* connection, const QByteArray& header);
+			// A request which can't be read, to be answered with this status.
+			void requestRejected(Connection* connection, int statusCode, const char* reasonPhrase);
+			void closed(Connection* connection);
+
+		private slots:
+			void receive();
+			void expire();
+			void complete();
+
+		private:
+			void reject(int statusCode, const char* reasonPhrase);
+			// The value of the first field of the name, null without it.
+			static QByteArray field(const QByteArray& header, const char* name);
+			bool beginReply();
+
+			QTcpSocket* m_socket;
+			ResponseWriter m_writer;
+			QTimer m_timer;
+			QByteArray m_buffer;
+			// Where the search for the blank line resumes.
+			qsizetype m_scanned;
+			// The bytes of a body still to be dropped.
+			qsizetype m_skipped;
+			qintptr m_id;
+			State m_state;
+			bool m_keepAlive;
+			int m_served;
+
+			static qintptr lastId;
+			static int idleTimeout;
+			static int maxRequests;
+		};
+	}
+}
+
+#endif
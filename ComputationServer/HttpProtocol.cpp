@@ -15,6 +15,8 @@ const int HttpProtocol::StatusCode::OK = 200;
 const int HttpProtocol::StatusCode::BAD_REQUEST = 400;
 const int HttpProtocol::StatusCode::NOT_FOUND = 404;
 const int HttpProtocol::StatusCode::NOT_ACCEPTABLE = 406;
+const int HttpProtocol::StatusCode::REQUEST_TIMEOUT = 408;
+const int HttpProtocol::StatusCode::REQUEST_HEADER_FIELDS_TOO_LARGE = 431;
 const int HttpProtocol::StatusCode::INTERNAL_SERVER_ERROR = 500;
 const int HttpProtocol::StatusCode::NOT_IMPLEMENTED = 501;
 const int HttpProtocol::StatusCode::SERVICE_UNAVAILABLE = 503;
@@ -24,6 +26,8 @@ const char* HttpProtocol::ReasonPhrase::OK = "OK";
 const char* HttpProtocol::ReasonPhrase::BAD_REQUEST = "Bad Request";
 const char* HttpProtocol::ReasonPhrase::NOT_FOUND = "Not Found";
 const char* HttpProtocol::ReasonPhrase::NOT_ACCEPTABLE = "Not Acceptable";
+const char* HttpProtocol::ReasonPhrase::REQUEST_TIMEOUT = "Request Timeout";
+const char* HttpProtocol::ReasonPhrase::REQUEST_HEADER_FIELDS_TOO_LARGE = "Request Header Fields Too Large";
 const char* HttpProtocol::ReasonPhrase::INTERNAL_SERVER_ERROR = "Internal Server Error";
 const char* HttpProtocol::ReasonPhrase::NOT_IMPLEMENTED = "Not Implemented";
 const char* HttpProtocol::ReasonPhrase::SERVICE_UNAVAILABLE = "Service Unavailable";
@@ -39,6 +43,7 @@ const char* HttpProtocol::HeaderField::Name::SERVER = "Server";
 const char* HttpProtocol::HeaderField::Name::ETAG = "ETag";
 const char* HttpProtocol::HeaderField::Name::INFO = "Info";
 const char* HttpProtocol::HeaderField::Name::SCALE_FACTOR = "Scale-Factor";
+const char* HttpProtocol::HeaderField::Name::REGION = "Region";
 
 const char* HttpProtocol::HeaderField::Value::ACCEPT = "text/plain";
 const char* HttpProtocol::HeaderField::Value::CONNECTION_CLOSE = "close";
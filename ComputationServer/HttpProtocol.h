@@ -37,6 +37,10 @@ namespace Mandelbrot
 
 				static const int NOT_ACCEPTABLE;
 
+				static const int REQUEST_TIMEOUT;
+
+				static const int REQUEST_HEADER_FIELDS_TOO_LARGE;
+
 				static const int INTERNAL_SERVER_ERROR;
 
 				static const int NOT_IMPLEMENTED;
@@ -57,6 +61,10 @@ namespace Mandelbrot
 
 				static const char* NOT_ACCEPTABLE;
 
+				static const char* REQUEST_TIMEOUT;
+
+				static const char* REQUEST_HEADER_FIELDS_TOO_LARGE;
+
 				static const char* INTERNAL_SERVER_ERROR;
 
 				static const char* NOT_IMPLEMENTED;
@@ -93,6 +101,8 @@ namespace Mandelbrot
 					static const char* INFO;
 
 					static const char* SCALE_FACTOR;
+
+					static const char* REGION;
 				};
 
 				class Value
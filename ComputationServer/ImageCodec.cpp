@@ -0,0 +1,140 @@
+#include "HttpProtocol.h"
+#include "ImageCodec.h"
+#include "PixelCodec.h"
+#include <QBuffer>
+#include <QByteArray>
+#include <QImage>
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <Qt>
+#include <array>
+#include <cstdint>
+
+
+using namespace Mandelbrot::ComputationServer;
+using Mandelbrot::Common::PixelCodec;
+
+bool ImageCodec::negotiate(const QString& accept, Format& format)
+{
+	if (accept.trimmed().isEmpty()) {
+		format = Format::Base64Bmp;
+		return true;
+	}
+
+	// The quality of each format named, of "image/*" and of "*/*"; -1 when not given.
+	static const std::array<Format, 5> preferred = { Format::Qoi, Format::Raw, Format::Png, Format::Jpeg, Format::Base64Bmp };
+	std::array<double, 5> named;
+	named.fill(-1.0);
+	double anyImage = -1.0;
+	double any = -1.0;
+	for (const QString& element : accept.split(',')) {
+		const QStringList parameters = element.split(';');
+		const QString type = parameters[0].trimmed().toLower();
+		double quality = 1.0;
+		for (qsizetype i = 1; i < parameters.size(); ++i) {
+			const QString parameter = parameters[i].trimmed();
+			if (parameter.startsWith(QStringLiteral("q="), Qt::CaseInsensitive)) {
+				bool ok = false;
+				quality = parameter.sliced(2).toDouble(&ok);
+				if (!ok)
+					quality = 0.0;
+			}
+		}
+
+		if (type == QStringLiteral("*/*"))
+			any = quality;
+		else if (type == QStringLiteral("image/*"))
+			anyImage = quality;
+		for (size_t i = 0; i < preferred.size(); ++i) {
+			if (type == QString::fromLatin1(contentType(preferred[i])))
+				named[i] = quality;
+		}
+	}
+
+	// The highest quality, the order above between equal ones. A wildcard only applies
+	// to the formats not named: "image/*" picks the first image format left, QOI unless
+	// it is named, "*/*" alone the text of old clients.
+	double best = 0.0;
+	for (size_t i = 0; i < preferred.size(); ++i) {
+		if (named[i] > best) {
+			best = named[i];
+			format = preferred[i];
+		}
+	}
+	for (size_t i = 0; i < preferred.size() && anyImage > best; ++i) {
+		if (named[i] < 0.0 && QByteArray(contentType(preferred[i])).startsWith("image/")) {
+			best = anyImage;
+			format = preferred[i];
+		}
+	}
+	if (named[4] < 0.0 && any > best) {
+		best = any;
+		format = Format::Base64Bmp;
+	}
+	if (best > 0.0)
+		return true;
+
+	// The clients before the binary bodies asked for anything, they keep the text unless
+	// it is refused.
+	format = Format::Base64Bmp;
+	return (named[4] < 0.0 ? any : named[4]) != 0.0;
+}
+
+const char* ImageCodec::contentType(Format format)
+{
+	switch (format) {
+	case Format::Raw:
+		return PixelCodec::RawContentType;
+	case Format::Qoi:
+		return PixelCodec::QoiContentType;
+	case Format::Png:
+		return HttpProtocol::HeaderField::Value::CONTENT_TYPE_IMAGE_PNG;
+	case Format::Jpeg:
+		return HttpProtocol::HeaderField::Value::CONTENT_TYPE_IMAGE_JPEG;
+	default:
+		return HttpProtocol::HeaderField::Value::CONTENT_TYPE_TEXT_PLAIN;
+	}
+}
+
+QByteArray ImageCodec::encode(const QImage& image, Format format)
+{
+	const int width = image.width();
+	const int height = image.height();
+	const size_t stride = size_t(image.bytesPerLine()) / sizeof(uint32_t);
+	const uint32_t* pixels = reinterpret_cast<const uint32_t*>(image.constBits());
+	QByteArray body;
+	switch (format) {
+	case Format::Raw:
+		body = rawHeader(image);
+		break;
+	case Format::Qoi: {
+		body = QByteArray(qsizetype(PixelCodec::qoiBound(width, height)), Qt::Uninitialized);
+		body.truncate(qsizetype(PixelCodec::encodeQoi(pixels, width, height, stride, reinterpret_cast<uint8_t*>(body.data()))));
+		break;
+	}
+	case Format::Png:
+	case Format::Jpeg: {
+		QBuffer buffer(&body);
+		buffer.open(QIODevice::WriteOnly);
+		image.save(&buffer, format == Format::Png ? "PNG" : "JPG", format == Format::Png ? PngQuality : JpegQuality);
+		break;
+	}
+	default: {
+		QByteArray bitmap;
+		QBuffer buffer(&bitmap);
+		image.save(&buffer, "BMP");
+		body = bitmap.toBase64();
+		break;
+	}
+	}
+	return body;
+}
+
+QByteArray ImageCodec::rawHeader(const QImage& image)
+{
+	QByteArray header(qsizetype(PixelCodec::RawHeaderSize), Qt::Uninitialized);
+	PixelCodec::writeRawHeader(reinterpret_cast<uint8_t*>(header.data()), image.width(), image.height(),
+		size_t(image.bytesPerLine()) / sizeof(uint32_t));
+	return header;
+}
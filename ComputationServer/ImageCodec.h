@@ -0,0 +1,46 @@
+#ifndef IMAGECODEC_H
+#define IMAGECODEC_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+
+
+namespace Mandelbrot
+{
+	namespace ComputationServer
+	{
+		// The bodies of the rendered frames, in the format the Accept header of the request
+		// prefers. Raw pixels cost nothing to write, QOI is lossless and quick, PNG deflated
+		// at the fastest level is smaller still, JPEG suits previews. Without an Accept
+		// header, with only "*/*" or with none of the formats acceptable, the frame is a
+		// base64 BMP as text, as for the clients before the binary bodies; only a header
+		// refusing text/plain, or "*/*" without naming it, with q=0 gets none.
+		class ImageCodec
+		{
+		public:
+			enum class Format
+			{
+				Base64Bmp,
+				Raw,
+				Qoi,
+				Png,
+				Jpeg
+			};
+
+			// False if text/plain is refused and none of the other formats is acceptable.
+			static bool negotiate(const QString& accept, Format& format);
+			static const char* contentType(Format format);
+			// The image is a QImage::Format_RGB32 one. Of a raw frame only its header, the
+			// rows are sent from the image's own memory, padding included.
+			static QByteArray encode(const QImage& image, Format format);
+			static QByteArray rawHeader(const QImage& image);
+
+			// Deflate level 1 as Qt maps the quality of a PNG.
+			static constexpr int PngQuality = 85;
+			static constexpr int JpegQuality = 85;
+		};
+	}
+}
+
+#endif
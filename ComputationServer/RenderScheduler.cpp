@@ -0,0 +1,109 @@
+#include "RenderScheduler.h"
+#include "RenderThread.h"
+#include <QImage>
+#include <QMutexLocker>
+#include <QObject>
+#include <QRect>
+#include <QSize>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+
+using namespace Mandelbrot::ComputationServer;
+
+int RenderScheduler::threadCount = RenderScheduler::DefaultThreadCount;
+
+RenderScheduler::RenderScheduler(QObject* parent) :
+	QObject(parent),
+	m_runningExports(0),
+	m_stop(false)
+{
+}
+
+RenderScheduler::~RenderScheduler()
+{
+	m_mutex.lock();
+	m_stop = true;
+	for (const Job& job : m_running)
+		*job.cancelled = true;
+	m_condition.wakeAll();
+	m_mutex.unlock();
+
+	// Each one waits for its thread to end.
+	m_threads.clear();
+}
+
+void RenderScheduler::submit(Job job)
+{
+	job.cancelled = std::make_shared<std::atomic<bool>>(false);
+
+	QMutexLocker locker(&m_mutex);
+	if (m_threads.empty()) {
+		for (int i = 0; i < std::max(threadCount, 2); ++i) {
+			m_threads.push_back(std::make_unique<RenderThread>(*this));
+			connect(m_threads.back().get(), &RenderThread::renderedImage, this, &RenderScheduler::renderedImage);
+			m_threads.back()->start(QThread::LowPriority);
+		}
+	}
+
+	if (job.priority == Priority::Interactive)
+		m_interactive.append(job);
+	else
+		m_exports.append(job);
+	// Not any thread may take an export.
+	m_condition.wakeAll();
+}
+
+void RenderScheduler::cancel(qintptr descriptor)
+{
+	QMutexLocker locker(&m_mutex);
+	const auto sameDescriptor = [descriptor](const Job& job) { return job.descriptor == descriptor; };
+	m_interactive.removeIf(sameDescriptor);
+	m_exports.removeIf(sameDescriptor);
+	for (const Job& job : m_running) {
+		if (job.descriptor == descriptor)
+			*job.cancelled = true;
+	}
+}
+
+RenderScheduler::Priority RenderScheduler::priorityFor(QSize resultSize, double devicePixelRatio, const QRect& region)
+{
+	const QSize size = region.isEmpty() ? resultSize : region.size();
+	const double pixels = double(size.width()) * size.height() * devicePixelRatio * devicePixelRatio;
+	return pixels > InteractivePixels ? Priority::Export : Priority::Interactive;
+}
+
+bool RenderScheduler::take(Job& job)
+{
+	QMutexLocker locker(&m_mutex);
+	for (;;) {
+		if (m_stop)
+			return false;
+
+		if (!m_interactive.isEmpty()) {
+			job = m_interactive.takeFirst();
+			break;
+		}
+		if (!m_exports.isEmpty() && m_runningExports < int(m_threads.size()) - 1) {
+			job = m_exports.takeFirst();
+			++m_runningExports;
+			break;
+		}
+		m_condition.wait(&m_mutex);
+	}
+
+	m_running.append(job);
+	return true;
+}
+
+void RenderScheduler::finish(const Job& job)
+{
+	QMutexLocker locker(&m_mutex);
+	m_running.removeIf([&job](const Job& running) { return running.cancelled == job.cancelled; });
+	if (job.priority == Priority::Export) {
+		--m_runningExports;
+		m_condition.wakeAll();
+	}
+}
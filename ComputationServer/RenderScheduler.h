@@ -0,0 +1,105 @@
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QRect>
+#include <QSize>
+#include <QWaitCondition>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+
+namespace Mandelbrot
+{
+	namespace ComputationServer
+	{
+		class RenderThread;
+
+		// The requests of all the clients as jobs on a bounded set of render threads. The jobs
+		// running at once share the tile pool tile by tile, the interactive ones first; exports
+		// never take the last free thread, so a preview waits for none of them.
+		class RenderScheduler : public QObject
+		{
+			Q_OBJECT
+
+		public:
+			enum class Priority
+			{
+				Export,
+				Interactive
+			};
+
+			struct Job
+			{
+				// The connection the image goes to.
+				qintptr descriptor;
+				Common::FixedPoint centerX;
+				Common::FixedPoint centerY;
+				double scaleFactor;
+				QSize resultSize;
+				double devicePixelRatio;
+				QRgb color;
+				Common::FrameRenderer::Fractal fractal;
+				// In pixels of the result, an empty one renders the frame whole.
+				QRect region;
+				Priority priority;
+				std::shared_ptr<std::atomic<bool>> cancelled;
+
+				// The same pixels, maybe in other colours.
+				bool isSameFrame(const Job& other) const
+				{
+					return centerX == other.centerX && centerY == other.centerY && scaleFactor == other.scaleFactor
+						&& resultSize == other.resultSize && devicePixelRatio == other.devicePixelRatio
+						&& region == other.region && fractal == other.fractal;
+				}
+			};
+
+			RenderScheduler(QObject* parent = nullptr);
+			~RenderScheduler();
+
+			void submit(Job job);
+			// Drops the jobs of a connection, queued or running.
+			void cancel(qintptr descriptor);
+
+			// An interactive job unless the frame is larger than a big screen.
+			static Priority priorityFor(QSize resultSize, double devicePixelRatio, const QRect& region);
+
+			// At least 2, the threads are started with the first job.
+			static void setThreadCount(int n) { threadCount = n; }
+
+			static constexpr int DefaultThreadCount = 4;
+			static constexpr qint64 InteractivePixels = 3840 * 2160;
+
+		signals:
+			void renderedImage(qintptr descriptor, const QImage& image, double scaleFactor, const QRect& region);
+
+		private:
+			friend class RenderThread;
+
+			// Blocks until there is a job for the render thread, false once stopping.
+			bool take(Job& job);
+			void finish(const Job& job);
+			bool isStopping() const { return m_stop; }
+
+			QMutex m_mutex;
+			QWaitCondition m_condition;
+			// Each in the order of arrival.
+			QList<Job> m_interactive;
+			QList<Job> m_exports;
+			QList<Job> m_running;
+			int m_runningExports;
+			std::atomic<bool> m_stop;
+			std::vector<std::unique_ptr<RenderThread>> m_threads;
+
+			static int threadCount;
+		};
+	}
+}
+
+#endif
@@ -1,198 +1,272 @@
+#include "EscapeTimeKernel.h"
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
+#include "Palette.h"
+#include "RenderScheduler.h"
 #include "RenderThread.h"
+#include "TileCache.h"
+#include "TilePool.h"
 #include <QElapsedTimer>
 #include <QImage>
-#include <QMutexLocker>
 #include <QObject>
+#include <QPoint>
+#include <QRect>
 #include <QSize>
 #include <QString>
 #include <QTextStream>
 #include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <vector>
 
 
 using namespace Mandelbrot::ComputationServer;
+using Mandelbrot::Common::EscapeTimeKernel;
+using Mandelbrot::Common::FixedPoint;
+using Mandelbrot::Common::FrameRenderer;
+using Mandelbrot::Common::Palette;
+using Mandelbrot::Common::TilePool;
 
 int RenderThread::numPasses = RenderThread::NumberPassesMin;
+double RenderThread::adaptiveTolerance = 0.0;
 
-RenderThread::RenderThread(QObject* parent)
-	: QThread(parent)
+RenderThread::RenderThread(RenderScheduler& scheduler, QObject* parent)
+	: QThread(parent),
+	m_scheduler(scheduler),
+	m_counts(nullptr),
+	m_recolorable(false)
 {
 }
 
 RenderThread::~RenderThread()
 {
-	m_mutex.lock();
-	m_abort = true;
-	m_condition.wakeOne();
-	m_mutex.unlock();
-
 	wait();
 }
 
-void RenderThread::render(qintptr descriptor,
-	double centerX, double centerY, double scaleFactor,
-	QSize resultSize, double devicePixelRatio, QRgb color)
+void RenderThread::run()
 {
-	QMutexLocker locker(&m_mutex);
-
-	this->m_descriptor = descriptor;
-	this->m_centerX = centerX;
-	this->m_centerY = centerY;
-	this->m_scaleFactor = scaleFactor;
-	this->m_devicePixelRatio = devicePixelRatio;
-	this->m_resultSize = resultSize;
-	this->m_baseColor = color;
-
-	if (!isRunning()) {
-		start(LowPriority);
-	}
-	else {
-		m_restart = true;
-		m_condition.wakeOne();
+	RenderScheduler::Job job;
+	while (m_scheduler.take(job)) {
+		// The tiles of the interactive jobs go before those of the exports.
+		TilePool::setPriority(int(job.priority));
+		if (m_recolorable && job.isSameFrame(m_last))
+			recolor(job);
+		else
+			m_recolorable = render(job);
+		m_last = job;
+		m_scheduler.finish(job);
 	}
 }
 
-void RenderThread::run()
+bool RenderThread::render(const RenderScheduler::Job& job)
 {
 	QElapsedTimer timer;
-	forever{
-		m_mutex.lock();
-		const qintptr descript = this->m_descriptor;
-		const double devicePixelRatio = this->m_devicePixelRatio;
-		const QSize resultSize = this->m_resultSize * devicePixelRatio;
-		const QRgb resultBaseColor = this->m_baseColor;
-		const double requestedScaleFactor = this->m_scaleFactor;
-		const double scaleFactor = requestedScaleFactor / devicePixelRatio;
-		const double centerX = this->m_centerX;
-		const double centerY = this->m_centerY;
-		m_mutex.unlock();
-
-		const QColor c(resultBaseColor);
-		const int r = c.red();
-		const int g = c.green();
-		const int b = c.blue();
-
-		uint colormap[ColormapSize];
-		for (int i = 0; i < ColormapSize; ++i)
-			colormap[i] = rgbFromWaveLength(380.0 + (i * 400.0 / ColormapSize), r, g, b);
-
-		const int halfWidth = resultSize.width() / 2;
-		const int halfHeight = resultSize.height() / 2;
-		QImage image(resultSize, QImage::Format_RGB32);
-		image.setDevicePixelRatio(devicePixelRatio);
-
-		int pass = 0;
-		while (pass < numPasses) {
-			const int MaxIterations = (1 << (2 * pass + 6)) + 32;
-			constexpr int Limit = 4;
-			bool allBlack = true;
-
-			timer.restart();
-
-			for (int y = -halfHeight; y < halfHeight; ++y) {
-				if (m_restart)
-					break;
-				if (m_abort)
-					return;
-
-				auto scanLine =
-						reinterpret_cast<uint*>(image.scanLine(y + halfHeight));
-				const double ay = centerY + (y * scaleFactor);
-
-				for (int x = -halfWidth; x < halfWidth; ++x) {
-					const double ax = centerX + (x * scaleFactor);
-					double a1 = ax;
-					double b1 = ay;
-					int numIterations = 0;
-
-					do {
-						++numIterations;
-						const double a2 = (a1 * a1) - (b1 * b1) + ax;
-						const double b2 = (2 * a1 * b1) + ay;
-						if ((a2 * a2) + (b2 * b2) > Limit)
-							break;
-
-						++numIterations;
-						a1 = (a2 * a2) - (b2 * b2) + ax;
-						b1 = (2 * a2 * b2) + ay;
-						if ((a1 * a1) + (b1 * b1) > Limit)
-							break;
-					} while (numIterations < MaxIterations);
-
-					if (numIterations < MaxIterations) {
-						*scanLine++ = colormap[numIterations % ColormapSize];
-						allBlack = false;
-					}
-					 else {
-					  *scanLine++ = qRgb(0, 0, 0);
-					}
+	const TilePool::Cancelled cancelled = [this, &job]() { return *job.cancelled || m_scheduler.isStopping(); };
+	const double devicePixelRatio = job.devicePixelRatio;
+	const QSize frameSize = job.resultSize * devicePixelRatio;
+	const QRect region = regionOf(job);
+	const double scaleFactor = job.scaleFactor / devicePixelRatio;
+	const FrameRenderer::Fractal fractal = job.fractal;
+	FixedPoint frameCenterX = job.centerX;
+	FixedPoint frameCenterY = job.centerY;
+
+	const std::shared_ptr<const Palette> palette = Palette::find({ job.color, ColormapSize, Palette::DefaultGamma });
+
+	const QRect deviceRegion = QRect(QPoint(qRound(region.x() * devicePixelRatio), qRound(region.y() * devicePixelRatio)),
+		region.size() * devicePixelRatio).intersected(QRect(QPoint(0, 0), frameSize));
+	const QSize resultSize = deviceRegion.size();
+	const int width = resultSize.width();
+	const int height = resultSize.height();
+	m_image = QImage(resultSize, QImage::Format_RGB32);
+	m_image.setDevicePixelRatio(devicePixelRatio);
+	m_info.clear();
+
+	// Adaptive passes after the first one iterate only the tiles around the boundary.
+	const double tolerance = adaptiveTolerance;
+	const bool adaptive = tolerance > 0.0;
+	int estimatedIterations = FrameRenderer::MaxEstimatedIterations;
+	bool refine = true;
+
+	// With the tile cache the frame is snapped to the grid of the tiles, the cached ones are
+	// copied and only the box around the others is rendered. An adaptive budget depends on
+	// the frame, such frames are left out.
+	TileCache& cache = TileCache::instance();
+	const bool cached = cache.isEnabled() && !adaptive
+		&& TileCache::isCacheable(frameCenterX.toDouble(), frameCenterY.toDouble(), scaleFactor, fractal.family);
+	const int lastIterations = (1 << (2 * (numPasses - 1) + 6)) + 32;
+	const quint32 mode = TileCache::renderModeBits();
+	qint64 originX = 0;
+	qint64 originY = 0;
+	std::vector<QRect> missing;
+	QRect rendered = deviceRegion;
+	if (cached) {
+		originX = qRound64(frameCenterX.toDouble() / scaleFactor) - (frameSize.width() / 2);
+		originY = qRound64(frameCenterY.toDouble() / scaleFactor) - (frameSize.height() / 2);
+		frameCenterX = FixedPoint(double(originX + (frameSize.width() / 2)) * scaleFactor);
+		frameCenterY = FixedPoint(double(originY + (frameSize.height() / 2)) * scaleFactor);
+
+		m_smooth.resize(size_t(width) * height);
+		rendered = QRect();
+		const qint64 lastX = TileCache::tileOf(originX + deviceRegion.right());
+		const qint64 lastY = TileCache::tileOf(originY + deviceRegion.bottom());
+		for (qint64 ty = TileCache::tileOf(originY + deviceRegion.top()); ty <= lastY; ++ty) {
+			for (qint64 tx = TileCache::tileOf(originX + deviceRegion.left()); tx <= lastX; ++tx) {
+				const QRect area(int(tx * TileCache::TileSize - originX), int(ty * TileCache::TileSize - originY),
+					TileCache::TileSize, TileCache::TileSize);
+				const QRect part = area.intersected(deviceRegion);
+				const TileCache::Tile tile = cache.find({ fractal, scaleFactor, tx, ty, lastIterations, mode });
+				if (!tile) {
+					missing.push_back(area);
+					rendered |= part;
+					continue;
+				}
+				for (int y = part.top(); y <= part.bottom(); ++y) {
+					std::memcpy(m_smooth.data() + (size_t(y - deviceRegion.top()) * width) + (part.left() - deviceRegion.left()),
+						tile.get() + ((y - area.top()) * TileCache::TileSize) + (part.left() - area.left()),
+						part.width() * sizeof(float));
 				}
 			}
+		}
+	}
 
-			if (allBlack && pass == 0) {
-				pass = 4;
-			}
-			else {
-			 if (!m_restart) {
-				 QString message;
-				 QTextStream str(&message);
-				 str << " Pass " << (pass + 1) << '/' << numPasses
-					 << ", max iterations: " << MaxIterations << ", time: ";
-				 const auto elapsed = timer.elapsed();
-				 if (elapsed > 2000)
-					 str << (elapsed / 1000) << 's';
-				 else
-					 str << elapsed << "ms";
-				 image.setText(infoKey(), message);
-
-				 emit renderedImage(descript, image, requestedScaleFactor);
-			 }
-			 ++pass;
+	// The rendered box is a frame around its own centre, its pixels fall exactly where they
+	// do in the whole frame.
+	if (!rendered.isEmpty()) {
+		const FixedPoint centerX = frameCenterX
+			+ FixedPoint((rendered.x() + (rendered.width() / 2) - (frameSize.width() / 2)) * scaleFactor);
+		const FixedPoint centerY = frameCenterY
+			+ FixedPoint((rendered.y() + (rendered.height() / 2) - (frameSize.height() / 2)) * scaleFactor);
+		m_frame.setGeometry({ centerX, centerY, scaleFactor, rendered.width(), rendered.height() }, fractal);
+	}
+	m_counts = cached ? m_smooth.data() : m_frame.smoothLine(0);
+
+	// A reply carries only the last pass, so a fixed number of passes is rendered as that one
+	// pass. The adaptive passes are all rendered, each one decides on the next.
+	int pass = 0;
+	bool finished = true;
+	while (!rendered.isEmpty() && (adaptive ? refine : pass == 0)) {
+		const int MaxIterations = adaptive ? std::min((1 << (2 * pass + 6)) + 32, estimatedIterations) : lastIterations;
+
+		timer.restart();
+
+		if (!m_frame.renderPass(MaxIterations, cancelled, adaptive && pass > 0)) {
+			finished = false;
+			break;
+		}
+
+		if (cached) {
+			for (int y = 0; y < rendered.height(); ++y) {
+				std::memcpy(m_smooth.data() + (size_t(rendered.top() + y - deviceRegion.top()) * width)
+					+ (rendered.left() - deviceRegion.left()), m_frame.smoothLine(y), rendered.width() * sizeof(float));
 			}
 		}
+		const bool allBlack = !colorize(m_image, m_counts, *palette);
 
-		m_mutex.lock();
-		if (!m_restart) {
-			m_condition.wait(&m_mutex);
+		if (adaptive) {
+			// The budget is estimated once the frame has escapes to go by.
+			if (estimatedIterations == FrameRenderer::MaxEstimatedIterations)
+				estimatedIterations = m_frame.estimateIterations(MaxIterations, tolerance);
+			if (pass > 0 && !allBlack && m_frame.changedPixels() < tolerance * width * height)
+				refine = false;
+			refine = refine && MaxIterations < estimatedIterations;
 		}
-		m_restart = false;
-		m_mutex.unlock();
-	}
-}
 
-uint RenderThread::rgbFromWaveLength(double wave, double r, double g, double b)
-{
-	if (wave >= 380.0 && wave <= 440.0) {
-		r = -1.0 * (wave - 440.0) / (440.0 - 380.0);
-		b = 1.0;
-	}
-	else if (wave >= 440.0 && wave <= 490.0) {
-		g = (wave - 440.0) / (490.0 - 440.0);
-		b = 1.0;
-	}
-	else if (wave >= 490.0 && wave <= 510.0) {
-		g = 1.0;
-		b = -1.0 * (wave - 510.0) / (510.0 - 490.0);
+		QString message;
+		QTextStream str(&message);
+		if (adaptive)
+			str << " Pass " << (pass + 1) << ", max iterations: ";
+		else
+			str << " Max iterations: ";
+		str << MaxIterations << ", time: ";
+		const auto elapsed = timer.elapsed();
+		if (elapsed > 2000)
+			str << (elapsed / 1000) << 's';
+		else
+			str << elapsed << "ms";
+		const double pixels = double(rendered.width()) * rendered.height();
+		str << ", iterated: " << QString::number(100.0 * m_frame.iteratedPixels() / pixels, 'f', 1) << '%';
+		if (FrameRenderer::isSubdivision() || FrameRenderer::isSymmetry())
+			str << ", filled: " << QString::number(100.0 * m_frame.filledPixels() / pixels, 'f', 1) << '%';
+		if (adaptive)
+			str << ", changed: " << QString::number(100.0 * m_frame.changedPixels() / pixels, 'f', 2) << '%';
+		str << ", precision: " << FrameRenderer::name(m_frame.precision());
+		if (m_frame.referenceCount() > 0)
+			str << " (" << m_frame.referenceCount() << " reference(s))";
+		const double pixelsPerNsec = pixels / qMax<qint64>(timer.nsecsElapsed(), 1);
+		str << ", " << QString::number(pixelsPerNsec * 1000.0, 'f', 1) << " Mpx/s ("
+			<< EscapeTimeKernel::name(EscapeTimeKernel::instructionSet()) << " x "
+			<< TilePool::instance().threadCount() << " threads)";
+		if (cached)
+			str << cacheInfo(cache, missing.size());
+		m_info = message;
+		++pass;
 	}
-	else if (wave >= 510.0 && wave <= 580.0) {
-		r = (wave - 510.0) / (580.0 - 510.0);
-		g = 1.0;
-	}
-	else if (wave >= 580.0 && wave <= 645.0) {
-		r = 1.0;
-		g = -1.0 * (wave - 645.0) / (645.0 - 580.0);
+
+	if (!finished)
+		return false;
+
+	if (rendered.isEmpty()) {
+		timer.restart();
+		colorize(m_image, m_counts, *palette);
+		QString message;
+		QTextStream str(&message);
+		str << " Cached, time: " << timer.elapsed() << "ms" << cacheInfo(cache, missing.size());
+		m_info = message;
 	}
-	else if (wave >= 645.0 && wave <= 780.0) {
-		r = 1.0;
+	else if (cached) {
+		// Only the tiles rendered whole, those on the border of the frame never are.
+		for (const QRect& area : missing) {
+			if (rendered.contains(area)) {
+				const qint64 tx = TileCache::tileOf(originX + area.left());
+				const qint64 ty = TileCache::tileOf(originY + area.top());
+				cache.insert({ fractal, scaleFactor, tx, ty, lastIterations, mode },
+					m_frame.smoothLine(area.top() - rendered.top()) + (area.left() - rendered.left()), rendered.width());
+			}
+		}
 	}
 
-	double s = 1.0;
-	if (wave > 700.0)
-		s = 0.3 + 0.7 * (780.0 - wave) / (780.0 - 700.0);
-	else if (wave < 420.0)
-		s = 0.3 + 0.7 * (wave - 380.0) / (420.0 - 380.0);
+	m_image.setText(infoKey(), m_info);
+	emit renderedImage(job.descriptor, m_image, job.scaleFactor, region);
+	return true;
+}
+
+void RenderThread::recolor(const RenderScheduler::Job& job)
+{
+	QElapsedTimer timer;
+	timer.start();
+	const std::shared_ptr<const Palette> palette = Palette::find({ job.color, ColormapSize, Palette::DefaultGamma });
+	colorize(m_image, m_counts, *palette);
+	QString message = m_info;
+	QTextStream str(&message);
+	str << ", recolored in " << timer.elapsed() << "ms";
+	m_image.setText(infoKey(), message);
+	emit renderedImage(job.descriptor, m_image, job.scaleFactor, regionOf(job));
+}
+
+bool RenderThread::colorize(QImage& image, const float* smooth, const Palette& palette)
+{
+	// The rows are coloured in parallel, the image is detached before.
+	uchar* bits = image.bits();
+	const auto bytesPerLine = image.bytesPerLine();
+	const int width = image.width();
+	std::atomic<bool> escaped = false;
+	TilePool::instance().run(image.height(), [=, &palette, &escaped](int y) {
+		if (palette.colorize(smooth + (size_t(y) * width), reinterpret_cast<uint32_t*>(bits + (y * bytesPerLine)), width))
+			escaped = true;
+		}, TilePool::Cancelled());
+	return escaped;
+}
 
-	r = std::pow(r * s, 0.8);
-	g = std::pow(g * s, 0.8);
-	b = std::pow(b * s, 0.8);
-	return qRgb(int(r * 255), int(g * 255), int(b * 255));
+QString RenderThread::cacheInfo(const TileCache& cache, size_t missing)
+{
+	const qint64 hits = cache.hits();
+	const qint64 lookups = qMax<qint64>(hits + cache.misses(), 1);
+	return QString(", tiles rendered: %1, cache hits: %2%").arg(missing).arg(QString::number(100.0 * hits / lookups, 'f', 1));
+}
+
+QRect RenderThread::regionOf(const RenderScheduler::Job& job)
+{
+	return job.region.isEmpty() ? QRect(QPoint(0, 0), job.resultSize) : job.region;
 }
@@ -1,56 +1,67 @@
 #ifndef RENDERTHREAD_H
 #define RENDERTHREAD_H
 
+#include "FrameRenderer.h"
+#include "Palette.h"
+#include "RenderScheduler.h"
+#include "TileCache.h"
 #include <QImage>
-#include <QMutex>
 #include <QObject>
-#include <QSize>
+#include <QRect>
 #include <QString>
 #include <QThread>
-#include <QWaitCondition>
+#include <vector>
 
 
 namespace Mandelbrot
 {
 	namespace ComputationServer
 	{
+		// One of the scheduler's threads, rendering the jobs it takes from it one after
+		// another. A job for the frame it finished last is only coloured again.
 		class RenderThread : public QThread
 		{
 			Q_OBJECT
 
 		public:
-			RenderThread(QObject* parent = nullptr);
+			explicit RenderThread(RenderScheduler& scheduler, QObject* parent = nullptr);
 			~RenderThread();
 
-			void render(qintptr descriptor,
-				double centerX, double centerY, double scaleFactor, QSize resultSize,
-				double devicePixelRatio, QRgb color);
-
+			// The budget is that of the last of n passes, rendered as one.
 			static void setNumPasses(int n) { numPasses = n; }
+			// Above 0 the passes go on while they change at least this fraction of the pixels,
+			// up to the budget estimated from the first one, instead of numPasses.
+			static void setAdaptiveTolerance(double tolerance) { adaptiveTolerance = tolerance; }
 
 			static QString infoKey() { return QStringLiteral("info"); }
 
 		signals:
-			void renderedImage(qintptr descriptor, const QImage& image, double scaleFactor);
+			void renderedImage(qintptr descriptor, const QImage& image, double scaleFactor, const QRect& region);
 
 		protected:
 			void run() override;
 
 		private:
-			static uint rgbFromWaveLength(double wave, double r, double g, double b);
-
-			qintptr m_descriptor;
-			QMutex m_mutex;
-			QWaitCondition m_condition;
-			double m_centerX;
-			double m_centerY;
-			double m_scaleFactor;
-			double m_devicePixelRatio;
-			QSize m_resultSize;
-			QRgb m_baseColor;
+			// False when the job was cancelled before its last pass.
+			bool render(const RenderScheduler::Job& job);
+			void recolor(const RenderScheduler::Job& job);
+
+			// The rows of the continuous counts are as wide as the image.
+			static bool colorize(QImage& image, const float* smooth, const Common::Palette& palette);
+			static QString cacheInfo(const TileCache& cache, size_t missing);
+			static QRect regionOf(const RenderScheduler::Job& job);
+
+			RenderScheduler& m_scheduler;
+			Common::FrameRenderer m_frame;
+			std::vector<float> m_smooth;
+			// Of the last frame: its counts, image and info, and the job they answered.
+			const float* m_counts;
+			QImage m_image;
+			QString m_info;
+			RenderScheduler::Job m_last;
+			bool m_recolorable;
 			static int numPasses;
-			bool m_restart;
-			bool m_abort;
+			static double adaptiveTolerance;
 
 			static constexpr int NumberPassesMin = 2;
 			static constexpr int ColormapSize = 512;
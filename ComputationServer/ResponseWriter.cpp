@@ -0,0 +1,149 @@
+#include "ResponseWriter.h"
+#include <QAbstractSocket>
+#include <QByteArray>
+#include <QImage>
+#include <QIODevice>
+#include <QObject>
+#include <QTcpSocket>
+#include <QtGlobal>
+#include <vector>
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+
+using namespace Mandelbrot::ComputationServer;
+
+ResponseWriter::ResponseWriter(QTcpSocket* socket, QObject* parent) :
+	QObject(parent),
+	m_socket(socket),
+	m_segment(0),
+	m_offset(0)
+{
+	connect(m_socket, &QIODevice::bytesWritten, this, &ResponseWriter::resume);
+}
+
+void ResponseWriter::start(const QByteArray& header, const QImage& image)
+{
+	m_header = header;
+	m_body.clear();
+	m_image = image;
+	// Shared with the render thread, which detaches before it draws again.
+	m_segments = { { m_header.constData(), m_header.size() },
+		{ reinterpret_cast<const char*>(m_image.constBits()), m_image.sizeInBytes() } };
+	begin();
+}
+
+void ResponseWriter::start(const QByteArray& header, const QByteArray& body)
+{
+	m_header = header;
+	m_body = body;
+	m_image = QImage();
+	m_segments = { { m_header.constData(), m_header.size() }, { m_body.constData(), m_body.size() } };
+	begin();
+}
+
+void ResponseWriter::resume()
+{
+	if (!isWriting())
+		return;
+
+	// The bytes queued in the socket go first, it signals again once they are sent.
+	while (isWriting() && m_socket->bytesToWrite() == 0) {
+		if (m_socket->state() != QAbstractSocket::ConnectedState) {
+			stop();
+			return;
+		}
+
+		const qint64 written = writeVectors();
+		if (written < 0) {
+			stop();
+			m_socket->abort();
+			return;
+		}
+		if (written > 0) {
+			advance(written);
+			emit progressed();
+			continue;
+		}
+
+		// The kernel takes no more for now.
+		const Segment& segment = m_segments[m_segment];
+		const qint64 queued = m_socket->write(segment.data + m_offset, qMin(ChunkSize, segment.size - m_offset));
+		if (queued <= 0) {
+			stop();
+			m_socket->abort();
+			return;
+		}
+		advance(queued);
+		emit progressed();
+	}
+
+	if (!isWriting()) {
+		stop();
+		emit finished();
+	}
+}
+
+void ResponseWriter::begin()
+{
+	m_segment = 0;
+	m_offset = 0;
+	advance(0);
+	resume();
+}
+
+void ResponseWriter::stop()
+{
+	m_segments.clear();
+	m_segment = 0;
+	m_offset = 0;
+	m_header.clear();
+	m_body.clear();
+	m_image = QImage();
+}
+
+void ResponseWriter::advance(qint64 bytes)
+{
+	// Past the end of a segment goes on in the next ones, the empty ones are skipped.
+	m_offset += bytes;
+	while (m_segment < m_segments.size() && m_offset >= m_segments[m_segment].size) {
+		m_offset -= m_segments[m_segment].size;
+		++m_segment;
+	}
+}
+
+qint64 ResponseWriter::writeVectors()
+{
+#ifdef Q_OS_UNIX
+	iovec vectors[MaxVectors];
+	int count = 0;
+	for (size_t i = m_segment; i < m_segments.size() && count < MaxVectors; ++i) {
+		const qint64 skipped = i == m_segment ? m_offset : 0;
+		vectors[count].iov_base = const_cast<char*>(m_segments[i].data + skipped);
+		vectors[count].iov_len = size_t(m_segments[i].size - skipped);
+		++count;
+	}
+
+	msghdr message = {};
+	message.msg_iov = vectors;
+	message.msg_iovlen = count;
+	// A client gone is an error, not a signal.
+	int flags = 0;
+#ifdef MSG_NOSIGNAL
+	flags = MSG_NOSIGNAL;
+#endif
+	for (;;) {
+		const ssize_t sent = ::sendmsg(int(m_socket->socketDescriptor()), &message, flags);
+		if (sent >= 0)
+			return qint64(sent);
+		if (errno != EINTR)
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+	}
+#else
+	// Elsewhere only through the socket's buffer, a chunk at a time.
+	return 0;
+#endif
+}
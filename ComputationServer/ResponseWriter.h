@@ -0,0 +1,74 @@
+#ifndef RESPONSEWRITER_H
+#define RESPONSEWRITER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QObject>
+#include <QTcpSocket>
+#include <QtGlobal>
+#include <vector>
+
+
+namespace Mandelbrot
+{
+	namespace ComputationServer
+	{
+		// Sends a response from where its parts already are: the header, then the body, an
+		// array or the memory of an image, kept alive meanwhile. While the socket's own
+		// buffer is empty they go to the kernel in scatter/gather writes, without a copy;
+		// once the kernel takes no more, a chunk goes through the socket's buffer, whose
+		// draining signals when to go on. A response costs no more than its header and
+		// a chunk besides the body.
+		class ResponseWriter : public QObject
+		{
+			Q_OBJECT
+
+		public:
+			explicit ResponseWriter(QTcpSocket* socket, QObject* parent = nullptr);
+
+			// The image's bytes are sent as they are in memory, all its rows.
+			void start(const QByteArray& header, const QImage& image);
+			void start(const QByteArray& header, const QByteArray& body);
+
+			bool isWriting() const { return m_segment < m_segments.size(); }
+
+			// Room for a header without growing.
+			static constexpr qsizetype HeaderCapacity = 1024;
+			static constexpr qint64 ChunkSize = 65536;
+
+		signals:
+			// Some bytes have left for the socket.
+			void progressed();
+			// All of them have, the socket may still be sending the last chunk.
+			void finished();
+
+		private slots:
+			void resume();
+
+		private:
+			struct Segment
+			{
+				const char* data;
+				qint64 size;
+			};
+
+			void begin();
+			void stop();
+			void advance(qint64 bytes);
+			// Returns the bytes the kernel took, 0 when it would block, -1 on an error.
+			qint64 writeVectors();
+
+			QTcpSocket* m_socket;
+			QByteArray m_header;
+			QByteArray m_body;
+			QImage m_image;
+			std::vector<Segment> m_segments;
+			size_t m_segment;
+			qint64 m_offset;
+
+			static constexpr int MaxVectors = 4;
+		};
+	}
+}
+
+#endif
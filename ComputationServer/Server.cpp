@@ -1,7 +1,15 @@
+#include "Connection.h"
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
 #include "HttpProtocol.h"
+#include "ImageCodec.h"
+#include "RenderScheduler.h"
 #include "RenderThread.h"
+#include "ResponseWriter.h"
 #include "Server.h"
-#include <QBuffer>
+#include "TileCache.h"
+#include "TileStore.h"
+#include "TilePool.h"
 #include <QByteArray>
 #include <QCryptographicHash>
 #include <QDateTime>
@@ -13,21 +21,30 @@
 #include <QList>
 #include <QLocale>
 #include <QObject>
+#include <QRect>
 #include <QString>
 #include <QStringList>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QTextStream>
+#include <algorithm>
 #include <cstring>
 
 
 using namespace Mandelbrot::ComputationServer;
+using Mandelbrot::Common::FixedPoint;
+using Mandelbrot::Common::FrameRenderer;
+using Mandelbrot::Common::TilePool;
 
 Server::Server(QObject* parent) :
 	QTcpServer(parent),
 	m_address(QHostAddress::LocalHost),
-	m_port(0)
+	m_port(0),
+	m_connectionCount(0),
+	m_requestCount(0),
+	m_reusedCount(0)
 {
-	connect(&m_renderer, &RenderThread::renderedImage, this, &Server::respondImage);
+	connect(&m_scheduler, &RenderScheduler::renderedImage, this, &Server::respondImage);
 	connect(this, &QTcpServer::newConnection, this, &Server::useConnection);
 }
 
@@ -62,6 +79,37 @@ void Server::read(const QJsonObject& json)
 	if (json.contains("listening_port") && json["listening_port"].isDouble()) {
 		m_port = json["listening_port"].toInt();
 	}
+
+	// 0 sizes the render pool to the machine.
+	if (json.contains("render_threads") && json["render_threads"].isDouble()) {
+		TilePool::setDefaultThreadCount(json["render_threads"].toInt());
+	}
+
+	// The requests rendered at once, their tiles share the render pool.
+	if (json.contains("render_jobs") && json["render_jobs"].isDouble()) {
+		RenderScheduler::setThreadCount(json["render_jobs"].toInt());
+	}
+
+	// An open connection waits this long for its next request, and answers this many.
+	if (json.contains("keep_alive_ms") && json["keep_alive_ms"].isDouble()) {
+		Connection::setIdleTimeout(json["keep_alive_ms"].toInt());
+	}
+	if (json.contains("keep_alive_requests") && json["keep_alive_requests"].isDouble()) {
+		Connection::setMaxRequests(json["keep_alive_requests"].toInt());
+	}
+
+	// 0 disables the cache of rendered tiles.
+	if (json.contains("tile_cache_bytes") && json["tile_cache_bytes"].isDouble()) {
+		TileCache::instance().setBudget(json["tile_cache_bytes"].toInteger());
+	}
+
+	// Optional, the tiles are kept on disk across restarts in files at this path.
+	if (json.contains("tile_store") && json["tile_store"].isString()) {
+		qint64 bytes = TileStore::DefaultBudget;
+		if (json.contains("tile_store_bytes") && json["tile_store_bytes"].isDouble())
+			bytes = json["tile_store_bytes"].toInteger();
+		TileCache::instance().setStore(json["tile_store"].toString(), bytes);
+	}
 }
 
 quint16 Server::listen()
@@ -74,32 +122,59 @@ quint16 Server::listen()
 
 void Server::useConnection()
 {
-	QTcpSocket* newSocket = nextPendingConnection();
-	if (newSocket) {
-		QByteArray buffered;
-		int msWait = 3000;
-		while (newSocket->waitForReadyRead(msWait)) {
-			//qint64 size = newSocket->bytesAvailable();
-			buffered.append(newSocket->readAll());
-			msWait = 200;
+	// Only the connections are taken here, their requests are read as they come.
+	while (hasPendingConnections()) {
+		QTcpSocket* newSocket = nextPendingConnection();
+		if (!newSocket) {
+			qWarning() << tr("ComputationServer")
+				<< tr("Can't open a socket.");
+			break;
 		}
 
-		if (m_connected.indexOf(newSocket) == -1)
-			m_connected.append(newSocket);
-
-		QTextStream stream(buffered);
-		parseRequest(newSocket->socketDescriptor(), stream);
-	}
-	else {
-		qWarning() << tr("ComputationServer")
-			<< tr("Can't open a socket.");
+		Connection* connection = new Connection(newSocket, this);
+		connect(connection, &Connection::requestReceived, this, &Server::dispatch);
+		connect(connection, &Connection::requestRejected, this, &Server::reject);
+		connect(connection, &Connection::closed, this, &Server::removeConnection);
+		m_connected.append(connection);
+		++m_connectionCount;
 	}
 }
 
+void Server::dispatch(Connection* connection, const QByteArray& header)
+{
+	++m_requestCount;
+	if (connection->served() > 0)
+		++m_reusedCount;
+
+	QTextStream stream(header);
+	parseRequest(connection->id(), stream);
+}
+
+void Server::reject(Connection* connection, int statusCode, const char* reasonPhrase)
+{
+	QByteArray message;
+	message.reserve(ResponseWriter::HeaderCapacity);
+	QTextStream stream(&message, QIODevice::WriteOnly);
+	errorResponse(stream, statusCode, reasonPhrase);
+	stream.flush();
+	replyMessage(connection->id(), message);
+}
+
+void Server::removeConnection(Connection* connection)
+{
+	m_scheduler.cancel(connection->id());
+	m_formats.remove(connection->id());
+	m_connected.removeOne(connection);
+	connection->deleteLater();
+}
+
 void Server::parseRequest(qintptr descriptor, QTextStream& data)
 {
-	QString message;
-	QTextStream stream(&message);
+	QByteArray message;
+	message.reserve(ResponseWriter::HeaderCapacity);
+	QTextStream stream(&message, QIODevice::WriteOnly);
+	const Connection* connection = find(descriptor);
+	const bool keepAlive = connection && connection->isKeepAlive();
 
 	HttpData request;
 	if (lexicalHttpParser(data, request) == true) {
@@ -111,14 +186,14 @@ void Server::parseRequest(qintptr descriptor, QTextStream& data)
 			QString address = inx == -1 ? ip : ip.left(inx);
 			QHostAddress host = address == "localhost" ? QHostAddress(QHostAddress::LocalHost) : QHostAddress(address);
 			if (host != m_address)
-				errorResponse(stream, HttpProtocol::StatusCode::NOT_ACCEPTABLE, HttpProtocol::ReasonPhrase::NOT_ACCEPTABLE);
+				errorResponse(stream, HttpProtocol::StatusCode::NOT_ACCEPTABLE, HttpProtocol::ReasonPhrase::NOT_ACCEPTABLE, keepAlive);
 			else if (request["Method"] != HttpProtocol::Method::GET)
-				errorResponse(stream, HttpProtocol::StatusCode::NOT_IMPLEMENTED, HttpProtocol::ReasonPhrase::NOT_IMPLEMENTED);
+				errorResponse(stream, HttpProtocol::StatusCode::NOT_IMPLEMENTED, HttpProtocol::ReasonPhrase::NOT_IMPLEMENTED, keepAlive);
 			else if (request["Uri"].isNull() || request["Uri"].isEmpty() || request["Uri"].length() <= 2 ||
 				request["Uri"][0] != '/' || request["Uri"][1] != '?')
-				errorResponse(stream, HttpProtocol::StatusCode::NOT_FOUND, HttpProtocol::ReasonPhrase::NOT_FOUND);
+				errorResponse(stream, HttpProtocol::StatusCode::NOT_FOUND, HttpProtocol::ReasonPhrase::NOT_FOUND, keepAlive);
 			else if (request["Version"] != HttpProtocol::VERSION)
-				errorResponse(stream, HttpProtocol::StatusCode::NOT_IMPLEMENTED, HttpProtocol::ReasonPhrase::NOT_IMPLEMENTED);
+				errorResponse(stream, HttpProtocol::StatusCode::NOT_IMPLEMENTED, HttpProtocol::ReasonPhrase::NOT_IMPLEMENTED, keepAlive);
 			else {
 				HttpData arguments = readQueryString(request["Uri"]);
 
@@ -129,21 +204,26 @@ void Server::parseRequest(qintptr descriptor, QTextStream& data)
 					arguments["resultHeight"].isNull() || arguments["resultHeight"].isEmpty() ||
 					arguments["pixelRatio"].isNull() || arguments["pixelRatio"].isEmpty() ||
 					arguments["color"].isNull() || arguments["color"].isEmpty())
-					errorResponse(stream, HttpProtocol::StatusCode::BAD_REQUEST, HttpProtocol::ReasonPhrase::BAD_REQUEST);
+					errorResponse(stream, HttpProtocol::StatusCode::BAD_REQUEST, HttpProtocol::ReasonPhrase::BAD_REQUEST, keepAlive);
 				else {
-					double centerX;
-					double centerY;
+					FixedPoint centerX;
+					FixedPoint centerY;
 					double scaleFactor;;
 					int resultWidth;
 					int resultHeight;
 					double pixelRatio;
 					QRgb color;
+					QRect region;
+					ImageCodec::Format format;
+					FrameRenderer::Fractal fractal{ FrameRenderer::Family::Mandelbrot, FrameRenderer::MinPower,
+						FrameRenderer::DefaultJuliaX, FrameRenderer::DefaultJuliaY };
 
 					bool* conversionOk = new bool(false);
 					do {
-						centerX = arguments["centerX"].toDouble(conversionOk);
+						// Arbitrary precision, a deep zoom needs more digits than a double holds.
+						*conversionOk = FixedPoint::parse(arguments["centerX"].toStdString(), centerX);
 						if (!*conversionOk) break;
-						centerY = arguments["centerY"].toDouble(conversionOk);
+						*conversionOk = FixedPoint::parse(arguments["centerY"].toStdString(), centerY);
 						if (!*conversionOk) break;
 						scaleFactor = arguments["scaleFactor"].toDouble(conversionOk);
 						if (!*conversionOk) break;
@@ -155,16 +235,56 @@ void Server::parseRequest(qintptr descriptor, QTextStream& data)
 						if (!*conversionOk) break;
 						color = arguments["color"].toUInt(conversionOk);
 						if (!*conversionOk) break;
+
+						// Optional, the Mandelbrot set unless another fractal is asked for.
+						if (!arguments["fractal"].isEmpty()) {
+							*conversionOk = FrameRenderer::fromName(arguments["fractal"].toLower().toUtf8().constData(), fractal.family);
+							if (!*conversionOk) break;
+						}
+						if (!arguments["power"].isEmpty()) {
+							fractal.power = arguments["power"].toInt(conversionOk);
+							if (!*conversionOk) break;
+							*conversionOk = fractal.power >= FrameRenderer::MinPower && fractal.power <= FrameRenderer::MaxPower;
+							if (!*conversionOk) break;
+						}
+						if (!arguments["juliaX"].isEmpty()) {
+							fractal.juliaX = arguments["juliaX"].toDouble(conversionOk);
+							if (!*conversionOk) break;
+						}
+						if (!arguments["juliaY"].isEmpty()) {
+							fractal.juliaY = arguments["juliaY"].toDouble(conversionOk);
+							if (!*conversionOk) break;
+						}
+
+						// Optional, a region of the frame in its pixels: all four or none.
+						if (!arguments["regionX"].isEmpty() || !arguments["regionY"].isEmpty() ||
+							!arguments["regionWidth"].isEmpty() || !arguments["regionHeight"].isEmpty()) {
+							const int x = arguments["regionX"].toInt(conversionOk);
+							if (!*conversionOk) break;
+							const int y = arguments["regionY"].toInt(conversionOk);
+							if (!*conversionOk) break;
+							const int width = arguments["regionWidth"].toInt(conversionOk);
+							if (!*conversionOk) break;
+							const int height = arguments["regionHeight"].toInt(conversionOk);
+							if (!*conversionOk) break;
+							region = QRect(x, y, width, height);
+							*conversionOk = !region.isEmpty() && QRect(0, 0, resultWidth, resultHeight).contains(region);
+							if (!*conversionOk) break;
+						}
 					} while (false);
 
 					const bool ok = *conversionOk;
 					delete conversionOk;
 
 					if (!ok)
-						errorResponse(stream, HttpProtocol::StatusCode::BAD_REQUEST, HttpProtocol::ReasonPhrase::BAD_REQUEST);
+						errorResponse(stream, HttpProtocol::StatusCode::BAD_REQUEST, HttpProtocol::ReasonPhrase::BAD_REQUEST, keepAlive);
+					else if (!ImageCodec::negotiate(request[HttpProtocol::HeaderField::Name::ACCEPT], format))
+						errorResponse(stream, HttpProtocol::StatusCode::NOT_ACCEPTABLE, HttpProtocol::ReasonPhrase::NOT_ACCEPTABLE, keepAlive);
 					else {
-						QSize size(resultWidth, resultHeight);
-						m_renderer.render(descriptor, centerX, centerY, scaleFactor, size, pixelRatio, color);
+						m_formats.insert(descriptor, format);
+						const QSize size(resultWidth, resultHeight);
+						m_scheduler.submit({ descriptor, centerX, centerY, scaleFactor, size, pixelRatio, color, fractal, region,
+							RenderScheduler::priorityFor(size, pixelRatio, region), nullptr });
 						return;
 					}
 				}
@@ -173,30 +293,42 @@ void Server::parseRequest(qintptr descriptor, QTextStream& data)
 		catch (...) {
 			qWarning() << tr("ComputationServer")
 				<< tr("Server Rules in error!");
-			errorResponse(stream, HttpProtocol::StatusCode::INTERNAL_SERVER_ERROR, HttpProtocol::ReasonPhrase::INTERNAL_SERVER_ERROR);
+			errorResponse(stream, HttpProtocol::StatusCode::INTERNAL_SERVER_ERROR, HttpProtocol::ReasonPhrase::INTERNAL_SERVER_ERROR, keepAlive);
 		}
 	}
 	else
-		errorResponse(stream, HttpProtocol::StatusCode::BAD_REQUEST, HttpProtocol::ReasonPhrase::BAD_REQUEST);
+		errorResponse(stream, HttpProtocol::StatusCode::BAD_REQUEST, HttpProtocol::ReasonPhrase::BAD_REQUEST, keepAlive);
 
-	QByteArray buffered(message.toUtf8().constData(), message.length());
-	replyMessage(descriptor, buffered);
+	stream.flush();
+	replyMessage(descriptor, message);
 }
 
-void Server::respondImage(qintptr descriptor, const QImage& image, double scaleFactor)
+void Server::respondImage(qintptr descriptor, const QImage& image, double scaleFactor, const QRect& region)
 {
-	const QString info = image.text(RenderThread::infoKey());
-	QByteArray arr;
-	QBuffer buffer(&arr);
-	image.save(&buffer, "BMP");
-	const QByteArray imgBase64 = arr.toBase64();
-	QString message;
-	QTextStream stream(&message);
-
-	normalResponse(stream, info, scaleFactor, imgBase64, imgBase64.length(), true);
-
-	QByteArray buffered(message.toUtf8().constData(), message.length());
-	replyMessage(descriptor, buffered);
+	Connection* connection = find(descriptor);
+	const ImageCodec::Format format = m_formats.take(descriptor);
+	if (!connection || connection->state() != Connection::State::Dispatched)
+		return;
+
+	const QString info = image.text(RenderThread::infoKey()) + connectionInfo();
+	// A raw frame is its header, then the image's rows as they are.
+	const bool raw = format == ImageCodec::Format::Raw;
+	const QByteArray content = ImageCodec::encode(image, format);
+	const qsizetype length = content.length() + (raw ? image.sizeInBytes() : 0);
+	QByteArray header;
+	header.reserve(ResponseWriter::HeaderCapacity);
+	QTextStream stream(&header, QIODevice::WriteOnly);
+	normalResponse(stream, info, scaleFactor, region, ImageCodec::contentType(format), length,
+		connection->isKeepAlive());
+	stream.flush();
+
+	// The body is binary, it doesn't go through the text.
+	if (raw) {
+		header.append(content);
+		connection->reply(header, image);
+	}
+	else
+		connection->reply(header, content);
 }
 
 bool Server::lexicalHttpParser(QTextStream& stream, HttpData& result) const
@@ -298,32 +430,26 @@ Server::HttpData Server::readQueryString(const QString& uri) const
 	return container;
 }
 
-void Server::replyMessage(qintptr descriptor, const QByteArray& buffered)
+void Server::replyMessage(qintptr descriptor, const QByteArray& message)
 {
-	// The parent sends a message...
-	QTcpSocket* socket = nullptr;
-	for (QTcpSocket* s : m_connected) {
-		if (s->socketDescriptor() == descriptor) {
-			socket = s;
-			break;
-		}
-	}
+	// The parent sends a message, only the first one answers the request.
+	Connection* connection = find(descriptor);
+	if (connection && connection->state() == Connection::State::Dispatched)
+		connection->reply(message);
+}
 
-	if (socket && socket->isOpen()) {
-		qint64 sentCnt = socket->write(buffered);
-		qint64 cnt = buffered.length();
-		if (sentCnt != cnt) {
-			qWarning() << tr("ComputationServer") <<
-				tr(QString("Response sending with error bytes in %1 counted instead of %2 buffered.")
-					.arg(sentCnt).arg(cnt)
-					.toUtf8().constData());
-		}
-		if (sentCnt > 0) {
-			socket->flush();
-			socket->close();
-			m_connected.removeAt(m_connected.indexOf(socket));
-		}
-	}
+Connection* Server::find(qintptr descriptor) const
+{
+	const auto found = std::find_if(m_connected.cbegin(), m_connected.cend(),
+		[descriptor](const Connection* connection) { return connection->id() == descriptor; });
+	return found != m_connected.cend() ? *found : nullptr;
+}
+
+QString Server::connectionInfo() const
+{
+	const qint64 requests = qMax<qint64>(m_requestCount, 1);
+	return QString(", connections: %1, requests on a kept one: %2%").arg(m_connectionCount)
+		.arg(QString::number(100.0 * m_reusedCount / requests, 'f', 1));
 }
 
 QTextStream& Server::errorResponse(QTextStream& stream, int statusCode,
@@ -334,6 +460,7 @@ QTextStream& Server::errorResponse(QTextStream& stream, int statusCode,
 		Date: Wed, 9 October 2024 09:12:18 GMT
 		Server: Test Environment (Qt)
 		Connection: close
+		Content-Length: 0
 	*/
 
 	stream << HttpProtocol::VERSION << HttpProtocol::DELIMITER_TERM
@@ -343,13 +470,16 @@ QTextStream& Server::errorResponse(QTextStream& stream, int statusCode,
 		<< HttpProtocol::HeaderField::Name::SERVER << HttpProtocol::DELIMITER_FIELD << HttpProtocol::DELIMITER_TERM
 		<< HttpProtocol::HeaderField::Value::SERVER << HttpProtocol::DELIMITER_LINE
 		<< HttpProtocol::HeaderField::Name::CONNECTION << HttpProtocol::DELIMITER_FIELD << HttpProtocol::DELIMITER_TERM
-		<< (connection ? HttpProtocol::HeaderField::Value::CONNECTION_KEEP_ALIVE : HttpProtocol::HeaderField::Value::CONNECTION_CLOSE);
+		<< (connection ? HttpProtocol::HeaderField::Value::CONNECTION_KEEP_ALIVE : HttpProtocol::HeaderField::Value::CONNECTION_CLOSE) << HttpProtocol::DELIMITER_LINE
+		<< HttpProtocol::HeaderField::Name::CONTENT_LENGTH << HttpProtocol::DELIMITER_FIELD << HttpProtocol::DELIMITER_TERM
+		<< 0 << HttpProtocol::DELIMITER_LINE
+		<< HttpProtocol::DELIMITER_LINE;
 
 	return stream;
 }
 
 QTextStream& Server::normalResponse(QTextStream& stream, const QString& info,
-	double scaleFactor, const QByteArray& content, qsizetype length, bool connection) const
+	double scaleFactor, const QRect& region, const char* contentType, qsizetype length, bool connection) const
 {
 	/*
 		HTTP/1.1 200 OK
@@ -360,9 +490,10 @@ QTextStream& Server::normalResponse(QTextStream& stream, const QString& info,
 		E-Token: 9daba689bfc0c5b7ef021e0b0304822c
 		Server: Test Environment (Qt)
 		Scale-Factor: 0.06855
+		Region: 0 0 1024 768
 		Connection: keep-alive
 
-		Content...
+		Content... of the length, appended to the header
 	*/
 
 	const QString scale = QString::number(scaleFactor);
@@ -371,7 +502,7 @@ QTextStream& Server::normalResponse(QTextStream& stream, const QString& info,
 		<< HttpProtocol::HeaderField::Name::DATE << HttpProtocol::DELIMITER_FIELD << HttpProtocol::DELIMITER_TERM
 		<< Server::utcTimeEnglishText() << HttpProtocol::DELIMITER_LINE
 		<< HttpProtocol::HeaderField::Name::CONTENT_TYPE << HttpProtocol::DELIMITER_FIELD << HttpProtocol::DELIMITER_TERM
-		<< HttpProtocol::HeaderField::Value::CONTENT_TYPE_TEXT_PLAIN << HttpProtocol::DELIMITER_LINE
+		<< contentType << HttpProtocol::DELIMITER_LINE
 		<< HttpProtocol::HeaderField::Name::CONTENT_LENGTH << HttpProtocol::DELIMITER_FIELD << HttpProtocol::DELIMITER_TERM
 		<< length << HttpProtocol::DELIMITER_LINE
 		<< HttpProtocol::HeaderField::Name::INFO << HttpProtocol::DELIMITER_FIELD << HttpProtocol::DELIMITER_TERM
@@ -382,10 +513,12 @@ QTextStream& Server::normalResponse(QTextStream& stream, const QString& info,
 		<< HttpProtocol::HeaderField::Value::SERVER << HttpProtocol::DELIMITER_LINE
 		<< HttpProtocol::HeaderField::Name::SCALE_FACTOR << HttpProtocol::DELIMITER_FIELD << HttpProtocol::DELIMITER_TERM
 		<< scale << HttpProtocol::DELIMITER_LINE
+		<< HttpProtocol::HeaderField::Name::REGION << HttpProtocol::DELIMITER_FIELD << HttpProtocol::DELIMITER_TERM
+		<< region.x() << HttpProtocol::DELIMITER_TERM << region.y() << HttpProtocol::DELIMITER_TERM
+		<< region.width() << HttpProtocol::DELIMITER_TERM << region.height() << HttpProtocol::DELIMITER_LINE
 		<< HttpProtocol::HeaderField::Name::CONNECTION << HttpProtocol::DELIMITER_FIELD << HttpProtocol::DELIMITER_TERM
 		<< (connection ? HttpProtocol::HeaderField::Value::CONNECTION_KEEP_ALIVE : HttpProtocol::HeaderField::Value::CONNECTION_CLOSE) << HttpProtocol::DELIMITER_LINE
-		<< HttpProtocol::DELIMITER_LINE
-		<< content;
+		<< HttpProtocol::DELIMITER_LINE;
 
 	return stream;
 }
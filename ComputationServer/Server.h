@@ -1,11 +1,15 @@
 #ifndef MANDELBROTSERVER_H
 #define MANDELBROTSERVER_H 
 
+#include <QHash>
 #include <QList>
 #include <QMap>
+#include <QRect>
 #include <QTcpServer>
 #include <QTcpSocket>
-#include "RenderThread.h"
+#include "Connection.h"
+#include "ImageCodec.h"
+#include "RenderScheduler.h"
 
 
 namespace Mandelbrot
@@ -24,32 +28,44 @@ namespace Mandelbrot
 
 		private slots:
 			void useConnection();
+			void dispatch(Connection* connection, const QByteArray& header);
+			void reject(Connection* connection, int statusCode, const char* reasonPhrase);
+			void removeConnection(Connection* connection);
 
 		private:
 			void parseRequest(qintptr descriptor, QTextStream& data);
-			void respondImage(qintptr descriptor, const QImage& image, double scaleFactor);
+			void respondImage(qintptr descriptor, const QImage& image, double scaleFactor, const QRect& region);
 
 			typedef QMap<QString, QString> HttpData;
 
 			bool lexicalHttpParser(QTextStream& stream, HttpData& result) const;
 			HttpData readQueryString(const QString& uri) const;
 
-			void replyMessage(qintptr descriptor, const QByteArray& buffered);
+			void replyMessage(qintptr descriptor, const QByteArray& message);
+			Connection* find(qintptr descriptor) const;
+			QString connectionInfo() const;
 
 			QTextStream& errorResponse(QTextStream& stream, int statusCode,
 				const char* reasonPhrase, bool connection = false) const;
 			QTextStream& normalResponse(QTextStream& stream, const QString& info,
-				double scaleFactor, const QByteArray& content, qsizetype length, bool connection = false) const;
+				double scaleFactor, const QRect& region, const char* contentType, qsizetype length,
+				bool connection = false) const;
 
 			// optionally
 			static QString generateToken();
 
 			static QString utcTimeEnglishText();
 
-			QList<QTcpSocket*> m_connected;
-			RenderThread m_renderer;
+			QList<Connection*> m_connected;
+			// The format of the image each dispatched request is waiting for.
+			QHash<qintptr, ImageCodec::Format> m_formats;
+			RenderScheduler m_scheduler;
 			QHostAddress m_address;
 			quint16 m_port;
+			// Accepted, and the requests answered on them, some after others.
+			qint64 m_connectionCount;
+			qint64 m_requestCount;
+			qint64 m_reusedCount;
 		};
 	}
 }
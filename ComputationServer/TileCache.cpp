@@ -0,0 +1,116 @@
+#include "FrameRenderer.h"
+#include "TileCache.h"
+#include "TileStore.h"
+#include <QMutexLocker>
+#include <QString>
+#include <QtGlobal>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+
+using namespace Mandelbrot::ComputationServer;
+using Mandelbrot::Common::FrameRenderer;
+
+TileCache::TileCache() = default;
+
+TileCache::~TileCache() = default;
+
+void TileCache::setBudget(qint64 bytes)
+{
+	QMutexLocker locker(&m_mutex);
+	m_budget = qMax<qint64>(bytes, 0);
+	m_tiles.setMaxCost(m_budget);
+}
+
+void TileCache::setStore(const QString& path, qint64 bytes)
+{
+	QMutexLocker locker(&m_mutex);
+	m_store = std::make_unique<TileStore>(path, bytes);
+}
+
+TileCache::Tile TileCache::find(const Key& key)
+{
+	TileStore* store;
+	{
+		QMutexLocker locker(&m_mutex);
+		const Tile* tile = m_tiles.object(key);
+		if (tile) {
+			++m_hits;
+			return *tile;
+		}
+		store = m_store.get();
+	}
+
+	// The tiles on disk are not copied to memory, they are read from the mapping.
+	const Tile tile = store ? store->find(key) : Tile();
+	QMutexLocker locker(&m_mutex);
+	if (tile)
+		++m_hits;
+	else
+		++m_misses;
+	return tile;
+}
+
+void TileCache::insert(const Key& key, const float* smooth, qsizetype stride)
+{
+	TileStore* store;
+	{
+		QMutexLocker locker(&m_mutex);
+		keep(key, smooth, stride);
+		store = m_store.get();
+	}
+	if (store)
+		store->insert(key, smooth, stride);
+}
+
+qint64 TileCache::hits() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_hits;
+}
+
+qint64 TileCache::misses() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_misses;
+}
+
+bool TileCache::isCacheable(double x, double y, double scaleFactor, FrameRenderer::Family family)
+{
+	// Deeper frames carry their centre in more digits than a double holds.
+	const FrameRenderer::Precision precision = FrameRenderer::precisionFor(scaleFactor, family);
+	if (precision != FrameRenderer::Precision::Float && precision != FrameRenderer::Precision::Double)
+		return false;
+
+	const double limit = std::ldexp(1.0, 50);
+	return std::fabs(x / scaleFactor) < limit && std::fabs(y / scaleFactor) < limit;
+}
+
+qint64 TileCache::tileOf(qint64 pixel)
+{
+	return pixel >= 0 ? pixel / TileSize : -((-pixel + TileSize - 1) / TileSize);
+}
+
+quint32 TileCache::renderModeBits()
+{
+	return (FrameRenderer::isSubdivision() ? 1u : 0u) | (FrameRenderer::isSymmetry() ? 2u : 0u)
+		| (FrameRenderer::isPerturbation() ? 4u : 0u);
+}
+
+void TileCache::keep(const Key& key, const float* smooth, qsizetype stride)
+{
+	if (m_budget <= 0)
+		return;
+
+	float* counts = new float[TileSize * TileSize];
+	for (int y = 0; y < TileSize; ++y)
+		std::memcpy(counts + (y * TileSize), smooth + (y * stride), TileSize * sizeof(float));
+	m_tiles.insert(key, new Tile(counts, std::default_delete<const float[]>()), qsizetype(TileSize * TileSize * sizeof(float)));
+}
+
+TileCache& TileCache::instance()
+{
+	static TileCache cache;
+	return cache;
+}
@@ -0,0 +1,98 @@
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include "FrameRenderer.h"
+#include <QCache>
+#include <QHashFunctions>
+#include <QMutex>
+#include <QString>
+#include <QtGlobal>
+#include <memory>
+
+
+namespace Mandelbrot
+{
+	namespace ComputationServer
+	{
+		class TileStore;
+
+		// Rendered tiles shared by all the requests, as continuous iteration counts so that
+		// any palette colours them. The tiles are squares of TileSize pixels on a grid anchored
+		// at the origin of the plane, one grid per pixel spacing; a frame is snapped to it by
+		// less than half a pixel. Past the byte budget the least recently used tiles are dropped;
+		// a TileStore may keep them on disk as well, where the page cache holds the hot ones.
+		class TileCache
+		{
+		public:
+			TileCache();
+			~TileCache();
+
+			struct Key
+			{
+				Common::FrameRenderer::Fractal fractal;
+				double scaleFactor;
+				qint64 x;
+				qint64 y;
+				// The budget of the last pass of the frames the tile comes from.
+				int maxIterations;
+				// The renderModeBits() it was rendered with.
+				quint32 mode;
+
+				friend bool operator==(const Key& a, const Key& b)
+				{
+					return a.fractal == b.fractal && a.scaleFactor == b.scaleFactor && a.x == b.x && a.y == b.y
+						&& a.maxIterations == b.maxIterations && a.mode == b.mode;
+				}
+
+				friend size_t qHash(const Key& key, size_t seed = 0)
+				{
+					return qHashMulti(seed, int(key.fractal.family), key.fractal.power, key.fractal.juliaX,
+						key.fractal.juliaY, key.scaleFactor, key.x, key.y, key.maxIterations, key.mode);
+				}
+			};
+
+			// 0 bytes disables the cache in memory.
+			void setBudget(qint64 bytes);
+			// The tiles missing in memory are looked up on disk, and all of them are written there.
+			void setStore(const QString& path, qint64 bytes);
+			bool isEnabled() const { return m_budget > 0 || m_store; }
+
+			// TileSize rows of TileSize counts, in memory or in the store's mapping, which
+			// stay valid while the tile is held.
+			typedef std::shared_ptr<const float> Tile;
+
+			// Null when missing; counts a hit or a miss. The store is looked up without the
+			// lock of the memory.
+			Tile find(const Key& key);
+			void insert(const Key& key, const float* smooth, qsizetype stride);
+
+			qint64 hits() const;
+			qint64 misses() const;
+
+			// The frame is shallow enough for the grid indices of its pixels to be exact.
+			static bool isCacheable(double x, double y, double scaleFactor, Common::FrameRenderer::Family family);
+			// The tile of a pixel of the grid, rounding down.
+			static qint64 tileOf(qint64 pixel);
+			// The FrameRenderer settings the counts depend on, a tile of the exact rendering
+			// differs from an approximated one.
+			static quint32 renderModeBits();
+
+			// The process wide cache, disabled until it is given a budget.
+			static TileCache& instance();
+
+			static constexpr int TileSize = 64;
+
+		private:
+			void keep(const Key& key, const float* smooth, qsizetype stride);
+
+			mutable QMutex m_mutex;
+			QCache<Key, Tile> m_tiles;
+			std::unique_ptr<TileStore> m_store;
+			qint64 m_budget = 0;
+			qint64 m_hits = 0;
+			qint64 m_misses = 0;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,341 @@
+#include "FrameRenderer.h"
+#include "TileCache.h"
+#include "TileStore.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QIODevice>
+#include <QMutexLocker>
+#include <QString>
+#include <QtGlobal>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+using namespace Mandelbrot::ComputationServer;
+using Mandelbrot::Common::FrameRenderer;
+
+namespace
+{
+	struct Header
+	{
+		char magic[4];
+		qint32 version;
+		qint32 tileSize;
+		qint32 reserved;
+	};
+
+	struct IndexRecord
+	{
+		qint32 family;
+		qint32 power;
+		double juliaX;
+		double juliaY;
+		double scaleFactor;
+		qint64 x;
+		qint64 y;
+		qint32 maxIterations;
+		quint32 mode;
+		qint64 offset;
+	};
+
+	const Header StoreHeader = { { 'M', 'T', 'S', 'T' }, 2, TileCache::TileSize, 0 };
+	constexpr qint64 HeaderSize = sizeof(Header);
+
+	IndexRecord recordOf(const TileCache::Key& key, qint64 offset)
+	{
+		return { qint32(key.fractal.family), key.fractal.power, key.fractal.juliaX, key.fractal.juliaY,
+			key.scaleFactor, key.x, key.y, key.maxIterations, key.mode, offset };
+	}
+
+	TileCache::Key keyOf(const IndexRecord& record)
+	{
+		return { { FrameRenderer::Family(record.family), record.power, record.juliaX, record.juliaY },
+			record.scaleFactor, record.x, record.y, record.maxIterations, record.mode };
+	}
+}
+
+TileStore::TileStore(const QString& path, qint64 budget) :
+	m_path(path),
+	m_budget(budget)
+{
+}
+
+TileStore::~TileStore()
+{
+	m_stopping = true;
+	if (m_compactor.joinable())
+		m_compactor.join();
+
+	QMutexLocker locker(&m_mutex);
+	if (m_opened && !m_failed)
+		flushIndex();
+}
+
+TileCache::Tile TileStore::find(const TileCache::Key& key)
+{
+	QMutexLocker locker(&m_mutex);
+	if (!m_opened)
+		open();
+	if (m_failed)
+		return TileCache::Tile();
+
+	const auto it = m_entries.find(key);
+	if (it == m_entries.end())
+		return TileCache::Tile();
+
+	const std::shared_ptr<Region> mapped = region(it->offset);
+	if (!mapped)
+		return TileCache::Tile();
+
+	it->used = ++m_clock;
+	return TileCache::Tile(mapped, reinterpret_cast<const float*>(mapped->data + offsetInRegion(it->offset)));
+}
+
+void TileStore::insert(const TileCache::Key& key, const float* smooth, qsizetype stride)
+{
+	QMutexLocker locker(&m_mutex);
+	if (!m_opened)
+		open();
+	if (m_failed)
+		return;
+
+	const auto it = m_entries.find(key);
+	if (it != m_entries.end()) {
+		it->used = ++m_clock;
+		return;
+	}
+
+	// The region is reserved before the tile is written into it. The tile is flushed for
+	// the mapping to see it, its index record with the next batch; a crash loses the
+	// records of the batch and the tiles are written over.
+	const qint64 offset = m_end;
+	bool written = region(offset) && m_data.seek(offset);
+	for (int y = 0; written && y < TileCache::TileSize; ++y) {
+		const qint64 bytes = TileCache::TileSize * sizeof(float);
+		written = m_data.write(reinterpret_cast<const char*>(smooth + (y * stride)), bytes) == bytes;
+	}
+	const IndexRecord record = recordOf(key, offset);
+	written = written && m_data.flush()
+		&& m_index.write(reinterpret_cast<const char*>(&record), sizeof(record)) == sizeof(record)
+		&& (++m_unflushed < IndexBatch || flushIndex());
+	if (!written) {
+		qWarning() << QCoreApplication::translate("ComputationServer", "Can't write to the tile store") << m_data.fileName();
+		m_failed = true;
+		return;
+	}
+
+	m_entries.insert(key, { offset, ++m_clock });
+	m_end = offset + TileBytes;
+	if (m_end > m_budget && !m_compacting)
+		startCompaction();
+}
+
+bool TileStore::open()
+{
+	m_opened = true;
+	m_data.setFileName(m_path + ".dat");
+	m_index.setFileName(m_path + ".idx");
+	if (!openFiles(m_data, m_index, false)) {
+		qWarning() << QCoreApplication::translate("ComputationServer", "Can't open the tile store") << m_path;
+		m_failed = true;
+		return false;
+	}
+
+	loadIndex();
+	// The records are appended from there on.
+	m_index.seek(m_index.size());
+	return true;
+}
+
+bool TileStore::openFiles(QFile& data, QFile& index, bool reset)
+{
+	if (!data.open(QIODevice::ReadWrite) || !index.open(QIODevice::ReadWrite))
+		return false;
+
+	// Files of another layout, or new ones, start over with their headers.
+	Header dataHeader{};
+	Header indexHeader{};
+	const bool valid = !reset
+		&& data.read(reinterpret_cast<char*>(&dataHeader), sizeof(Header)) == sizeof(Header)
+		&& index.read(reinterpret_cast<char*>(&indexHeader), sizeof(Header)) == sizeof(Header)
+		&& std::memcmp(&dataHeader, &StoreHeader, sizeof(Header)) == 0
+		&& std::memcmp(&indexHeader, &StoreHeader, sizeof(Header)) == 0;
+	if (valid)
+		return true;
+
+	return data.resize(0) && index.resize(0) && data.seek(0) && index.seek(0)
+		&& data.write(reinterpret_cast<const char*>(&StoreHeader), sizeof(Header)) == sizeof(Header)
+		&& index.write(reinterpret_cast<const char*>(&StoreHeader), sizeof(Header)) == sizeof(Header)
+		&& data.flush() && index.flush();
+}
+
+void TileStore::loadIndex()
+{
+	// A record half written by a crash is cut off, the appends stay aligned. The data file
+	// is reserved by regions, the tiles end where the last record's does.
+	m_index.seek(HeaderSize);
+	const QByteArray records = m_index.readAll();
+	const qsizetype count = records.size() / qsizetype(sizeof(IndexRecord));
+	if (records.size() != count * qsizetype(sizeof(IndexRecord)))
+		m_index.resize(HeaderSize + (count * qint64(sizeof(IndexRecord))));
+
+	const qint64 dataSize = m_data.size();
+	m_end = HeaderSize;
+	m_entries.reserve(count);
+	for (qsizetype i = 0; i < count; ++i) {
+		IndexRecord record;
+		std::memcpy(&record, records.constData() + (i * sizeof(IndexRecord)), sizeof(IndexRecord));
+		if (record.offset >= HeaderSize && record.offset + TileBytes <= dataSize
+			&& (record.offset - HeaderSize) % TileBytes == 0) {
+			m_entries.insert(keyOf(record), { record.offset, 0 });
+			m_end = std::max(m_end, record.offset + TileBytes);
+		}
+	}
+}
+
+std::shared_ptr<TileStore::Region> TileStore::region(qint64 offset)
+{
+	const qint64 index = regionOf(offset);
+	if (index < qint64(m_regions.size()) && m_regions[index])
+		return m_regions[index];
+
+	// Mapped whole, past the end of the file its pages would fault.
+	const qint64 first = HeaderSize + (index * RegionBytes);
+	std::shared_ptr<Region> mapped = std::make_shared<Region>();
+	mapped->file.setFileName(m_data.fileName());
+	if ((m_data.size() < first + RegionBytes && !m_data.resize(first + RegionBytes))
+		|| !mapped->file.open(QIODevice::ReadOnly) || !(mapped->data = mapped->file.map(first, RegionBytes))) {
+		qWarning() << QCoreApplication::translate("ComputationServer", "Can't map the tile store") << m_data.fileName();
+		m_failed = true;
+		return nullptr;
+	}
+
+	if (index >= qint64(m_regions.size()))
+		m_regions.resize(index + 1);
+	m_regions[index] = mapped;
+	return mapped;
+}
+
+const uchar* TileStore::tileAt(qint64 offset)
+{
+	const std::shared_ptr<Region> mapped = region(offset);
+	return mapped ? mapped->data + offsetInRegion(offset) : nullptr;
+}
+
+qint64 TileStore::regionOf(qint64 offset)
+{
+	return (offset - HeaderSize) / RegionBytes;
+}
+
+qint64 TileStore::offsetInRegion(qint64 offset)
+{
+	return (offset - HeaderSize) % RegionBytes;
+}
+
+bool TileStore::flushIndex()
+{
+	m_unflushed = 0;
+	return m_index.flush();
+}
+
+void TileStore::startCompaction()
+{
+	// The most recently used tiles, up to half the budget, as they are now; their regions
+	// are mapped meanwhile, the thread reads them without the lock.
+	Entries entries;
+	entries.reserve(m_entries.size());
+	for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it)
+		entries.emplace_back(it.key(), it.value());
+	std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.second.used > b.second.used; });
+	entries.resize(std::min(entries.size(), size_t(std::max<qint64>((m_budget / 2 - HeaderSize) / TileBytes, 0))));
+	for (const auto& entry : entries) {
+		if (!region(entry.second.offset))
+			return;
+	}
+
+	if (m_compactor.joinable())
+		m_compactor.join();
+	m_compacting = true;
+	m_compactedClock = m_clock;
+	m_compactor = std::thread(&TileStore::compact, this, std::move(entries));
+}
+
+void TileStore::compact(Entries entries)
+{
+	// The kept tiles are written to new files which then replace the old ones. The mapped
+	// regions stay valid whatever is appended to the file meanwhile.
+	std::vector<std::shared_ptr<Region>> regions;
+	{
+		QMutexLocker locker(&m_mutex);
+		regions = m_regions;
+	}
+
+	QFile data(m_path + ".dat.new");
+	QFile index(m_path + ".idx.new");
+	bool written = openFiles(data, index, true);
+	QHash<TileCache::Key, Entry> kept;
+	qint64 offset = HeaderSize;
+	for (const auto& entry : entries) {
+		if (!written || m_stopping)
+			break;
+		const uchar* tile = regions[regionOf(entry.second.offset)]->data + offsetInRegion(entry.second.offset);
+		written = copyTile(data, index, entry.first, tile, offset);
+		kept.insert(entry.first, { offset, entry.second.used });
+		offset += TileBytes;
+	}
+	regions.clear();
+
+	QMutexLocker locker(&m_mutex);
+	// The tiles inserted or used since go as well, the others keep the time of their use.
+	for (auto it = m_entries.cbegin(); written && !m_stopping && it != m_entries.cend(); ++it) {
+		const auto found = kept.find(it.key());
+		if (found != kept.end()) {
+			found->used = it->used;
+		}
+		else if (it->used > m_compactedClock) {
+			const uchar* tile = tileAt(it->offset);
+			written = tile && copyTile(data, index, it.key(), tile, offset);
+			kept.insert(it.key(), { offset, it->used });
+			offset += TileBytes;
+		}
+	}
+	written = written && data.flush() && index.flush();
+	data.close();
+	index.close();
+	m_compacting = false;
+	if (m_stopping) {
+		QFile::remove(data.fileName());
+		QFile::remove(index.fileName());
+		return;
+	}
+
+	// The tiles handed out keep their regions of the old file.
+	m_regions.clear();
+	m_data.close();
+	m_index.close();
+	m_unflushed = 0;
+	written = written && QFile::remove(m_data.fileName()) && QFile::remove(m_index.fileName())
+		&& data.rename(m_data.fileName()) && index.rename(m_index.fileName())
+		&& openFiles(m_data, m_index, false) && m_index.seek(m_index.size());
+	if (!written) {
+		qWarning() << QCoreApplication::translate("ComputationServer", "Can't compact the tile store") << m_path;
+		m_failed = true;
+		return;
+	}
+
+	m_entries = std::move(kept);
+	m_end = offset;
+}
+
+bool TileStore::copyTile(QFile& data, QFile& index, const TileCache::Key& key, const uchar* tile, qint64 offset)
+{
+	const IndexRecord record = recordOf(key, offset);
+	return data.write(reinterpret_cast<const char*>(tile), TileBytes) == TileBytes
+		&& index.write(reinterpret_cast<const char*>(&record), sizeof(record)) == sizeof(record);
+}
@@ -0,0 +1,108 @@
+#ifndef TILESTORE_H
+#define TILESTORE_H
+
+#include "TileCache.h"
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace Mandelbrot
+{
+	namespace ComputationServer
+	{
+		// The tiles of the TileCache kept on disk across restarts: an append-only data file
+		// of the tiles and an index file of their keys and offsets. The data file grows by
+		// regions of RegionTiles tiles, each mapped once, so a lookup is a pointer into the
+		// mapping. Nothing is read before the first lookup, and then only the index, whose
+		// records are flushed by batches. Past the byte budget a background thread compacts
+		// the data file to the most recently used half while the lookups go on.
+		class TileStore
+		{
+		public:
+			// The files are the path with .dat and .idx appended.
+			TileStore(const QString& path, qint64 budget);
+			~TileStore();
+
+			TileStore(const TileStore&) = delete;
+			TileStore& operator=(const TileStore&) = delete;
+
+			// A pointer into the mapping, valid while it is held.
+			TileCache::Tile find(const TileCache::Key& key);
+			void insert(const TileCache::Key& key, const float* smooth, qsizetype stride);
+
+			static constexpr qint64 DefaultBudget = qint64(1) << 30;
+
+		private:
+			struct Entry
+			{
+				qint64 offset;
+				// The clock at the last use.
+				quint64 used;
+			};
+
+			// A region of the data file, unmapped once the store and the tiles handed out
+			// drop it; it outlives a compaction which replaces the file.
+			struct Region
+			{
+				QFile file;
+				uchar* data = nullptr;
+
+				~Region()
+				{
+					if (data)
+						file.unmap(data);
+				}
+			};
+
+			typedef std::vector<std::pair<TileCache::Key, Entry>> Entries;
+
+			bool open();
+			bool openFiles(QFile& data, QFile& index, bool reset);
+			void loadIndex();
+			std::shared_ptr<Region> region(qint64 offset);
+			const uchar* tileAt(qint64 offset);
+			static qint64 regionOf(qint64 offset);
+			static qint64 offsetInRegion(qint64 offset);
+			bool flushIndex();
+			void startCompaction();
+			void compact(Entries entries);
+			bool copyTile(QFile& data, QFile& index, const TileCache::Key& key, const uchar* tile, qint64 offset);
+
+			QString m_path;
+			qint64 m_budget;
+			QMutex m_mutex;
+			bool m_opened = false;
+			bool m_failed = false;
+			QFile m_data;
+			QFile m_index;
+			// Where the next tile goes.
+			qint64 m_end = 0;
+			std::vector<std::shared_ptr<Region>> m_regions;
+			QHash<TileCache::Key, Entry> m_entries;
+			quint64 m_clock = 0;
+			// The index records written since the last flush.
+			int m_unflushed = 0;
+
+			std::thread m_compactor;
+			bool m_compacting = false;
+			// The clock when the compaction took its entries.
+			quint64 m_compactedClock = 0;
+			std::atomic<bool> m_stopping = false;
+
+			static constexpr qint64 TileBytes = qint64(TileCache::TileSize) * TileCache::TileSize * sizeof(float);
+			static constexpr qint64 RegionTiles = 4096;
+			static constexpr qint64 RegionBytes = RegionTiles * TileBytes;
+			static constexpr int IndexBatch = 64;
+		};
+	}
+}
+
+#endif
@@ -1,11 +1,15 @@
 #include <QCommandLineOption>
 #include <QCommandLineParser>
 #include <QCoreApplication>
+#include "EscapeTimeKernel.h"
+#include "FrameRenderer.h"
 #include "RenderThread.h"
 #include "Server.h"
 
 
 using namespace Mandelbrot::ComputationServer;
+using Mandelbrot::Common::EscapeTimeKernel;
+using Mandelbrot::Common::FrameRenderer;
 using namespace Qt::Literals::StringLiterals;
 
 int main(int argc, char* argv[])
@@ -20,6 +24,13 @@ int main(int argc, char* argv[])
 	parser.addOption(configOption);
 	QCommandLineOption passesOption(u"passes"_s, u"Number of passes (1-8)"_s, u"passes"_s);
 	parser.addOption(passesOption);
+	QCommandLineOption simdOption(u"simd"_s, u"Kernel instruction set (scalar, sse2, avx2, avx512)"_s, u"set"_s);
+	parser.addOption(simdOption);
+	QCommandLineOption exactOption(u"exact"_s, u"Exact per-pixel rendering, no rectangle subdivision, mirrored rows or perturbation"_s);
+	parser.addOption(exactOption);
+	QCommandLineOption adaptiveOption(u"adaptive"_s,
+		u"Adaptive iteration budget, refining until a pass changes less than the fraction of pixels (0-1)"_s, u"fraction"_s);
+	parser.addOption(adaptiveOption);
 	parser.process(app);
 
 	if (parser.isSet(passesOption)) {
@@ -33,6 +44,36 @@ int main(int argc, char* argv[])
 		RenderThread::setNumPasses(passes);
 	}
 
+	if (parser.isSet(simdOption)) {
+		const auto simdStr = parser.value(simdOption).toLower();
+		EscapeTimeKernel::InstructionSet set;
+		if (!EscapeTimeKernel::fromName(simdStr.toUtf8().constData(), set)) {
+			qWarning() << "Invalid value:" << simdStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+		if (!EscapeTimeKernel::setInstructionSet(set)) {
+			qWarning() << "Unsupported by the CPU:" << simdStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (parser.isSet(exactOption)) {
+		FrameRenderer::setSubdivision(false);
+		FrameRenderer::setSymmetry(false);
+		FrameRenderer::setPerturbation(false);
+	}
+
+	if (parser.isSet(adaptiveOption)) {
+		const auto adaptiveStr = parser.value(adaptiveOption);
+		bool ok;
+		const double tolerance = adaptiveStr.toDouble(&ok);
+		if (!ok || tolerance <= 0.0 || tolerance >= 1.0) {
+			qWarning() << "Invalid value:" << adaptiveStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+		RenderThread::setAdaptiveTolerance(tolerance);
+	}
+
 	Server server;
 	if (parser.isSet(configOption)) {
 		const auto cfgPath = parser.value(configOption);
@@ -0,0 +1,78 @@
+#include <QByteArray>
+#include <QTest>
+#include "Connection.h"
+#include "Test_Connection.h"
+
+
+using namespace Mandelbrot::UnitTest;
+using Mandelbrot::ComputationServer::Connection;
+
+void Test_Connection::findHeaderEnd()
+{
+	// test case 1: CR LF
+	QByteArray buffer("GET / HTTP/1.1\r\nHost: 127.0.0.1:8055\r\n\r\nGET /next");
+	qsizetype scanned = 0;
+	QCOMPARE(Connection::headerEnd(buffer, scanned), qsizetype(40));
+	QVERIFY(buffer.left(40).endsWith("\r\n\r\n"));
+
+	// test case 2: bare LF
+	buffer = "GET / HTTP/1.1\nHost: 127.0.0.1:8055\n\n";
+	scanned = 0;
+	QCOMPARE(Connection::headerEnd(buffer, scanned), buffer.size());
+
+	// test case 3: the blank lines before a request line are dropped
+	buffer = "\r\n\nGET / HTTP/1.1\r\n\r\n";
+	scanned = 0;
+	QCOMPARE(Connection::headerEnd(buffer, scanned), qsizetype(18));
+	QVERIFY(buffer.startsWith("GET "));
+
+	// test case 4: no blank line yet
+	buffer = "GET / HTTP/1.1\r\nHost: 127.0.0.1:8055\r\n";
+	scanned = 0;
+	QCOMPARE(Connection::headerEnd(buffer, scanned), qsizetype(-1));
+	QCOMPARE(scanned, buffer.size());
+}
+
+void Test_Connection::findHeaderEndIncrementally()
+{
+	// The bytes arrive one by one, the search resumes where it stopped.
+	const QByteArray request("\r\nGET /?centerX=0.5 HTTP/1.1\r\nAccept: image/qoi\r\n\r\n");
+	QByteArray buffer;
+	qsizetype scanned = 0;
+	qsizetype end = -1;
+	for (char c : request) {
+		QCOMPARE(end, qsizetype(-1));
+		buffer.append(c);
+		end = Connection::headerEnd(buffer, scanned);
+	}
+	QCOMPARE(end, request.size() - 2);
+	QCOMPARE(buffer, request.mid(2));
+}
+
+void Test_Connection::readContentLength()
+{
+	QCOMPARE(Connection::contentLength("GET / HTTP/1.1\r\nHost: a\r\n\r\n"), qsizetype(0));
+	QCOMPARE(Connection::contentLength("POST / HTTP/1.1\r\nContent-Length: 12\r\n\r\n"), qsizetype(12));
+	QCOMPARE(Connection::contentLength("POST / HTTP/1.1\ncontent-length:7\n\n"), qsizetype(7));
+	QCOMPARE(Connection::contentLength("POST / HTTP/1.1\r\nContent-Length: -5\r\n\r\n"), qsizetype(-1));
+	QCOMPARE(Connection::contentLength("POST / HTTP/1.1\r\nContent-Length: many\r\n\r\n"), qsizetype(-1));
+}
+
+void Test_Connection::keepAlive()
+{
+	// test case 1: HTTP/1.1 is persistent unless closed
+	QVERIFY(Connection::keepAliveFor("GET / HTTP/1.1\r\nHost: a\r\n\r\n", 0));
+	QVERIFY(Connection::keepAliveFor("GET / HTTP/1.1\r\nConnection: keep-alive\r\n\r\n", 0));
+	QVERIFY(!Connection::keepAliveFor("GET / HTTP/1.1\r\nConnection: Close\r\n\r\n", 0));
+
+	// test case 2: HTTP/1.0 only when asked for
+	QVERIFY(!Connection::keepAliveFor("GET / HTTP/1.0\r\nHost: a\r\n\r\n", 0));
+	QVERIFY(Connection::keepAliveFor("GET / HTTP/1.0\nConnection: Keep-Alive\n\n", 0));
+
+	// test case 3: the last of the requests allowed closes the connection
+	const int maxRequests = Connection::maxRequestCount();
+	Connection::setMaxRequests(3);
+	QVERIFY(Connection::keepAliveFor("GET / HTTP/1.1\r\n\r\n", 1));
+	QVERIFY(!Connection::keepAliveFor("GET / HTTP/1.1\r\n\r\n", 2));
+	Connection::setMaxRequests(maxRequests);
+}
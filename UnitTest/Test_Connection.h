@@ -0,0 +1,18 @@
+#include <QObject>
+
+
+namespace Mandelbrot
+{
+	namespace UnitTest
+	{
+		class Test_Connection : public QObject
+		{
+			Q_OBJECT
+		private slots:
+			void findHeaderEnd();
+			void findHeaderEndIncrementally();
+			void readContentLength();
+			void keepAlive();
+		};
+	}
+}
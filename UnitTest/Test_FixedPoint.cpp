@@ -0,0 +1,94 @@
+#include <QString>
+#include <QTest>
+#include <string>
+#include "FixedPoint.h"
+#include "Test_FixedPoint.h"
+
+
+using namespace Mandelbrot::UnitTest;
+using Mandelbrot::Common::FixedPoint;
+
+namespace
+{
+	QString printed(const char* text, int decimals = -1)
+	{
+		FixedPoint value;
+		if (!FixedPoint::parse(text, value))
+			return QStringLiteral("invalid");
+		return QString::fromStdString(value.toString(decimals));
+	}
+}
+
+void Test_FixedPoint::parseDecimals()
+{
+	// test case 1: all the digits come back
+	QCOMPARE(printed("0.125"), QString("0.125"));
+	QCOMPARE(printed("-1.5"), QString("-1.5"));
+	QCOMPARE(printed("0.1"), QString("0.1"));
+	QCOMPARE(printed("12.345678901234567890123"), QString("12.345678901234567890123"));
+	QCOMPARE(printed("4294967295.5"), QString("4294967295.5"));
+
+	// test case 2: exponents, signs and spaces
+	QCOMPARE(printed("1e-3"), QString("0.001"));
+	QCOMPARE(printed("2.5e1"), QString("25"));
+	QCOMPARE(printed("+3"), QString("3"));
+	QCOMPARE(printed("  -0.5  "), QString("-0.5"));
+	QCOMPARE(printed("-0"), QString("0"));
+
+	// test case 3: the fraction is sized to the digits
+	FixedPoint value;
+	QVERIFY(FixedPoint::parse("0.5", value));
+	QCOMPARE(value.fractionLimbs(), FixedPoint::MinFractionLimbs);
+	QVERIFY(FixedPoint::parse("0.000000000000000000000000000000000000001", value));
+	QVERIFY(value.fractionLimbs() > FixedPoint::MinFractionLimbs);
+	QVERIFY(!value.isNegative());
+}
+
+void Test_FixedPoint::rejectMalformed()
+{
+	FixedPoint value;
+	QVERIFY(!FixedPoint::parse("", value));
+	QVERIFY(!FixedPoint::parse("abc", value));
+	QVERIFY(!FixedPoint::parse("1..2", value));
+	QVERIFY(!FixedPoint::parse("1e", value));
+	QVERIFY(!FixedPoint::parse("0.5x", value));
+	// The integer part is 32 bits.
+	QVERIFY(!FixedPoint::parse("4294967296", value));
+}
+
+void Test_FixedPoint::roundDecimals()
+{
+	// test case 1: the last decimal is rounded half up, the trailing zeros are dropped
+	QCOMPARE(printed("0.125", 2), QString("0.13"));
+	QCOMPARE(printed("0.125", 3), QString("0.125"));
+	QCOMPARE(printed("12.345678901234567890123", 2), QString("12.35"));
+	QCOMPARE(printed("12.345678901234567890123", 3), QString("12.346"));
+	QCOMPARE(printed("0.999", 2), QString("1"));
+	QCOMPARE(printed("4294967295.5", 0), QString("4294967296"));
+
+	// test case 2: negatives round away from zero, a zero has no sign
+	QCOMPARE(printed("-1.5", 0), QString("-2"));
+	QCOMPARE(printed("-0.75", 0), QString("-1"));
+	QCOMPARE(printed("-0.75", 1), QString("-0.8"));
+	QCOMPARE(printed("-0.0004", 3), QString("0"));
+
+	// test case 3: what the widget sends is read back to the same decimals
+	FixedPoint value;
+	const int decimals = FixedPoint::decimalsFor(1e-20);
+	QVERIFY(FixedPoint::parse("-0.7436438870371587522", value));
+	FixedPoint sent;
+	QVERIFY(FixedPoint::parse(value.toString(decimals), sent));
+	QCOMPARE(QString::fromStdString(sent.toString(decimals)), QString::fromStdString(value.toString(decimals)));
+}
+
+void Test_FixedPoint::convertDoubles()
+{
+	// Exact both ways for a double.
+	QCOMPARE(FixedPoint(0.125).toDouble(), 0.125);
+	QCOMPARE(FixedPoint(-1.5).toDouble(), -1.5);
+	QCOMPARE(FixedPoint(0.1).toDouble(), 0.1);
+	QCOMPARE(QString::fromStdString(FixedPoint(-0.25).toString(1)), QString("-0.3"));
+	QVERIFY(FixedPoint(0.0).isZero());
+	QVERIFY(FixedPoint(1e-30) != FixedPoint(0.0));
+	QVERIFY(FixedPoint(0.5) + FixedPoint(0.25) == FixedPoint(0.75));
+}
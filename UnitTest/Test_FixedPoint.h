@@ -0,0 +1,18 @@
+#include <QObject>
+
+
+namespace Mandelbrot
+{
+	namespace UnitTest
+	{
+		class Test_FixedPoint : public QObject
+		{
+			Q_OBJECT
+		private slots:
+			void parseDecimals();
+			void rejectMalformed();
+			void roundDecimals();
+			void convertDoubles();
+		};
+	}
+}
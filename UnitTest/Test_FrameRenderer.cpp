@@ -0,0 +1,58 @@
+#include <QTest>
+#include "FrameRenderer.h"
+#include "Test_FrameRenderer.h"
+
+
+using namespace Mandelbrot::UnitTest;
+using Mandelbrot::Common::FixedPoint;
+using Mandelbrot::Common::FrameRenderer;
+using Mandelbrot::Common::TilePool;
+
+namespace
+{
+	// The widget's default view.
+	const FrameRenderer::Geometry ShallowView = { FixedPoint(-0.637011), FixedPoint(-0.0395159), 0.004, 512, 384 };
+	const FrameRenderer::Fractal MandelbrotSet = { FrameRenderer::Family::Mandelbrot, 2, 0.0, 0.0 };
+}
+
+void Test_FrameRenderer::previewInFloat()
+{
+	QCOMPARE(FrameRenderer::precisionFor(ShallowView.scaleFactor, FrameRenderer::Family::Mandelbrot), FrameRenderer::Precision::Float);
+
+	FrameRenderer frame;
+	frame.setGeometry(ShallowView, MandelbrotSet);
+	QVERIFY(frame.renderPass(96, TilePool::Cancelled()));
+	QCOMPARE(frame.precision(), FrameRenderer::Precision::Float);
+	QVERIFY(frame.renderPass(288, TilePool::Cancelled()));
+	QCOMPARE(frame.precision(), FrameRenderer::Precision::Double);
+
+	// test case 1: a frame panned after its previews goes on in double
+	FrameRenderer::Geometry panned = ShallowView;
+	panned.centerX = FixedPoint(-0.637011 + (10 * ShallowView.scaleFactor));
+	frame.setGeometry(panned, MandelbrotSet);
+	QCOMPARE(frame.precision(), FrameRenderer::Precision::Double);
+}
+
+void Test_FrameRenderer::agreeAcrossTiers()
+{
+	// The passes of the widget, previewed in float, against a frame in double from the start.
+	FrameRenderer previewed;
+	previewed.setGeometry(ShallowView, MandelbrotSet);
+	for (int maxIterations : { 96, 288, 1056, 4128 })
+		QVERIFY(previewed.renderPass(maxIterations, TilePool::Cancelled()));
+	FrameRenderer exact;
+	exact.setGeometry(ShallowView, MandelbrotSet);
+	QVERIFY(exact.renderPass(4128, TilePool::Cancelled()));
+	QCOMPARE(exact.precision(), FrameRenderer::Precision::Double);
+
+	int flipped = 0;
+	int differing = 0;
+	for (int y = 0; y < ShallowView.height; ++y) {
+		for (int x = 0; x < ShallowView.width; ++x) {
+			flipped += (previewed.scanLine(y)[x] == FrameRenderer::Interior) != (exact.scanLine(y)[x] == FrameRenderer::Interior);
+			differing += previewed.smoothLine(y)[x] != exact.smoothLine(y)[x];
+		}
+	}
+	QCOMPARE(flipped, 0);
+	QCOMPARE(differing, 0);
+}
@@ -0,0 +1,16 @@
+#include <QObject>
+
+
+namespace Mandelbrot
+{
+	namespace UnitTest
+	{
+		class Test_FrameRenderer : public QObject
+		{
+			Q_OBJECT
+		private slots:
+			void previewInFloat();
+			void agreeAcrossTiers();
+		};
+	}
+}
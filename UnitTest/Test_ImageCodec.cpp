@@ -0,0 +1,69 @@
+#include <QString>
+#include <QTest>
+#include "ImageCodec.h"
+#include "Test_ImageCodec.h"
+
+
+using namespace Mandelbrot::UnitTest;
+using Mandelbrot::ComputationServer::ImageCodec;
+
+namespace
+{
+	bool negotiated(const char* accept, ImageCodec::Format expected)
+	{
+		ImageCodec::Format format = ImageCodec::Format::Jpeg;
+		return ImageCodec::negotiate(QString(accept), format) && format == expected;
+	}
+}
+
+void Test_ImageCodec::negotiateNamed()
+{
+	QVERIFY(negotiated("image/qoi", ImageCodec::Format::Qoi));
+	QVERIFY(negotiated("application/vnd.mandelbrot.rgb32", ImageCodec::Format::Raw));
+	QVERIFY(negotiated("image/png", ImageCodec::Format::Png));
+	QVERIFY(negotiated("image/jpeg", ImageCodec::Format::Jpeg));
+	QVERIFY(negotiated("text/plain", ImageCodec::Format::Base64Bmp));
+	// Case and spaces don't matter.
+	QVERIFY(negotiated(" IMAGE/PNG ; Q=0.7", ImageCodec::Format::Png));
+}
+
+void Test_ImageCodec::negotiateQualities()
+{
+	// test case 1: the highest quality wins
+	QVERIFY(negotiated("image/png, image/qoi;q=0.9", ImageCodec::Format::Png));
+	QVERIFY(negotiated("image/qoi;q=0.5, application/vnd.mandelbrot.rgb32", ImageCodec::Format::Raw));
+
+	// test case 2: between equal ones, the order of preference
+	QVERIFY(negotiated("image/jpeg;q=0.3, image/png;q=0.3", ImageCodec::Format::Png));
+	QVERIFY(negotiated("image/png, image/qoi, text/plain", ImageCodec::Format::Qoi));
+
+	// test case 3: an invalid quality refuses the format
+	QVERIFY(negotiated("image/qoi;q=abc, image/png;q=0.1", ImageCodec::Format::Png));
+}
+
+void Test_ImageCodec::negotiateWildcards()
+{
+	// test case 1: "image/*" picks the first image format not named
+	QVERIFY(negotiated("image/*", ImageCodec::Format::Qoi));
+	QVERIFY(negotiated("image/qoi;q=0, image/*", ImageCodec::Format::Png));
+	QVERIFY(negotiated("image/qoi;q=0, image/png;q=0, image/*;q=0.5", ImageCodec::Format::Jpeg));
+	QVERIFY(negotiated("image/*;q=0.8, text/plain", ImageCodec::Format::Base64Bmp));
+
+	// test case 2: "*/*" is the text, unless a format is named higher
+	QVERIFY(negotiated("*/*", ImageCodec::Format::Base64Bmp));
+	QVERIFY(negotiated("*/*;q=0.1, image/jpeg;q=0.2", ImageCodec::Format::Jpeg));
+}
+
+void Test_ImageCodec::negotiateOldClients()
+{
+	// test case 1: no header, or none of the formats, is the text of the clients before
+	QVERIFY(negotiated("", ImageCodec::Format::Base64Bmp));
+	QVERIFY(negotiated("text/html", ImageCodec::Format::Base64Bmp));
+	QVERIFY(negotiated("application/octet-stream", ImageCodec::Format::Base64Bmp));
+	QVERIFY(negotiated("image/png;q=0", ImageCodec::Format::Base64Bmp));
+
+	// test case 2: unless the text is refused
+	ImageCodec::Format format;
+	QVERIFY(!ImageCodec::negotiate(QStringLiteral("text/html, text/plain;q=0"), format));
+	QVERIFY(!ImageCodec::negotiate(QStringLiteral("text/html, */*;q=0"), format));
+}
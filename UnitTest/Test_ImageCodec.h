@@ -0,0 +1,18 @@
+#include <QObject>
+
+
+namespace Mandelbrot
+{
+	namespace UnitTest
+	{
+		class Test_ImageCodec : public QObject
+		{
+			Q_OBJECT
+		private slots:
+			void negotiateNamed();
+			void negotiateQualities();
+			void negotiateWildcards();
+			void negotiateOldClients();
+		};
+	}
+}
@@ -0,0 +1,49 @@
+#include <QTest>
+#include <cstddef>
+#include "OrbitDensity.h"
+#include "Test_OrbitDensity.h"
+
+
+using namespace Mandelbrot::UnitTest;
+using Mandelbrot::Common::FixedPoint;
+using Mandelbrot::Common::FrameRenderer;
+using Mandelbrot::Common::OrbitDensity;
+using Mandelbrot::Common::TilePool;
+
+namespace
+{
+	const FrameRenderer::Fractal MandelbrotSet = { FrameRenderer::Family::Mandelbrot, 2, 0.0, 0.0 };
+}
+
+void Test_OrbitDensity::chainPerWorker()
+{
+	// A 4K frame keeps every worker busy, its histograms within the budget.
+	OrbitDensity density;
+	density.setGeometry({ FixedPoint(-0.5), FixedPoint(0.0), 3.0 / 3840, 3840, 2160 }, MandelbrotSet);
+	QCOMPARE(density.chainCount(), TilePool::instance().threadCount());
+	QVERIFY(density.histogramCount() >= 1);
+	QVERIFY(density.histogramCount() <= density.chainCount());
+	QVERIFY(size_t(density.histogramCount()) * 3840 * 2160 * sizeof(float) <= OrbitDensity::MaxHistogramBytes);
+}
+
+void Test_OrbitDensity::keepEverySample()
+{
+	// Every sample held on a productive point adds up to one across its pixels, those of
+	// the splats flushed when the buffers fill up too.
+	const int width = 320;
+	const int height = 240;
+	OrbitDensity density;
+	density.setGeometry({ FixedPoint(-0.5), FixedPoint(0.0), 3.0 / width, width, height }, MandelbrotSet);
+	QVERIFY(density.accumulate(100000, 500, TilePool::Cancelled()));
+	QVERIFY(density.accumulate(100000, 500, TilePool::Cancelled()));
+	QCOMPARE(density.samples(), 200000LL);
+
+	double total = 0.0;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x)
+			total += density.densityLine(y)[x];
+	}
+	QVERIFY(density.peak() > 0.0f);
+	QVERIFY(total > 0.99 * 200000);
+	QVERIFY(total < 1.0001 * 200000);
+}
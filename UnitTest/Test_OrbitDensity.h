@@ -0,0 +1,16 @@
+#include <QObject>
+
+
+namespace Mandelbrot
+{
+	namespace UnitTest
+	{
+		class Test_OrbitDensity : public QObject
+		{
+			Q_OBJECT
+		private slots:
+			void chainPerWorker();
+			void keepEverySample();
+		};
+	}
+}
@@ -0,0 +1,138 @@
+#include <QTest>
+#include <cstdint>
+#include <vector>
+#include "PixelCodec.h"
+#include "Test_PixelCodec.h"
+
+
+using namespace Mandelbrot::UnitTest;
+using Mandelbrot::Common::PixelCodec;
+
+namespace
+{
+	// Encodes and decodes the pixels, the decoded rows with a stride of their own.
+	bool roundTrip(const std::vector<uint32_t>& pixels, int width, int height, size_t stride, size_t& encodedSize)
+	{
+		std::vector<uint8_t> encoded(PixelCodec::qoiBound(width, height));
+		encodedSize = PixelCodec::encodeQoi(pixels.data(), width, height, stride, encoded.data());
+		if (encodedSize > encoded.size())
+			return false;
+
+		int w = 0;
+		int h = 0;
+		if (!PixelCodec::readQoiHeader(encoded.data(), encodedSize, w, h) || w != width || h != height)
+			return false;
+
+		const size_t decodedStride = size_t(width) + 3;
+		std::vector<uint32_t> decoded(decodedStride * height, 0);
+		if (!PixelCodec::decodeQoi(encoded.data(), encodedSize, decoded.data(), decodedStride))
+			return false;
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				// The frames are opaque.
+				if (decoded[(y * decodedStride) + x] != (pixels[(y * stride) + x] | 0xff000000))
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+void Test_PixelCodec::readRawHeader()
+{
+	// test case 1: the header and the size of the rows it announces
+	std::vector<uint8_t> frame(PixelCodec::RawHeaderSize + (5 * 3 * 4));
+	PixelCodec::writeRawHeader(frame.data(), 4, 3, 5);
+	int width = 0;
+	int height = 0;
+	size_t stride = 0;
+	QVERIFY(PixelCodec::readRawHeader(frame.data(), frame.size(), width, height, stride));
+	QCOMPARE(width, 4);
+	QCOMPARE(height, 3);
+	QCOMPARE(stride, size_t(5));
+
+	// test case 2: rows missing, a stride narrower than the width, another magic
+	QVERIFY(!PixelCodec::readRawHeader(frame.data(), frame.size() - 1, width, height, stride));
+	PixelCodec::writeRawHeader(frame.data(), 6, 3, 5);
+	QVERIFY(!PixelCodec::readRawHeader(frame.data(), frame.size(), width, height, stride));
+	PixelCodec::writeRawHeader(frame.data(), 4, 3, 5);
+	frame[0] = 'X';
+	QVERIFY(!PixelCodec::readRawHeader(frame.data(), frame.size(), width, height, stride));
+}
+
+void Test_PixelCodec::roundTripQoi()
+{
+	// Every kind of chunk: small differences, luma ones, full colours, and the pixels
+	// seen before from the index.
+	const int width = 97;
+	const int height = 31;
+	std::vector<uint32_t> pixels(size_t(width) * height);
+	uint32_t seed = 12345;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			seed = (seed * 1103515245) + 12345;
+			uint32_t pixel;
+			switch (x % 4) {
+			case 0:
+				pixel = 0xff000000 | ((x * 3) << 16) | (y << 8) | (x + y);
+				break;
+			case 1:
+				pixel = 0xff000000 | ((x * 3 + 1) << 16) | ((y + 2) << 8) | (x + y - 1);
+				break;
+			case 2:
+				pixel = seed >> 8;
+				break;
+			default:
+				pixel = (x / 4) % 2 == 0 ? 0xff102030 : 0xffa0b0c0;
+				break;
+			}
+			pixels[(y * width) + x] = pixel;
+		}
+	}
+	size_t encodedSize = 0;
+	QVERIFY(roundTrip(pixels, width, height, width, encodedSize));
+}
+
+void Test_PixelCodec::roundTripQoiRuns()
+{
+	// Runs longer than a chunk holds, one ending the image.
+	const int width = 200;
+	const int height = 50;
+	std::vector<uint32_t> pixels(size_t(width) * height, 0xff336699);
+	for (int x = 0; x < width; x += 63)
+		pixels[(10 * width) + x] = 0xff000000;
+	size_t encodedSize = 0;
+	QVERIFY(roundTrip(pixels, width, height, width, encodedSize));
+	QVERIFY(encodedSize < size_t(width) * height / 32);
+}
+
+void Test_PixelCodec::roundTripQoiPadded()
+{
+	// The padding of the rows is not part of the image, nor is the alpha.
+	const int width = 13;
+	const int height = 7;
+	const size_t stride = 16;
+	std::vector<uint32_t> pixels(stride * height);
+	for (int y = 0; y < height; ++y) {
+		for (size_t x = 0; x < stride; ++x)
+			pixels[(y * stride) + x] = x < size_t(width) ? (uint32_t(y * 40) << 16) | uint32_t(x * 19) : 0x12345678;
+	}
+	size_t encodedSize = 0;
+	QVERIFY(roundTrip(pixels, width, height, stride, encodedSize));
+}
+
+void Test_PixelCodec::rejectTruncatedQoi()
+{
+	const int width = 16;
+	const int height = 16;
+	std::vector<uint32_t> pixels(size_t(width) * height);
+	for (size_t i = 0; i < pixels.size(); ++i)
+		pixels[i] = 0xff000000 | uint32_t(i * 2654435761u);
+	std::vector<uint8_t> encoded(PixelCodec::qoiBound(width, height));
+	const size_t encodedSize = PixelCodec::encodeQoi(pixels.data(), width, height, width, encoded.data());
+
+	std::vector<uint32_t> decoded(pixels.size());
+	QVERIFY(PixelCodec::decodeQoi(encoded.data(), encodedSize, decoded.data(), width));
+	QVERIFY(!PixelCodec::decodeQoi(encoded.data(), encodedSize / 2, decoded.data(), width));
+	QVERIFY(!PixelCodec::decodeQoi(encoded.data(), PixelCodec::QoiHeaderSize, decoded.data(), width));
+}
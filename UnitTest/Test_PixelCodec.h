@@ -0,0 +1,19 @@
+#include <QObject>
+
+
+namespace Mandelbrot
+{
+	namespace UnitTest
+	{
+		class Test_PixelCodec : public QObject
+		{
+			Q_OBJECT
+		private slots:
+			void readRawHeader();
+			void roundTripQoi();
+			void roundTripQoiRuns();
+			void roundTripQoiPadded();
+			void rejectTruncatedQoi();
+		};
+	}
+}
@@ -347,5 +347,3 @@ void Test_TcpIp::checkRegularExpression()
 	QVERIFY(listed7 == "NetworkSessionFailedError");
 	QVERIFY(listed8 == "NetworkSessionFailedError");
 }
-
-QTEST_MAIN(Test_TcpIp)
@@ -1,11 +1,24 @@
-QT += core network testlib
+QT += core gui network testlib
 
 VERSION = 1.0.0.0
 
-HEADERS = Test_TcpIp.h
+INCLUDEPATH += ../Common ../ComputationServer
 
-SOURCES = Test_TcpIp.cpp
+HEADERS = Test_TcpIp.h Test_FixedPoint.h Test_Connection.h Test_PixelCodec.h Test_ImageCodec.h Test_FrameRenderer.h Test_OrbitDensity.h \
+	../ComputationServer/Connection.h ../ComputationServer/HttpProtocol.h ../ComputationServer/ImageCodec.h \
+	../ComputationServer/ResponseWriter.h ../Common/DoubleDouble.h ../Common/EscapeTimeFormula.h ../Common/EscapeTimeKernel.h \
+	../Common/EscapeTimeKernelSimd.h ../Common/FixedPoint.h ../Common/FrameRenderer.h ../Common/OrbitDensity.h ../Common/PerturbationKernel.h \
+	../Common/PixelCodec.h ../Common/ReferenceOrbit.h ../Common/TilePool.h
+
+SOURCES = main.cpp Test_TcpIp.cpp Test_FixedPoint.cpp Test_Connection.cpp Test_PixelCodec.cpp Test_ImageCodec.cpp Test_FrameRenderer.cpp Test_OrbitDensity.cpp \
+	../ComputationServer/Connection.cpp ../ComputationServer/HttpProtocol.cpp ../ComputationServer/ImageCodec.cpp \
+	../ComputationServer/ResponseWriter.cpp ../Common/EscapeTimeKernel.cpp ../Common/EscapeTimeKernelSse2.cpp \
+	../Common/EscapeTimeKernelAvx2.cpp ../Common/EscapeTimeKernelAvx512.cpp ../Common/FixedPoint.cpp ../Common/FrameRenderer.cpp \
+	../Common/OrbitDensity.cpp ../Common/PerturbationKernel.cpp ../Common/PixelCodec.cpp ../Common/ReferenceOrbit.cpp ../Common/TilePool.cpp
+
+# The vectorized kernels must round like the scalar one, no fused multiply-add.
+gcc: QMAKE_CXXFLAGS += -ffp-contract=off
 
 # install
 target.path = ./UnitTest
-INSTALLS += target
\ No newline at end of file
+INSTALLS += target
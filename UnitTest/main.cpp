@@ -0,0 +1,35 @@
+#include <QCoreApplication>
+#include <QTest>
+#include "Test_Connection.h"
+#include "Test_FixedPoint.h"
+#include "Test_FrameRenderer.h"
+#include "Test_ImageCodec.h"
+#include "Test_OrbitDensity.h"
+#include "Test_PixelCodec.h"
+#include "Test_TcpIp.h"
+
+
+using namespace Mandelbrot::UnitTest;
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	// Each class on its own, a failure in one doesn't stop the others.
+	int status = 0;
+	Test_TcpIp tcpIp;
+	status |= QTest::qExec(&tcpIp, argc, argv);
+	Test_FixedPoint fixedPoint;
+	status |= QTest::qExec(&fixedPoint, argc, argv);
+	Test_Connection connection;
+	status |= QTest::qExec(&connection, argc, argv);
+	Test_PixelCodec pixelCodec;
+	status |= QTest::qExec(&pixelCodec, argc, argv);
+	Test_ImageCodec imageCodec;
+	status |= QTest::qExec(&imageCodec, argc, argv);
+	Test_FrameRenderer frameRenderer;
+	status |= QTest::qExec(&frameRenderer, argc, argv);
+	Test_OrbitDensity orbitDensity;
+	status |= QTest::qExec(&orbitDensity, argc, argv);
+	return status;
+}
@@ -0,0 +1,287 @@
+#include "BandWriter.h"
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+#include <QtGlobal>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <zlib.h>
+
+
+using namespace Mandelbrot::WidgetApp;
+
+namespace
+{
+	void appendLittleEndian(QByteArray& bytes, quint64 value, int size)
+	{
+		for (int i = 0; i < size; ++i)
+			bytes.append(char((value >> (8 * i)) & 0xff));
+	}
+
+	void appendBigEndian(QByteArray& bytes, quint32 value)
+	{
+		for (int i = 3; i >= 0; --i)
+			bytes.append(char((value >> (8 * i)) & 0xff));
+	}
+
+	// The rows as R, G, B bytes, each one after a byte of the given value unless it is negative.
+	void appendRgb(QByteArray& bytes, const uint32_t* pixels, int width, int rows, int rowPrefix)
+	{
+		for (int y = 0; y < rows; ++y) {
+			if (rowPrefix >= 0)
+				bytes.append(char(rowPrefix));
+			const uint32_t* line = pixels + ((size_t)y * width);
+			for (int x = 0; x < width; ++x) {
+				bytes.append(char((line[x] >> 16) & 0xff));
+				bytes.append(char((line[x] >> 8) & 0xff));
+				bytes.append(char(line[x] & 0xff));
+			}
+		}
+	}
+
+	// Baseline TIFF, or BigTIFF past 4 GB, with one deflated strip per band. The strips
+	// go first, their offsets and the directory at the end, where the header points.
+	class TiffWriter : public BandWriter
+	{
+	public:
+		bool open(const QString& path, int width, int height, int bandHeight) override
+		{
+			m_file.setFileName(path);
+			if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+				return false;
+
+			m_width = width;
+			m_height = height;
+			m_bandHeight = bandHeight;
+			m_big = qint64(width) * height * 3 > BigLimit;
+			QByteArray header("II");
+			if (m_big) {
+				appendLittleEndian(header, 43, 2);
+				appendLittleEndian(header, 8, 2);
+				appendLittleEndian(header, 0, 2);
+				appendLittleEndian(header, 0, 8);
+			}
+			else {
+				appendLittleEndian(header, 42, 2);
+				appendLittleEndian(header, 0, 4);
+			}
+			return m_file.write(header) == header.size();
+		}
+
+		bool write(const uint32_t* pixels, int rows) override
+		{
+			QByteArray raw;
+			raw.reserve(qsizetype(m_width) * rows * 3);
+			appendRgb(raw, pixels, m_width, rows, -1);
+			// qCompress puts the length in front of the zlib stream.
+			const QByteArray strip = qCompress(raw).mid(4);
+			m_offsets.push_back(quint64(m_file.pos()));
+			m_counts.push_back(quint64(strip.size()));
+			return m_file.write(strip) == strip.size();
+		}
+
+		bool close() override
+		{
+			const int offsetSize = m_big ? 8 : 4;
+			const quint16 valueType = m_big ? 16 : 4;
+			QByteArray offsets;
+			QByteArray counts;
+			for (size_t i = 0; i < m_offsets.size(); ++i) {
+				appendLittleEndian(offsets, m_offsets[i], offsetSize);
+				appendLittleEndian(counts, m_counts[i], offsetSize);
+			}
+			QByteArray bitsPerSample;
+			for (int i = 0; i < 3; ++i)
+				appendLittleEndian(bitsPerSample, 8, 2);
+
+			const std::array<Entry, 10> entries = { {
+				{ 256, 4, 1, number(m_width) },
+				{ 257, 4, 1, number(m_height) },
+				{ 258, 3, 3, bitsPerSample },
+				// Deflate, RGB.
+				{ 259, 3, 1, number(8, 2) },
+				{ 262, 3, 1, number(2, 2) },
+				{ 273, valueType, quint64(m_offsets.size()), offsets },
+				{ 277, 3, 1, number(3, 2) },
+				{ 278, 4, 1, number(m_bandHeight) },
+				{ 279, valueType, quint64(m_counts.size()), counts },
+				{ 284, 3, 1, number(1, 2) }
+			} };
+
+			// The values too long to be inline go before the directory, which is word aligned.
+			QByteArray tail;
+			const qint64 position = m_file.pos();
+			if (position % 2 != 0)
+				tail.append('\0');
+			std::array<quint64, 10> external{};
+			for (size_t i = 0; i < entries.size(); ++i) {
+				if (entries[i].value.size() > offsetSize) {
+					external[i] = quint64(position + tail.size());
+					tail.append(entries[i].value);
+					if ((position + tail.size()) % 2 != 0)
+						tail.append('\0');
+				}
+			}
+
+			const quint64 directory = quint64(position + tail.size());
+			appendLittleEndian(tail, entries.size(), m_big ? 8 : 2);
+			for (size_t i = 0; i < entries.size(); ++i) {
+				const Entry& entry = entries[i];
+				appendLittleEndian(tail, entry.tag, 2);
+				appendLittleEndian(tail, entry.type, 2);
+				appendLittleEndian(tail, entry.count, offsetSize);
+				if (entry.value.size() > offsetSize) {
+					appendLittleEndian(tail, external[i], offsetSize);
+				}
+				else {
+					tail.append(entry.value);
+					tail.append(QByteArray(offsetSize - entry.value.size(), '\0'));
+				}
+			}
+			appendLittleEndian(tail, 0, offsetSize);
+
+			QByteArray pointer;
+			appendLittleEndian(pointer, directory, offsetSize);
+			const bool written = m_file.write(tail) == tail.size() && m_file.seek(m_big ? 8 : 4)
+				&& m_file.write(pointer) == pointer.size();
+			m_file.close();
+			return written && m_file.error() == QFileDevice::NoError;
+		}
+
+	private:
+		struct Entry
+		{
+			quint16 tag;
+			quint16 type;
+			quint64 count;
+			QByteArray value;
+		};
+
+		static QByteArray number(quint64 value, int size = 4)
+		{
+			QByteArray bytes;
+			appendLittleEndian(bytes, value, size);
+			return bytes;
+		}
+
+		QFile m_file;
+		int m_width = 0;
+		int m_height = 0;
+		int m_bandHeight = 0;
+		bool m_big = false;
+		std::vector<quint64> m_offsets;
+		std::vector<quint64> m_counts;
+
+		// Room for the directory and for deflate expanding incompressible strips.
+		static constexpr qint64 BigLimit = 0xf0000000LL;
+	};
+
+	// A PNG deflated as one zlib stream, kept open across the bands: each band goes in
+	// as it comes and what comes out makes an IDAT chunk, so only a band is held at a time.
+	// The rows are left unfiltered, the bands of the palette deflate best as they are.
+	class PngWriter : public BandWriter
+	{
+	public:
+		~PngWriter() override
+		{
+			if (m_deflating)
+				deflateEnd(&m_stream);
+		}
+
+		bool open(const QString& path, int width, int height, int) override
+		{
+			m_file.setFileName(path);
+			if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+				return false;
+
+			m_width = width;
+			m_height = height;
+			m_rows = 0;
+			m_stream = z_stream();
+			if (deflateInit(&m_stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+				return false;
+			m_deflating = true;
+
+			QByteArray header;
+			appendBigEndian(header, quint32(width));
+			appendBigEndian(header, quint32(height));
+			// 8 bits per channel, RGB, deflate, no interlacing.
+			header.append(char(8));
+			header.append(char(2));
+			header.append(char(0));
+			header.append(char(0));
+			header.append(char(0));
+			static const char signature[] = { char(0x89), 'P', 'N', 'G', '\r', '\n', char(0x1a), '\n' };
+			return m_file.write(signature, sizeof(signature)) == qint64(sizeof(signature)) && writeChunk("IHDR", header);
+		}
+
+		bool write(const uint32_t* pixels, int rows) override
+		{
+			// Every row starts with filter type 0, none.
+			QByteArray raw;
+			raw.reserve(qsizetype(m_width * 3 + 1) * rows);
+			appendRgb(raw, pixels, m_width, rows, 0);
+			m_rows += rows;
+			const bool last = m_rows >= m_height;
+
+			m_stream.next_in = reinterpret_cast<Bytef*>(raw.data());
+			m_stream.avail_in = uInt(raw.size());
+			QByteArray data;
+			int status = Z_OK;
+			// Until the band is taken in, and for the last one until the stream ends.
+			while (status == Z_OK && (m_stream.avail_in > 0 || last)) {
+				const qsizetype used = data.size();
+				data.resize(used + OutputStep);
+				m_stream.next_out = reinterpret_cast<Bytef*>(data.data() + used);
+				m_stream.avail_out = uInt(OutputStep);
+				status = deflate(&m_stream, last ? Z_FINISH : Z_NO_FLUSH);
+				data.resize(used + OutputStep - qsizetype(m_stream.avail_out));
+			}
+			if (status != (last ? Z_STREAM_END : Z_OK))
+				return false;
+			return data.isEmpty() || writeChunk("IDAT", data);
+		}
+
+		bool close() override
+		{
+			const bool written = m_rows == m_height && writeChunk("IEND", QByteArray());
+			m_file.close();
+			return written && m_file.error() == QFileDevice::NoError;
+		}
+
+	private:
+		bool writeChunk(const char* type, const QByteArray& data)
+		{
+			QByteArray chunk;
+			appendBigEndian(chunk, quint32(data.size()));
+			chunk.append(type, 4);
+			chunk.append(data);
+			const uLong checksum = crc32(crc32(0, nullptr, 0), reinterpret_cast<const Bytef*>(chunk.constData() + 4),
+				uInt(chunk.size() - 4));
+			appendBigEndian(chunk, quint32(checksum));
+			return m_file.write(chunk) == chunk.size();
+		}
+
+		QFile m_file;
+		int m_width = 0;
+		int m_height = 0;
+		int m_rows = 0;
+		z_stream m_stream = z_stream();
+		bool m_deflating = false;
+
+		static constexpr qsizetype OutputStep = qsizetype(1) << 20;
+	};
+}
+
+std::unique_ptr<BandWriter> BandWriter::create(const QString& path)
+{
+	const QString name = path.toLower();
+	if (name.endsWith(QStringLiteral(".tif")) || name.endsWith(QStringLiteral(".tiff")))
+		return std::make_unique<TiffWriter>();
+	if (name.endsWith(QStringLiteral(".png")))
+		return std::make_unique<PngWriter>();
+	return nullptr;
+}
@@ -0,0 +1,33 @@
+#ifndef BANDWRITER_H
+#define BANDWRITER_H
+
+#include <QString>
+#include <cstdint>
+#include <memory>
+
+
+namespace Mandelbrot
+{
+	namespace WidgetApp
+	{
+		// An image file written band after band from the top, so no more than a band of it
+		// is ever in memory. RGB, 8 bits per channel, from the rows of a Format_RGB32 image.
+		class BandWriter
+		{
+		public:
+			virtual ~BandWriter() = default;
+
+			// All the bands but the last one have bandHeight rows.
+			virtual bool open(const QString& path, int width, int height, int bandHeight) = 0;
+			virtual bool write(const uint32_t* pixels, int rows) = 0;
+			// Completes the file once all of its rows have been written.
+			virtual bool close() = 0;
+
+			// A TIFF, deflated strip by strip, for a .tif or .tiff path, a PNG deflated as one
+			// stream for a .png one; null otherwise.
+			static std::unique_ptr<BandWriter> create(const QString& path);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,118 @@
+#include "BandWriter.h"
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
+#include "Palette.h"
+#include "Poster.h"
+#include "RenderThread.h"
+#include "TilePool.h"
+#include <QColor>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QString>
+#include <Qt>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <future>
+#include <memory>
+#include <vector>
+
+
+using namespace Mandelbrot::WidgetApp;
+using Mandelbrot::Common::FixedPoint;
+using Mandelbrot::Common::FrameRenderer;
+using Mandelbrot::Common::Palette;
+using Mandelbrot::Common::TilePool;
+
+Poster::Poster(const Settings& settings) :
+	m_settings(settings)
+{
+}
+
+bool Poster::run()
+{
+	const std::unique_ptr<BandWriter> writer = BandWriter::create(m_settings.path);
+	if (!writer) {
+		qWarning() << tr("Unsupported image format, .png or .tif expected:") << m_settings.path;
+		return false;
+	}
+
+	const int width = m_settings.width;
+	const int height = m_settings.height;
+	const double scaleFactor = m_settings.scaleFactor;
+	const int tileRows = (BandPixels + (width * FrameRenderer::TileSize) - 1) / (width * FrameRenderer::TileSize);
+	const int bandHeight = std::min(std::max(tileRows, 1) * FrameRenderer::TileSize, height);
+	if (!writer->open(m_settings.path, width, height, bandHeight)) {
+		qWarning() << tr("Can't write") << m_settings.path;
+		return false;
+	}
+
+	// Every band mirrors its rows around the real axis the same way, so the axis is put
+	// on a row or halfway between two for all of them.
+	FixedPoint centerY = m_settings.centerY;
+	const double axis = (height / 2) - (centerY.toDouble() / scaleFactor);
+	if (axis >= 0.0 && axis <= height - 1)
+		centerY = FixedPoint(((height / 2) - (std::round(2.0 * axis) / 2.0)) * scaleFactor);
+
+	const FrameRenderer::Fractal fractal{ FrameRenderer::Family::Mandelbrot, FrameRenderer::MinPower,
+		FrameRenderer::DefaultJuliaX, FrameRenderer::DefaultJuliaY };
+	const std::shared_ptr<const Palette> palette = Palette::find({ QColor(Qt::black).rgb(), ColormapSize, Palette::DefaultGamma });
+	const int bands = (height + bandHeight - 1) / bandHeight;
+
+	// A band is rendered and coloured on a thread of its own, its tiles share the pool with
+	// those of the other bands in flight.
+	struct Slot
+	{
+		FrameRenderer frame;
+		std::vector<uint32_t> buffer;
+		int rows = 0;
+		// Last, a slot is destroyed once its band is done.
+		std::future<void> rendered;
+	};
+	std::array<Slot, BandsInFlight> slots;
+	const auto start = [&](int band) {
+		Slot& slot = slots[band % BandsInFlight];
+		const int top = band * bandHeight;
+		slot.rows = std::min(bandHeight, height - top);
+		slot.rendered = std::async(std::launch::async, [&, top]() {
+			const FixedPoint bandCenterY = centerY + FixedPoint(double(top + (slot.rows / 2) - (height / 2)) * scaleFactor);
+			slot.frame.setGeometry({ m_settings.centerX, bandCenterY, scaleFactor, width, slot.rows }, fractal);
+			slot.frame.renderPass(m_settings.maxIterations, TilePool::Cancelled());
+			if (m_settings.antialiasSamples > 1)
+				slot.frame.antialias(m_settings.antialiasSamples, m_settings.maxIterations, TilePool::Cancelled());
+
+			slot.buffer.resize((size_t)width * slot.rows);
+			QImage image(reinterpret_cast<uchar*>(slot.buffer.data()), width, slot.rows, width * int(sizeof(uint32_t)),
+				QImage::Format_RGB32);
+			RenderThread::colorize(image, slot.frame, *palette);
+			});
+	};
+	for (int band = 0; band < std::min(bands, int(BandsInFlight)); ++band)
+		start(band);
+
+	// The bands are written in order, each while the next ones are rendered; its slot then
+	// takes the band BandsInFlight further.
+	bool written = true;
+	int reported = 0;
+	QElapsedTimer timer;
+	timer.start();
+	for (int band = 0; band < bands && written; ++band) {
+		Slot& slot = slots[band % BandsInFlight];
+		slot.rendered.get();
+		written = writer->write(slot.buffer.data(), slot.rows);
+		if (written && band + BandsInFlight < bands)
+			start(band + BandsInFlight);
+
+		const int percent = (100 * (band + 1)) / bands;
+		if (percent >= reported + 10 || band + 1 == bands) {
+			reported = percent;
+			qInfo().noquote() << tr("%1% of %2 x %3 in %4 s").arg(percent).arg(width).arg(height).arg(timer.elapsed() / 1000);
+		}
+	}
+
+	const bool completed = written && writer->close();
+	if (!completed)
+		qWarning() << tr("Can't write") << m_settings.path;
+	return completed;
+}
@@ -0,0 +1,55 @@
+#ifndef POSTER_H
+#define POSTER_H
+
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
+#include <QCoreApplication>
+#include <QString>
+
+
+namespace Mandelbrot
+{
+	namespace WidgetApp
+	{
+		// A frame far larger than memory rendered in batch to an image file, in horizontal
+		// bands from the top. BandsInFlight bands are rendered at once, their tiles sharing
+		// the threads, and written in order as they are done while the next ones render, so
+		// at most BandsInFlight bands are in memory, whatever the size of the image.
+		class Poster
+		{
+			Q_DECLARE_TR_FUNCTIONS(Poster)
+
+		public:
+			struct Settings
+			{
+				// A .png or a .tif file.
+				QString path;
+				Common::FixedPoint centerX;
+				Common::FixedPoint centerY;
+				double scaleFactor;
+				int width;
+				int height;
+				int maxIterations;
+				// Above 1 the edges are supersampled with up to this many points.
+				int antialiasSamples;
+			};
+
+			explicit Poster(const Settings& settings);
+
+			bool run();
+
+			static constexpr int DefaultSize = 16384;
+			static constexpr int DefaultMaxIterations = 4096;
+			// The pixels of a band, rounded up to whole rows of tiles.
+			static constexpr int BandPixels = 1 << 22;
+			static constexpr int BandsInFlight = 2;
+
+		private:
+			Settings m_settings;
+
+			static constexpr int ColormapSize = 512;
+		};
+	}
+}
+
+#endif
@@ -1,4 +1,10 @@
+#include "EscapeTimeKernel.h"
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
+#include "OrbitDensity.h"
+#include "Palette.h"
 #include "RenderThread.h"
+#include "TilePool.h"
 #include <QElapsedTimer>
 #include <QImage>
 #include <QMutexLocker>
@@ -7,11 +13,25 @@
 #include <QString>
 #include <QTextStream>
 #include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
 
 
 using namespace Mandelbrot::WidgetApp;
+using Mandelbrot::Common::EscapeTimeKernel;
+using Mandelbrot::Common::FixedPoint;
+using Mandelbrot::Common::FrameRenderer;
+using Mandelbrot::Common::OrbitDensity;
+using Mandelbrot::Common::Palette;
+using Mandelbrot::Common::TilePool;
 
 int RenderThread::numPasses = RenderThread::NumberPassesMin;
+double RenderThread::adaptiveTolerance = 0.0;
+int RenderThread::antialiasSamples = 0;
+int RenderThread::densityIterations = 0;
 
 RenderThread::RenderThread(QObject* parent)
 	: QThread(parent)
@@ -28,23 +48,32 @@ RenderThread::~RenderThread()
 	wait();
 }
 
-void RenderThread::render(double centerX, double centerY, double scaleFactor,
-	QSize resultSize, double devicePixelRatio, QRgb color)
+void RenderThread::render(const FixedPoint& centerX, const FixedPoint& centerY, double scaleFactor,
+	QSize resultSize, double devicePixelRatio, QRgb color, const FrameRenderer::Fractal& fractal)
 {
 	QMutexLocker locker(&m_mutex);
 
+	// Only the colours of the finished frame change: it is coloured again, not computed again.
+	const bool recolor = m_idle && centerX == this->m_centerX && centerY == this->m_centerY
+		&& scaleFactor == this->m_scaleFactor && devicePixelRatio == this->m_devicePixelRatio
+		&& resultSize == this->m_resultSize && fractal == this->m_fractal;
+
 	this->m_centerX = centerX;
 	this->m_centerY = centerY;
 	this->m_scaleFactor = scaleFactor;
 	this->m_devicePixelRatio = devicePixelRatio;
 	this->m_resultSize = resultSize;
 	this->m_baseColor = color;
+	this->m_fractal = fractal;
 
 	if (!isRunning()) {
 		start(LowPriority);
 	}
 	else {
-		m_restart = true;
+		if (recolor)
+			m_recolor = true;
+		else
+			m_restart = true;
 		m_condition.wakeOne();
 	}
 }
@@ -52,6 +81,9 @@ void RenderThread::render(double centerX, double centerY, double scaleFactor,
 void RenderThread::run()
 {
 	QElapsedTimer timer;
+	FrameRenderer frame;
+	OrbitDensity density;
+	const TilePool::Cancelled cancelled = [this]() { return m_restart || m_abort; };
 	forever{
 		m_mutex.lock();
 		const double devicePixelRatio = this->m_devicePixelRatio;
@@ -59,136 +91,216 @@ void RenderThread::run()
 		const QRgb resultBaseColor = this->m_baseColor;
 		const double requestedScaleFactor = this->m_scaleFactor;
 		const double scaleFactor = requestedScaleFactor / devicePixelRatio;
-		const double centerX = this->m_centerX;
-		const double centerY = this->m_centerY;
+		const FixedPoint centerX = this->m_centerX;
+		const FixedPoint centerY = this->m_centerY;
+		const FrameRenderer::Fractal fractal = this->m_fractal;
 		m_mutex.unlock();
 
-		const QColor c(resultBaseColor);
-		const int r = c.red();
-		const int g = c.green();
-		const int b = c.blue();
-
-		uint colormap[ColormapSize];
-		for (int i = 0; i < ColormapSize; ++i)
-			colormap[i] = rgbFromWaveLength(380.0 + (i * 400.0 / ColormapSize), r, g, b);
+		std::shared_ptr<const Palette> palette = Palette::find({ resultBaseColor, ColormapSize, Palette::DefaultGamma });
 
-		const int halfWidth = resultSize.width() / 2;
-		const int halfHeight = resultSize.height() / 2;
+		const int width = resultSize.width();
+		const int height = resultSize.height();
 		QImage image(resultSize, QImage::Format_RGB32);
 		image.setDevicePixelRatio(devicePixelRatio);
 
-		int pass = 0;
-		while (pass < numPasses) {
-			const int MaxIterations = (1 << (2 * pass + 6)) + 32;
-			constexpr int Limit = 4;
-			bool allBlack = true;
+		QString info;
+		const bool buddhabrot = densityIterations > 0;
+		if (buddhabrot) {
+			density.setGeometry({ centerX, centerY, scaleFactor, width, height }, fractal);
+			info = renderDensity(density, image, *palette, requestedScaleFactor, cancelled);
+			if (m_abort)
+				return;
+		}
+		else {
+			frame.setGeometry({ centerX, centerY, scaleFactor, width, height }, fractal);
 
-			timer.restart();
+			// Adaptive passes after the first one iterate only the tiles around the boundary.
+			const double tolerance = adaptiveTolerance;
+			const bool adaptive = tolerance > 0.0;
+			int estimatedIterations = FrameRenderer::MaxEstimatedIterations;
+			bool refine = true;
+
+			int pass = 0;
+			int lastIterations = 0;
+			bool finished = true;
+			while (adaptive ? refine : pass < numPasses) {
+				const int MaxIterations = std::min((1 << (2 * pass + 6)) + 32, estimatedIterations);
 
-			for (int y = -halfHeight; y < halfHeight; ++y) {
-				if (m_restart)
+				timer.restart();
+
+				if (!frame.renderPass(MaxIterations, cancelled, adaptive && pass > 0)) {
+					if (m_abort)
+						return;
+					finished = false;
 					break;
-				if (m_abort)
-					return;
+				}
+				lastIterations = MaxIterations;
 
-				auto scanLine =
-						reinterpret_cast<uint*>(image.scanLine(y + halfHeight));
-				const double ay = centerY + (y * scaleFactor);
-
-				for (int x = -halfWidth; x < halfWidth; ++x) {
-					const double ax = centerX + (x * scaleFactor);
-					double a1 = ax;
-					double b1 = ay;
-					int numIterations = 0;
-
-					do {
-						++numIterations;
-						const double a2 = (a1 * a1) - (b1 * b1) + ax;
-						const double b2 = (2 * a1 * b1) + ay;
-						if ((a2 * a2) + (b2 * b2) > Limit)
-							break;
-
-						++numIterations;
-						a1 = (a2 * a2) - (b2 * b2) + ax;
-						b1 = (2 * a2 * b2) + ay;
-						if ((a1 * a1) + (b1 * b1) > Limit)
-							break;
-					} while (numIterations < MaxIterations);
-
-					if (numIterations < MaxIterations) {
-						*scanLine++ = colormap[numIterations % ColormapSize];
-						allBlack = false;
-					}
-					else {
-						*scanLine++ = qRgb(0, 0, 0);
+				const bool allBlack = !colorize(image, frame, *palette);
+
+				if (adaptive) {
+					// The budget is estimated once the frame has escapes to go by.
+					if (estimatedIterations == FrameRenderer::MaxEstimatedIterations)
+						estimatedIterations = frame.estimateIterations(MaxIterations, tolerance);
+					if (pass > 0 && !allBlack && frame.changedPixels() < tolerance * width * height)
+						refine = false;
+					refine = refine && MaxIterations < estimatedIterations;
+				}
+
+				if (allBlack && pass == 0 && !adaptive) {
+					pass = 4;
+				}
+				else {
+					if (!m_restart) {
+						QString message;
+						QTextStream str(&message);
+						str << " Pass " << (pass + 1);
+						if (!adaptive)
+							str << '/' << numPasses;
+						str << ", max iterations: " << MaxIterations << ", time: ";
+						const auto elapsed = timer.elapsed();
+						if (elapsed > 2000)
+							str << (elapsed / 1000) << 's';
+						else
+							str << elapsed << "ms";
+						const double pixels = double(width) * height;
+						str << ", iterated: " << QString::number(100.0 * frame.iteratedPixels() / pixels, 'f', 1) << '%';
+						if (FrameRenderer::isSubdivision() || FrameRenderer::isSymmetry())
+							str << ", filled: " << QString::number(100.0 * frame.filledPixels() / pixels, 'f', 1) << '%';
+						if (adaptive)
+							str << ", changed: " << QString::number(100.0 * frame.changedPixels() / pixels, 'f', 2) << '%';
+						str << ", precision: " << FrameRenderer::name(frame.precision());
+						if (frame.referenceCount() > 0)
+							str << " (" << frame.referenceCount() << " reference(s))";
+						const double pixelsPerNsec = pixels / qMax<qint64>(timer.nsecsElapsed(), 1);
+						str << ", " << QString::number(pixelsPerNsec * 1000.0, 'f', 1) << " Mpx/s ("
+							<< EscapeTimeKernel::name(EscapeTimeKernel::instructionSet()) << " x "
+							<< TilePool::instance().threadCount() << " threads)";
+						image.setText(infoKey(), message);
+						info = message;
+
+						emit renderedImage(image, requestedScaleFactor);
 					}
+					++pass;
 				}
 			}
 
-			if (allBlack && pass == 0) {
-				pass = 4;
-			}
-			else {
-				if (!m_restart) {
-					QString message;
+			// The edges of the finished frame are sampled at the budget of its last pass.
+			if (finished && antialiasSamples > 1 && lastIterations > 0 && !m_restart) {
+				timer.restart();
+				if (frame.antialias(antialiasSamples, lastIterations, cancelled)) {
+					colorize(image, frame, *palette);
+					QString message = info;
 					QTextStream str(&message);
-					str << " Pass " << (pass + 1) << '/' << numPasses
-						<< ", max iterations: " << MaxIterations << ", time: ";
-					const auto elapsed = timer.elapsed();
-					if (elapsed > 2000)
-						str << (elapsed / 1000) << 's';
-					else
-						str << elapsed << "ms";
+					str << ", antialiased: " << QString::number(100.0 * frame.sampledPixelCount() / (double(width) * height), 'f', 1)
+						<< "% of pixels x " << frame.samplesPerPixel() << " samples in " << timer.elapsed() << "ms";
 					image.setText(infoKey(), message);
-
+					info = message;
 					emit renderedImage(image, requestedScaleFactor);
 				}
-				++pass;
+				else if (m_abort) {
+					return;
+				}
 			}
 		}
 
 		m_mutex.lock();
-		if (!m_restart)
-			m_condition.wait(&m_mutex);
+		for (;;) {
+			if (!m_restart && !m_recolor) {
+				m_idle = true;
+				m_condition.wait(&m_mutex);
+				m_idle = false;
+			}
+			if (m_restart || !m_recolor)
+				break;
+
+			m_recolor = false;
+			palette = Palette::find({ this->m_baseColor, ColormapSize, Palette::DefaultGamma });
+			m_mutex.unlock();
+
+			timer.restart();
+			if (buddhabrot)
+				colorize(image, density, *palette);
+			else
+				colorize(image, frame, *palette);
+			QString message = info;
+			QTextStream str(&message);
+			str << ", recolored in " << timer.elapsed() << "ms";
+			image.setText(infoKey(), message);
+			emit renderedImage(image, requestedScaleFactor);
+
+			m_mutex.lock();
+		}
 		m_restart = false;
 		m_mutex.unlock();
 	}
 }
 
-uint RenderThread::rgbFromWaveLength(double wave, double r, double g, double b)
+QString RenderThread::renderDensity(OrbitDensity& density, QImage& image, const Palette& palette,
+	double requestedScaleFactor, const TilePool::Cancelled& cancelled)
 {
-	if (wave >= 380.0 && wave <= 440.0) {
-		r = -1.0 * (wave - 440.0) / (440.0 - 380.0);
-		b = 1.0;
-	}
-	else if (wave >= 440.0 && wave <= 490.0) {
-		g = (wave - 440.0) / (490.0 - 440.0);
-		b = 1.0;
-	}
-	else if (wave >= 490.0 && wave <= 510.0) {
-		g = 1.0;
-		b = -1.0 * (wave - 510.0) / (510.0 - 490.0);
-	}
-	else if (wave >= 510.0 && wave <= 580.0) {
-		r = (wave - 510.0) / (580.0 - 510.0);
-		g = 1.0;
-	}
-	else if (wave >= 580.0 && wave <= 645.0) {
-		r = 1.0;
-		g = -1.0 * (wave - 645.0) / (645.0 - 580.0);
-	}
-	else if (wave >= 645.0 && wave <= 780.0) {
-		r = 1.0;
+	// Every pass samples as many points as the frame has pixels.
+	const FrameRenderer::Geometry& geometry = density.geometry();
+	const long long samples = (long long)geometry.width * geometry.height;
+	QElapsedTimer timer;
+	QString info;
+	for (int pass = 0; pass < DensityPasses; ++pass) {
+		timer.restart();
+		if (!density.accumulate(samples, densityIterations, cancelled) || m_restart)
+			break;
+
+		colorize(image, density, palette);
+		QString message;
+		QTextStream str(&message);
+		str << " Buddhabrot pass " << (pass + 1) << '/' << DensityPasses << ", max iterations: " << densityIterations
+			<< ", time: " << timer.elapsed() << "ms, samples: " << density.samples()
+			<< ", accepted: " << QString::number(100.0 * density.acceptance(), 'f', 1) << "% ("
+			<< TilePool::instance().threadCount() << " threads)";
+		image.setText(infoKey(), message);
+		info = message;
+		emit renderedImage(image, requestedScaleFactor);
 	}
+	return info;
+}
 
-	double s = 1.0;
-	if (wave > 700.0)
-		s = 0.3 + 0.7 * (780.0 - wave) / (780.0 - 700.0);
-	else if (wave < 420.0)
-		s = 0.3 + 0.7 * (wave - 380.0) / (420.0 - 380.0);
+bool RenderThread::colorize(QImage& image, const FrameRenderer& frame, const Palette& palette)
+{
+	// The rows are coloured in parallel, the image is detached before.
+	uchar* bits = image.bits();
+	const auto bytesPerLine = image.bytesPerLine();
+	const int width = image.width();
+	std::atomic<bool> escaped = false;
+	TilePool::instance().run(image.height(), [=, &frame, &palette, &escaped](int y) {
+		uint32_t* line = reinterpret_cast<uint32_t*>(bits + (y * bytesPerLine));
+		if (palette.colorize(frame.smoothLine(y), line, width))
+			escaped = true;
+		if (const float* distance = frame.distanceLine(y))
+			Palette::shade(distance, line, width);
+
+		// Supersampled pixels take the average colour of their samples.
+		const int* x;
+		const float* samples;
+		const float* distances;
+		const int sampled = frame.sampledPixels(y, x, samples, distances);
+		const int count = frame.samplesPerPixel();
+		for (int i = 0; i < sampled; ++i)
+			line[x[i]] = palette.average(samples + (i * count), distances ? distances + (i * count) : nullptr, count);
+		}, TilePool::Cancelled());
+	return escaped;
+}
 
-	r = std::pow(r * s, 0.8);
-	g = std::pow(g * s, 0.8);
-	b = std::pow(b * s, 0.8);
-	return qRgb(int(r * 255), int(g * 255), int(b * 255));
+void RenderThread::colorize(QImage& image, const OrbitDensity& density, const Palette& palette)
+{
+	// The square root of the density spreads over the palette, the pixels no orbit crossed are black.
+	uchar* bits = image.bits();
+	const auto bytesPerLine = image.bytesPerLine();
+	const int width = image.width();
+	const float peak = density.peak();
+	TilePool::instance().run(image.height(), [=, &density, &palette](int y) {
+		const float* line = density.densityLine(y);
+		std::vector<float> smooth(width);
+		for (int x = 0; x < width; ++x)
+			smooth[x] = line[x] > 0.0f ? (ColormapSize - 1) * std::sqrt(line[x] / peak) : -1.0f;
+		palette.colorize(smooth.data(), reinterpret_cast<uint32_t*>(bits + (y * bytesPerLine)), width);
+		}, TilePool::Cancelled());
 }
@@ -1,6 +1,11 @@
 #ifndef RENDERTHREAD_H
 #define RENDERTHREAD_H
 
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
+#include "OrbitDensity.h"
+#include "Palette.h"
+#include "TilePool.h"
 #include <QImage>
 #include <QMutex>
 #include <QObject>
@@ -8,6 +13,7 @@
 #include <QString>
 #include <QThread>
 #include <QWaitCondition>
+#include <atomic>
 
 
 namespace Mandelbrot
@@ -22,12 +28,23 @@ namespace Mandelbrot
 			RenderThread(QObject* parent = nullptr);
 			~RenderThread();
 
-			void render(double centerX, double centerY, double scaleFactor, QSize resultSize,
-				double devicePixelRatio, QRgb color);
+			void render(const Common::FixedPoint& centerX, const Common::FixedPoint& centerY,
+				double scaleFactor, QSize resultSize, double devicePixelRatio, QRgb color,
+				const Common::FrameRenderer::Fractal& fractal);
 
 			static void setNumPasses(int n) { numPasses = n; }
+			// Above 0 the passes go on while they change at least this fraction of the pixels,
+			// up to the budget estimated from the first one, instead of numPasses.
+			static void setAdaptiveTolerance(double tolerance) { adaptiveTolerance = tolerance; }
+			// Above 1 the edges of the finished frame are supersampled with up to this many points.
+			static void setAntialiasSamples(int samples) { antialiasSamples = samples; }
+			// Above 0 the frames are Buddhabrots of the orbits escaping within this budget,
+			// refined over DensityPasses passes.
+			static void setDensityIterations(int iterations) { densityIterations = iterations; }
 
 			static QString infoKey() { return QStringLiteral("info"); }
+			// Colours the frame into an image of its size, false if none of it escaped.
+			static bool colorize(QImage& image, const Common::FrameRenderer& frame, const Common::Palette& palette);
 
 		signals:
 			void renderedImage(const QImage& image, double scaleFactor);
@@ -36,22 +53,31 @@ namespace Mandelbrot
 			void run() override;
 
 		private:
-			static uint rgbFromWaveLength(double wave, double r, double g, double b);
+			QString renderDensity(Common::OrbitDensity& density, QImage& image, const Common::Palette& palette,
+				double requestedScaleFactor, const Common::TilePool::Cancelled& cancelled);
+			static void colorize(QImage& image, const Common::OrbitDensity& density, const Common::Palette& palette);
 
 			QMutex m_mutex;
 			QWaitCondition m_condition;
-			double m_centerX;
-			double m_centerY;
+			Common::FixedPoint m_centerX;
+			Common::FixedPoint m_centerY;
 			double m_scaleFactor;
 			double m_devicePixelRatio;
 			QSize m_resultSize;
 			QRgb m_baseColor;
+			Common::FrameRenderer::Fractal m_fractal;
 			static int numPasses;
-			bool m_restart = false;
-			bool m_abort = false;
+			static double adaptiveTolerance;
+			static int antialiasSamples;
+			static int densityIterations;
+			std::atomic<bool> m_restart = false;
+			std::atomic<bool> m_recolor = false;
+			bool m_idle = false;
+			std::atomic<bool> m_abort = false;
 
 			static constexpr int NumberPassesMin = 2;
 			static constexpr int ColormapSize = 512;
+			static constexpr int DensityPasses = 16;
 		};
 	}
 }
@@ -1,9 +1,16 @@
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
 #include "MouseHoverEater.h"
+#include "PixelCodec.h"
 #include "RenderThread.h"
+#include "TilePool.h"
 #include "Widget.h"
 #include <QBuffer>
+#include <QByteArray>
 #include <QColor>
+#include <QComboBox>
 #include <QDir>
+#include <QDoubleSpinBox>
 #include <QEvent>
 #include <QFile>
 #include <QFileDialog>
@@ -29,20 +36,28 @@
 #include <QPinchGesture>
 #include <QPixmap>
 #include <QPoint>
+#include <QPointF>
 #include <QPushButton>
 #include <QRectF>
 #include <QRegularExpression>
 #include <QResizeEvent>
 #include <QSlider>
+#include <QSpinBox>
 #include <QSslError>
 #include <QString>
 #include <Qt>
 #include <QTranslator>
 #include <QUrl>
 #include <QWidget>
+#include <cstdint>
+#include <cstring>
 
 
 using namespace Mandelbrot::WidgetApp;
+using Mandelbrot::Common::FixedPoint;
+using Mandelbrot::Common::FrameRenderer;
+using Mandelbrot::Common::PixelCodec;
+using Mandelbrot::Common::TilePool;
 
 constexpr double DefaultCenterX = -0.637011;
 constexpr double DefaultCenterY = -0.0395159;
@@ -57,6 +72,8 @@ constexpr int TilesCountMax = 8;
 
 bool Widget::serverUsage = false;
 const char* Widget::userAgent = "A Mandelbrot Set Testing App in Qt";
+// Lossless and quick both ways first, the base64 text of the older servers last.
+const char* Widget::accept = "image/qoi, application/vnd.mandelbrot.rgb32;q=0.9, image/png;q=0.8, text/plain;q=0.1";
 
 Widget::Widget(QWidget* parent) :
 	QWidget(parent),
@@ -67,6 +84,9 @@ Widget::Widget(QWidget* parent) :
 	m_curScale(DefaultScale),
 	m_color(Qt::black),
 	m_changedColor(Qt::black),
+	m_fractal{ FrameRenderer::Family::Mandelbrot, FrameRenderer::MinPower,
+		FrameRenderer::DefaultJuliaX, FrameRenderer::DefaultJuliaY },
+	m_changedFractal(m_fractal),
 	m_imagesDir("./"),
 	m_tiles(nullptr),
 	m_widgetOptions(nullptr),
@@ -146,6 +166,9 @@ void Widget::read(const QJsonObject& json)
 
 	if (json.contains("images_dir") && json["images_dir"].isString())
 		m_imagesDir = json["images_dir"].toString().trimmed();
+
+	if (json.contains("render_threads") && json["render_threads"].isDouble())
+		TilePool::setDefaultThreadCount(json["render_threads"].toInt());
 }
 
 void Widget::setChangedPixmapScale(double scale)
@@ -158,6 +181,11 @@ void Widget::setChangedColor(Qt::GlobalColor color)
 	m_changedColor = color;
 }
 
+void Widget::setChangedFractal(const FrameRenderer::Fractal& fractal)
+{
+	m_changedFractal = fractal;
+}
+
 bool Widget::isOptionsPane() const
 {
 	return m_optionsPane;
@@ -200,10 +228,11 @@ void Widget::handleMenu()
 
 	m_changedScale = m_curScale;
 	m_changedColor = m_color;
+	m_changedFractal = m_fractal;
 
 	m_widgetOptions = new QGroupBox("Options", this);
 	m_widgetOptions->setAutoFillBackground(true);
-	m_widgetOptions->setGeometry(QRect(QPoint(10, 55), QSize(200, 250)));
+	m_widgetOptions->setGeometry(QRect(QPoint(10, 55), QSize(200, 360)));
 	m_widgetOptions->setFocus();
 
 	QLabel* scaleTitle = new QLabel(m_widgetOptions);
@@ -298,6 +327,73 @@ void Widget::handleMenu()
 				});
 		}
 
+	QLabel* fractalTitle = new QLabel(m_widgetOptions);
+	fractalTitle->setText("Fractal:");
+	fractalTitle->setGeometry(QRect(QPoint(20, 180), QSize(150, 20)));
+
+	QComboBox* family = new QComboBox(m_widgetOptions);
+	family->setGeometry(QRect(QPoint(20, 200), QSize(160, 22)));
+	family->addItem("Mandelbrot", int(FrameRenderer::Family::Mandelbrot));
+	family->addItem("Julia", int(FrameRenderer::Family::Julia));
+	family->addItem("Burning Ship", int(FrameRenderer::Family::BurningShip));
+	family->addItem("Multibrot", int(FrameRenderer::Family::Multibrot));
+	family->setCurrentIndex(family->findData(int(m_changedFractal.family)));
+
+	QLabel* powerTitle = new QLabel(m_widgetOptions);
+	powerTitle->setText("Power:");
+	powerTitle->setGeometry(QRect(QPoint(20, 232), QSize(70, 20)));
+
+	QSpinBox* power = new QSpinBox(m_widgetOptions);
+	power->setGeometry(QRect(QPoint(100, 230), QSize(80, 22)));
+	power->setRange(FrameRenderer::MinPower, FrameRenderer::MaxPower);
+	power->setValue(m_changedFractal.power);
+
+	QLabel* juliaTitle = new QLabel(m_widgetOptions);
+	juliaTitle->setText("Julia c (re, im):");
+	juliaTitle->setGeometry(QRect(QPoint(20, 262), QSize(150, 20)));
+
+	QDoubleSpinBox* juliaX = new QDoubleSpinBox(m_widgetOptions);
+	juliaX->setGeometry(QRect(QPoint(20, 282), QSize(75, 22)));
+	QDoubleSpinBox* juliaY = new QDoubleSpinBox(m_widgetOptions);
+	juliaY->setGeometry(QRect(QPoint(105, 282), QSize(75, 22)));
+	for (QDoubleSpinBox* part : { juliaX, juliaY }) {
+		part->setRange(-2.0, 2.0);
+		part->setDecimals(4);
+		part->setSingleStep(0.01);
+	}
+	juliaX->setValue(m_changedFractal.juliaX);
+	juliaY->setValue(m_changedFractal.juliaY);
+
+	// Only the parameters of the chosen family are editable.
+	auto enableParameters = [power, juliaX, juliaY](FrameRenderer::Family value) {
+		power->setEnabled(value == FrameRenderer::Family::Multibrot);
+		juliaX->setEnabled(value == FrameRenderer::Family::Julia);
+		juliaY->setEnabled(value == FrameRenderer::Family::Julia);
+		};
+	enableParameters(m_changedFractal.family);
+
+	connect(family, &QComboBox::currentIndexChanged, [family, enableParameters, this](int index) {
+		FrameRenderer::Fractal fractal = m_changedFractal;
+		fractal.family = static_cast<FrameRenderer::Family>(family->itemData(index).toInt());
+		enableParameters(fractal.family);
+		this->setChangedFractal(fractal);
+		});
+	connect(power, &QSpinBox::valueChanged, [this](int value) {
+		FrameRenderer::Fractal fractal = m_changedFractal;
+		fractal.power = value;
+		this->setChangedFractal(fractal);
+		});
+	connect(juliaX, &QDoubleSpinBox::valueChanged, [this](double value) {
+		FrameRenderer::Fractal fractal = m_changedFractal;
+		fractal.juliaX = value;
+		this->setChangedFractal(fractal);
+		});
+	connect(juliaY, &QDoubleSpinBox::valueChanged, [this](double value) {
+		FrameRenderer::Fractal fractal = m_changedFractal;
+		fractal.juliaY = value;
+		this->setChangedFractal(fractal);
+		});
+
 	QPushButton* setUp = new QPushButton("Set Up", m_widgetOptions);
 	setUp->move(QPoint(m_widgetOptions->size().width() - 85 - 90, m_widgetOptions->size().height() - 35));
 	QPushButton* cancel = new QPushButton("Cancel", m_widgetOptions);
@@ -317,12 +413,18 @@ void Widget::handleSetUp()
 {
 	m_curScale = m_changedScale;
 	m_color = m_changedColor;
+	if (m_changedFractal.family != m_fractal.family) {
+		const QPointF center = defaultCenter(m_changedFractal.family);
+		m_centerX = FixedPoint(center.x());
+		m_centerY = FixedPoint(center.y());
+	}
+	m_fractal = m_changedFractal;
 
 	QRgb rgb = QColor(m_color).rgb();
 	if (Widget::isServerUsage())
-		sendRequestToRenderUnit(generateRequestUrl(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb));
+		sendRequestToRenderUnit(generateRequestUrl(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb, m_fractal));
 	else
-		m_thread.render(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb);
+		m_thread.render(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb, m_fractal);
 
 	freeUpOptionsPane();
 }
@@ -345,6 +447,20 @@ void Widget::freeUpOptionsPane()
 	m_widgetOptions = nullptr;
 }
 
+QPointF Widget::defaultCenter(FrameRenderer::Family family)
+{
+	// Each family is first shown whole at the default scale.
+	switch (family) {
+	case FrameRenderer::Family::Julia:
+	case FrameRenderer::Family::Multibrot:
+		return QPointF(0.0, 0.0);
+	case FrameRenderer::Family::BurningShip:
+		return QPointF(-0.5, -0.5);
+	default:
+		return QPointF(DefaultCenterX, DefaultCenterY);
+	}
+}
+
 void Widget::paintEvent(QPaintEvent* /* event */)
 {
 	QPainter painter(this);
@@ -416,9 +532,9 @@ void Widget::resizeEvent(QResizeEvent* /* event */)
 
 	QRgb rgb = QColor(m_color).rgb();
 	if (Widget::isServerUsage())
-		sendRequestToRenderUnit(generateRequestUrl(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb));
+		sendRequestToRenderUnit(generateRequestUrl(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb, m_fractal));
 	else
-		m_thread.render(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb);
+		m_thread.render(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb, m_fractal);
 }
 
 void Widget::keyPressEvent(QKeyEvent* event)
@@ -540,36 +656,44 @@ void Widget::zoom(double zoomFactor)
 	update();
 	QRgb rgb = QColor(m_color).rgb();
 	if (Widget::isServerUsage())
-		sendRequestToRenderUnit(generateRequestUrl(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb));
+		sendRequestToRenderUnit(generateRequestUrl(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb, m_fractal));
 	else
-		m_thread.render(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb);
+		m_thread.render(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb, m_fractal);
 }
 
 void Widget::scroll(int deltaX, int deltaY)
 {
-	m_centerX += deltaX * m_curScale;
-	m_centerY += deltaY * m_curScale;
+	m_centerX += FixedPoint(deltaX * m_curScale);
+	m_centerY += FixedPoint(deltaY * m_curScale);
 	update();
 	QRgb rgb = QColor(m_color).rgb();
 	if (Widget::isServerUsage())
-		sendRequestToRenderUnit(generateRequestUrl(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb));
+		sendRequestToRenderUnit(generateRequestUrl(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb, m_fractal));
 	else
-		m_thread.render(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb);
+		m_thread.render(m_centerX, m_centerY, m_curScale, size(), devicePixelRatio(), rgb, m_fractal);
 }
 
-QUrl Widget::generateRequestUrl(double centerX, double centerY, double scaleFactor,
-	QSize resultSize, double devicePixelRatio, QRgb color) const
+QUrl Widget::generateRequestUrl(const FixedPoint& centerX, const FixedPoint& centerY,
+	double scaleFactor, QSize resultSize, double devicePixelRatio, QRgb color,
+	const FrameRenderer::Fractal& fractal) const
 {
-	QString formatted = QString("http://%1:%2/?centerX=%3&centerY=%4&scaleFactor=%5&resultWidth=%6&resultHeight=%7&pixelRatio=%8&color=%9")
+	// Only as many decimals as the zoom depth needs, a deep zoom still runs to hundreds.
+	const int decimals = FixedPoint::decimalsFor(scaleFactor);
+	QString formatted = QString("http://%1:%2/?centerX=%3&centerY=%4&scaleFactor=%5&resultWidth=%6&resultHeight=%7&pixelRatio=%8&color=%9"
+		"&fractal=%10&power=%11&juliaX=%12&juliaY=%13")
 		.arg(m_host.toString())
 		.arg(m_port)
-		.arg(QString::number(centerX))
-		.arg(QString::number(centerY))
+		.arg(QString::fromStdString(centerX.toString(decimals)))
+		.arg(QString::fromStdString(centerY.toString(decimals)))
 		.arg(QString::number(scaleFactor))
 		.arg(resultSize.width())
 		.arg(resultSize.height())
 		.arg(QString::number(devicePixelRatio))
-		.arg(color);
+		.arg(color)
+		.arg(QString::fromLatin1(FrameRenderer::name(fractal.family)))
+		.arg(fractal.power)
+		.arg(QString::number(fractal.juliaX))
+		.arg(QString::number(fractal.juliaY));
 	return QUrl(formatted);
 }
 
@@ -578,8 +702,11 @@ void Widget::sendRequestToRenderUnit(QUrl url)
 	QNetworkRequest request;
 	request.setUrl(url);
 	request.setRawHeader("User-Agent", Widget::userAgent);
+	request.setRawHeader("Accept", Widget::accept);
 
+	// Aborting the request before would close its connection, its frame is dropped on arrival.
 	QNetworkReply* reply = m_manager->get(request);
+	m_pending = reply;
 	connect(reply, &QIODevice::readyRead, this, &Widget::receivedReadyRead);
 	connect(reply, &QNetworkReply::errorOccurred, this, &Widget::receivedError);
 	connect(reply, &QNetworkReply::sslErrors, this, &Widget::receivedSslErrors);
@@ -604,8 +731,14 @@ void Widget::receivedSslErrors(const QList<QSslError>&)
 
 void Widget::replyFinished(QNetworkReply* reply)
 {
+	// A frame scrolled past.
+	if (reply && reply != m_pending) {
+		reply->deleteLater();
+		return;
+	}
+
 	if (reply) {
-		const auto contentType = reply->header(QNetworkRequest::ContentTypeHeader);
+		const QByteArray contentType = reply->rawHeader("Content-Type").split(';').first().trimmed().toLower();
 		const auto eTag = reply->header(QNetworkRequest::ETagHeader);
 		const QString infoDefined(reply->rawHeader("Info"));
 		const QString scaleDefined(reply->rawHeader("Scale-Factor"));
@@ -613,8 +746,8 @@ void Widget::replyFinished(QNetworkReply* reply)
 		double scaleFactor(m_pixmapScale);
 		QImage image;
 
-		if (!contentType.isValid() || contentType != "text/plain") {
-			qDebug() << "Network Reply : Content-Type != text/plain";
+		if (contentType.isEmpty()) {
+			qDebug() << "Network Reply : A content type is missing.";
 			return;
 		}
 
@@ -638,11 +771,10 @@ void Widget::replyFinished(QNetworkReply* reply)
 		else
 			scaleFactor = scaleDefined.toDouble();
 
-		QByteArray arr = QByteArray::fromBase64(reply->readAll());
-		if (image.loadFromData(arr, "BMP"))
+		if (decodeImage(contentType, reply->readAll(), image))
 			updatePixmap(image, scaleFactor);
 		else
-			qDebug() << "Network Reply : An image loaded with an import error, a format BMP.";
+			qDebug() << "Network Reply : An image loaded with an import error, a format" << contentType;
 
 		connect(reply, &QObject::deleteLater, [reply]() mutable {
 			if (reply) {
@@ -654,3 +786,35 @@ void Widget::replyFinished(QNetworkReply* reply)
 			}});
 	}
 }
+
+bool Widget::decodeImage(const QByteArray& contentType, const QByteArray& body, QImage& image)
+{
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(body.constData());
+	const size_t size = size_t(body.size());
+	int width;
+	int height;
+	if (contentType == PixelCodec::QoiContentType) {
+		if (!PixelCodec::readQoiHeader(data, size, width, height))
+			return false;
+		image = QImage(width, height, QImage::Format_RGB32);
+		return !image.isNull()
+			&& PixelCodec::decodeQoi(data, size, reinterpret_cast<uint32_t*>(image.bits()), size_t(image.bytesPerLine()) / sizeof(uint32_t));
+	}
+	if (contentType == PixelCodec::RawContentType) {
+		size_t stride;
+		if (!PixelCodec::readRawHeader(data, size, width, height, stride))
+			return false;
+		image = QImage(width, height, QImage::Format_RGB32);
+		if (image.isNull())
+			return false;
+		for (int y = 0; y < height; ++y)
+			std::memcpy(image.scanLine(y), data + PixelCodec::RawHeaderSize + (y * stride * sizeof(uint32_t)), width * sizeof(uint32_t));
+		return true;
+	}
+	if (contentType == "image/png" || contentType == "image/jpeg")
+		return image.loadFromData(body);
+	// The servers before the binary bodies.
+	if (contentType == "text/plain")
+		return image.loadFromData(QByteArray::fromBase64(body), "BMP");
+	return false;
+}
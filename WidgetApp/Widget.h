@@ -2,6 +2,7 @@
 #define MANDELBROTWIDGET_H
 
 #include <QCoreApplication>
+#include <QByteArray>
 #include <QEvent>
 #include <QGestureEvent>
 #include <QGroupBox>
@@ -15,6 +16,8 @@
 #include <QPaintEvent>
 #include <QPixmap>
 #include <QPoint>
+#include <QPointF>
+#include <QPointer>
 #include <QPushButton>
 #include <QResizeEvent>
 #include <QSize>
@@ -25,6 +28,8 @@
 #include <QUrl>
 #include <QWheelEvent>
 #include <QWidget>
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
 #include "RenderThread.h"
 
 
@@ -45,6 +50,7 @@ namespace Mandelbrot
 
 			void setChangedPixmapScale(double scale);
 			void setChangedColor(Qt::GlobalColor color);
+			void setChangedFractal(const Common::FrameRenderer::Fractal& fractal);
 
 			bool isOptionsPane() const;
 			void setOptionsPane(bool status);
@@ -67,8 +73,9 @@ namespace Mandelbrot
 			bool event(QEvent* event) override;
 #endif
 			void sendRequestToRenderUnit(QUrl url);
-			QUrl generateRequestUrl(double centerX, double centerY, double scaleFactor,
-				QSize resultSize, double devicePixelRatio, QRgb color) const;
+			QUrl generateRequestUrl(const Common::FixedPoint& centerX, const Common::FixedPoint& centerY,
+				double scaleFactor, QSize resultSize, double devicePixelRatio, QRgb color,
+				const Common::FrameRenderer::Fractal& fractal) const;
 
 		private slots:
 			void handleButton();
@@ -89,14 +96,21 @@ namespace Mandelbrot
 			bool gestureEvent(QGestureEvent* event);
 #endif
 			void freeUpOptionsPane();
+			static QPointF defaultCenter(Common::FrameRenderer::Family family);
+			// From a body of the server, by its content type without parameters.
+			static bool decodeImage(const QByteArray& contentType, const QByteArray& body, QImage& image);
 
 			QNetworkAccessManager* m_manager;
+			// The request of the frame in view, the replies to the earlier ones are dropped.
+			QPointer<QNetworkReply> m_pending;
 			RenderThread m_thread;
 			QPixmap m_pixmap;
 			QPoint m_pixmapOffset;
 			QPoint m_lastDragPos;
 			Qt::GlobalColor m_color;
 			Qt::GlobalColor m_changedColor;
+			Common::FrameRenderer::Fractal m_fractal;
+			Common::FrameRenderer::Fractal m_changedFractal;
 			QPushButton* m_tiles;
 			QPushButton* m_menu;
 			QPushButton* m_button;
@@ -104,8 +118,8 @@ namespace Mandelbrot
 			QString m_imagesDir;
 			QString m_help;
 			QString m_info;
-			double m_centerX;
-			double m_centerY;
+			Common::FixedPoint m_centerX;
+			Common::FixedPoint m_centerY;
 			double m_pixmapScale;
 			double m_changedScale;
 			double m_curScale;
@@ -115,6 +129,7 @@ namespace Mandelbrot
 
 			static bool serverUsage;
 			static const char* userAgent;
+			static const char* accept;
 		};
 	}
 }
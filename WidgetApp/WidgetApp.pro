@@ -6,12 +6,27 @@ TEMPLATE = app
 
 VERSION = 1.0.0.0
 
-HEADERS = Widget.h MouseHoverEater.h RenderThread.h
+INCLUDEPATH += ../Common
 
-SOURCES = main.cpp Widget.cpp MouseHoverEater.cpp RenderThread.cpp
+HEADERS = Widget.h MouseHoverEater.h RenderThread.h ZoomVideo.h Poster.h BandWriter.h \
+	../Common/DoubleDouble.h ../Common/EscapeTimeFormula.h ../Common/EscapeTimeKernel.h ../Common/EscapeTimeKernelSimd.h ../Common/ExponentialMap.h \
+	../Common/FixedPoint.h ../Common/FrameRenderer.h ../Common/OrbitDensity.h ../Common/Palette.h ../Common/PerturbationKernel.h ../Common/PixelCodec.h \
+	../Common/ReferenceOrbit.h ../Common/TilePool.h
+
+SOURCES = main.cpp Widget.cpp MouseHoverEater.cpp RenderThread.cpp ZoomVideo.cpp Poster.cpp BandWriter.cpp \
+	../Common/EscapeTimeKernel.cpp ../Common/EscapeTimeKernelSse2.cpp ../Common/EscapeTimeKernelAvx2.cpp ../Common/EscapeTimeKernelAvx512.cpp ../Common/ExponentialMap.cpp \
+	../Common/FixedPoint.cpp ../Common/FrameRenderer.cpp ../Common/OrbitDensity.cpp \
+	../Common/Palette.cpp ../Common/PaletteSse2.cpp ../Common/PaletteAvx2.cpp ../Common/PerturbationKernel.cpp ../Common/PixelCodec.cpp \
+	../Common/ReferenceOrbit.cpp ../Common/TilePool.cpp
 
 CONFIG += debug
 
+# The posters' PNG stream is deflated across the bands.
+LIBS += -lz
+
+# The vectorized kernels must round like the scalar one, no fused multiply-add.
+gcc: QMAKE_CXXFLAGS += -ffp-contract=off
+
 # install
 target.path = ./WidgetApp
 INSTALLS += target
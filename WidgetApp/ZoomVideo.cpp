@@ -0,0 +1,78 @@
+#include "ExponentialMap.h"
+#include "FrameRenderer.h"
+#include "Palette.h"
+#include "TilePool.h"
+#include "ZoomVideo.h"
+#include <QColor>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QString>
+#include <Qt>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+
+using namespace Mandelbrot::WidgetApp;
+using Mandelbrot::Common::FrameRenderer;
+using Mandelbrot::Common::Palette;
+using Mandelbrot::Common::TilePool;
+
+ZoomVideo::ZoomVideo(const Settings& settings) :
+	m_settings(settings)
+{
+}
+
+bool ZoomVideo::run()
+{
+	const QDir directory(m_settings.directory);
+	if (!directory.mkpath(QStringLiteral("."))) {
+		qWarning() << tr("Can't create the directory") << m_settings.directory;
+		return false;
+	}
+
+	const int width = m_settings.size.width();
+	const int height = m_settings.size.height();
+	const double startScale = StartExtent / width;
+	const FrameRenderer::Fractal fractal{ FrameRenderer::Family::Mandelbrot, FrameRenderer::MinPower,
+		FrameRenderer::DefaultJuliaX, FrameRenderer::DefaultJuliaY };
+
+	QElapsedTimer timer;
+	timer.start();
+	m_map.setGeometry(m_settings.centerX, m_settings.centerY, startScale, m_settings.endScale, width, height, fractal);
+	m_map.render(m_settings.maxIterations, TilePool::Cancelled());
+	qInfo().noquote() << tr("Exponential map of %1 x %2 samples in %3 ms")
+		.arg(m_map.columns()).arg(m_map.rows()).arg(timer.elapsed());
+
+	// The frames are spaced evenly on the logarithm of the scale, a steady zoom.
+	timer.restart();
+	const std::shared_ptr<const Palette> palette = Palette::find({ QColor(Qt::black).rgb(), ColormapSize, Palette::DefaultGamma });
+	const int frames = m_settings.frames;
+	const double ratio = std::log(m_settings.endScale / startScale) / std::max(frames - 1, 1);
+	std::atomic<bool> failed = false;
+	TilePool::instance().run(frames, [this, &directory, &palette, &failed, width, height, startScale, ratio](int frame) {
+		if (failed)
+			return;
+
+		std::vector<float> smooth((size_t)width * height);
+		m_map.resample(startScale * std::exp(ratio * frame), smooth.data(), width);
+		QImage image(width, height, QImage::Format_RGB32);
+		for (int y = 0; y < height; ++y)
+			palette->colorize(smooth.data() + ((size_t)y * width), reinterpret_cast<uint32_t*>(image.scanLine(y)), width);
+
+		const QString name = directory.filePath(QStringLiteral("frame%1.png").arg(frame, 5, 10, QLatin1Char('0')));
+		if (!image.save(name, "PNG")) {
+			qWarning() << tr("Can't write") << name;
+			failed = true;
+		}
+		}, TilePool::Cancelled());
+	if (failed)
+		return false;
+
+	qInfo().noquote() << tr("%1 frames of %2 x %3 in %4 ms").arg(frames).arg(width).arg(height).arg(timer.elapsed());
+	return true;
+}
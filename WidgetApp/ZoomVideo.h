@@ -0,0 +1,55 @@
+#ifndef ZOOMVIDEO_H
+#define ZOOMVIDEO_H
+
+#include "ExponentialMap.h"
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
+#include <QCoreApplication>
+#include <QSize>
+#include <QString>
+
+
+namespace Mandelbrot
+{
+	namespace WidgetApp
+	{
+		// A zoom video rendered in batch, without the window: the exponential map of the whole
+		// zoom is iterated once, then every frame is resampled from it, in parallel, and
+		// written as a numbered PNG image.
+		class ZoomVideo
+		{
+			Q_DECLARE_TR_FUNCTIONS(ZoomVideo)
+
+		public:
+			struct Settings
+			{
+				QString directory;
+				Common::FixedPoint centerX;
+				Common::FixedPoint centerY;
+				// The pixel spacing of the last frame, the first one shows StartExtent across.
+				double endScale;
+				int frames;
+				QSize size;
+				int maxIterations;
+			};
+
+			explicit ZoomVideo(const Settings& settings);
+
+			// Writes frame00000.png and on to the directory, false on failure.
+			bool run();
+
+			static constexpr double StartExtent = 4.0;
+			static constexpr double DefaultEndScale = 1e-12;
+			static constexpr int DefaultFrames = 3000;
+			static constexpr int DefaultMaxIterations = 4096;
+
+		private:
+			Settings m_settings;
+			Common::ExponentialMap m_map;
+
+			static constexpr int ColormapSize = 512;
+		};
+	}
+}
+
+#endif
@@ -1,14 +1,67 @@
 #include <QApplication>
 #include <QCommandLineOption>
 #include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QIODevice>
+#include <QJsonDocument>
 #include <QJsonObject>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QSize>
 #include <QString>
+#include <QStringList>
+#include "EscapeTimeKernel.h"
+#include "FixedPoint.h"
+#include "FrameRenderer.h"
+#include "Poster.h"
+#include "RenderThread.h"
+#include "TilePool.h"
 #include "Widget.h"
+#include "ZoomVideo.h"
 
 
 using namespace Mandelbrot::WidgetApp;
+using Mandelbrot::Common::EscapeTimeKernel;
+using Mandelbrot::Common::FixedPoint;
+using Mandelbrot::Common::FrameRenderer;
+using Mandelbrot::Common::TilePool;
 using namespace Qt::Literals::StringLiterals;
 
+namespace
+{
+	// x,y in decimal notation, any number of digits.
+	bool parsePoint(const QString& text, FixedPoint& x, FixedPoint& y)
+	{
+		const QStringList parts = text.split(u',');
+		return parts.size() == 2 && FixedPoint::parse(parts[0].trimmed().toStdString(), x)
+			&& FixedPoint::parse(parts[1].trimmed().toStdString(), y);
+	}
+
+	// widthxheight, at least 2 x 2.
+	bool parseSize(const QString& text, int& width, int& height)
+	{
+		const QRegularExpressionMatch size = QRegularExpression(u"^(\\d+)x(\\d+)$"_s).match(text);
+		bool ok = size.hasMatch();
+		width = ok ? size.captured(1).toInt(&ok) : 0;
+		height = ok ? size.captured(2).toInt(&ok) : 0;
+		return ok && width >= 2 && height >= 2;
+	}
+
+	// The batch renders have no widget to read the config, they only take the pool's size.
+	bool readRenderThreads(const QString& path)
+	{
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly))
+			return false;
+
+		const QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+		if (json.contains("render_threads") && json["render_threads"].isDouble())
+			TilePool::setDefaultThreadCount(json["render_threads"].toInt());
+		return true;
+	}
+}
+
 int main(int argc, char* argv[])
 {
 	QApplication app(argc, argv);
@@ -21,6 +74,52 @@ int main(int argc, char* argv[])
 	parser.addOption(configOption);
 	QCommandLineOption serverOption(u"server"_s, u"Server data feed in use"_s, u"is_server"_s);
 	parser.addOption(serverOption);
+	QCommandLineOption simdOption(u"simd"_s, u"Kernel instruction set (scalar, sse2, avx2, avx512)"_s, u"set"_s);
+	parser.addOption(simdOption);
+	QCommandLineOption exactOption(u"exact"_s, u"Exact per-pixel rendering, no rectangle subdivision, mirrored rows or perturbation"_s);
+	parser.addOption(exactOption);
+	QCommandLineOption adaptiveOption(u"adaptive"_s,
+		u"Adaptive iteration budget, refining until a pass changes less than the fraction of pixels (0-1)"_s, u"fraction"_s);
+	parser.addOption(adaptiveOption);
+	QCommandLineOption antialiasOption(u"antialias"_s,
+		u"Supersample the edges of the finished frame with up to this many points per pixel (4-64)"_s, u"samples"_s);
+	parser.addOption(antialiasOption);
+	QCommandLineOption distanceOption(u"distance"_s,
+		u"Distance estimation, the boundary drawn from the derivatives of the orbits, except for the Burning Ship"_s);
+	parser.addOption(distanceOption);
+	QCommandLineOption buddhabrotOption(u"buddhabrot"_s,
+		u"Buddhabrot, the density of the orbits escaping within this many iterations, instead of the escape times"_s, u"iterations"_s);
+	parser.addOption(buddhabrotOption);
+	QCommandLineOption zoomVideoOption(u"zoom-video"_s,
+		u"Render a zoom video in batch, as numbered PNG frames written to the directory"_s, u"directory"_s);
+	parser.addOption(zoomVideoOption);
+	QCommandLineOption zoomTargetOption(u"zoom-target"_s, u"The point the video zooms to"_s, u"x,y"_s,
+		u"-0.743643887037158704752191506114774,0.131825904205311970493132056385139"_s);
+	parser.addOption(zoomTargetOption);
+	QCommandLineOption zoomScaleOption(u"zoom-scale"_s, u"The pixel spacing of the last frame of the video"_s, u"scale"_s,
+		QString::number(ZoomVideo::DefaultEndScale));
+	parser.addOption(zoomScaleOption);
+	QCommandLineOption zoomFramesOption(u"zoom-frames"_s, u"The number of frames of the video"_s, u"count"_s,
+		QString::number(ZoomVideo::DefaultFrames));
+	parser.addOption(zoomFramesOption);
+	QCommandLineOption zoomSizeOption(u"zoom-size"_s, u"The size of the frames of the video"_s, u"widthxheight"_s, u"1280x720"_s);
+	parser.addOption(zoomSizeOption);
+	QCommandLineOption zoomIterationsOption(u"zoom-iterations"_s, u"The iteration budget of the video"_s, u"iterations"_s,
+		QString::number(ZoomVideo::DefaultMaxIterations));
+	parser.addOption(zoomIterationsOption);
+	QCommandLineOption posterOption(u"poster"_s,
+		u"Render a poster in batch to a .png or .tif file, band by band in bounded memory"_s, u"file"_s);
+	parser.addOption(posterOption);
+	QCommandLineOption posterCenterOption(u"poster-center"_s, u"The centre of the poster"_s, u"x,y"_s, u"-0.75,0"_s);
+	parser.addOption(posterCenterOption);
+	QCommandLineOption posterScaleOption(u"poster-scale"_s, u"The pixel spacing of the poster, 3 across by default"_s, u"scale"_s);
+	parser.addOption(posterScaleOption);
+	QCommandLineOption posterSizeOption(u"poster-size"_s, u"The size of the poster"_s, u"widthxheight"_s,
+		u"%1x%1"_s.arg(Poster::DefaultSize));
+	parser.addOption(posterSizeOption);
+	QCommandLineOption posterIterationsOption(u"poster-iterations"_s, u"The iteration budget of the poster"_s, u"iterations"_s,
+		QString::number(Poster::DefaultMaxIterations));
+	parser.addOption(posterIterationsOption);
 	parser.process(app);
 
 	if (parser.isSet(serverOption)) {
@@ -34,6 +133,148 @@ int main(int argc, char* argv[])
 		Widget::setServerUsage(isServer);
 	}
 
+	if (parser.isSet(simdOption)) {
+		const auto simdStr = parser.value(simdOption).toLower();
+		EscapeTimeKernel::InstructionSet set;
+		if (!EscapeTimeKernel::fromName(simdStr.toUtf8().constData(), set)) {
+			qWarning() << "Invalid value:" << simdStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+		if (!EscapeTimeKernel::setInstructionSet(set)) {
+			qWarning() << "Unsupported by the CPU:" << simdStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (parser.isSet(exactOption)) {
+		FrameRenderer::setSubdivision(false);
+		FrameRenderer::setSymmetry(false);
+		FrameRenderer::setPerturbation(false);
+	}
+
+	if (parser.isSet(distanceOption))
+		FrameRenderer::setDistanceEstimation(true);
+
+	if (parser.isSet(adaptiveOption)) {
+		const auto adaptiveStr = parser.value(adaptiveOption);
+		bool ok;
+		const double tolerance = adaptiveStr.toDouble(&ok);
+		if (!ok || tolerance <= 0.0 || tolerance >= 1.0) {
+			qWarning() << "Invalid value:" << adaptiveStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+		RenderThread::setAdaptiveTolerance(tolerance);
+	}
+
+	int antialiasSamples = 0;
+	if (parser.isSet(antialiasOption)) {
+		const auto antialiasStr = parser.value(antialiasOption);
+		bool ok;
+		antialiasSamples = antialiasStr.toInt(&ok);
+		if (!ok || antialiasSamples < 4 || antialiasSamples > FrameRenderer::MaxSamples) {
+			qWarning() << "Invalid value:" << antialiasStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+		RenderThread::setAntialiasSamples(antialiasSamples);
+	}
+
+	if (parser.isSet(buddhabrotOption)) {
+		const auto buddhabrotStr = parser.value(buddhabrotOption);
+		bool ok;
+		const int iterations = buddhabrotStr.toInt(&ok);
+		if (!ok || iterations < 1) {
+			qWarning() << "Invalid value:" << buddhabrotStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+		RenderThread::setDensityIterations(iterations);
+	}
+
+	if ((parser.isSet(zoomVideoOption) || parser.isSet(posterOption)) && parser.isSet(configOption)
+		&& !readRenderThreads(parser.value(configOption))) {
+		qWarning() << "Can't open the config file" << parser.value(configOption);
+		return EXIT_FAILURE;
+	}
+
+	if (parser.isSet(zoomVideoOption)) {
+		ZoomVideo::Settings settings;
+		settings.directory = parser.value(zoomVideoOption);
+
+		const auto targetStr = parser.value(zoomTargetOption);
+		if (!parsePoint(targetStr, settings.centerX, settings.centerY)) {
+			qWarning() << "Invalid value:" << targetStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+
+		// Double-double is the deepest the exponential map goes.
+		const auto scaleStr = parser.value(zoomScaleOption);
+		bool ok;
+		settings.endScale = scaleStr.toDouble(&ok);
+		if (!ok || settings.endScale < FrameRenderer::DoubleDoubleScale || settings.endScale >= ZoomVideo::StartExtent) {
+			qWarning() << "Invalid value:" << scaleStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+
+		const auto framesStr = parser.value(zoomFramesOption);
+		settings.frames = framesStr.toInt(&ok);
+		if (!ok || settings.frames < 1) {
+			qWarning() << "Invalid value:" << framesStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+
+		const auto sizeStr = parser.value(zoomSizeOption);
+		int width;
+		int height;
+		if (!parseSize(sizeStr, width, height)) {
+			qWarning() << "Invalid value:" << sizeStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+		settings.size = QSize(width, height);
+
+		const auto iterationsStr = parser.value(zoomIterationsOption);
+		settings.maxIterations = iterationsStr.toInt(&ok);
+		if (!ok || settings.maxIterations < 1) {
+			qWarning() << "Invalid value:" << iterationsStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+
+		return ZoomVideo(settings).run() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (parser.isSet(posterOption)) {
+		Poster::Settings settings;
+		settings.path = parser.value(posterOption);
+		settings.antialiasSamples = antialiasSamples;
+
+		const auto centerStr = parser.value(posterCenterOption);
+		if (!parsePoint(centerStr, settings.centerX, settings.centerY)) {
+			qWarning() << "Invalid value:" << centerStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+
+		const auto sizeStr = parser.value(posterSizeOption);
+		if (!parseSize(sizeStr, settings.width, settings.height)) {
+			qWarning() << "Invalid value:" << sizeStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+
+		bool ok = true;
+		const auto scaleStr = parser.value(posterScaleOption);
+		settings.scaleFactor = parser.isSet(posterScaleOption) ? scaleStr.toDouble(&ok) : 3.0 / settings.width;
+		if (!ok || !(settings.scaleFactor > 0.0)) {
+			qWarning() << "Invalid value:" << scaleStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+
+		const auto iterationsStr = parser.value(posterIterationsOption);
+		settings.maxIterations = iterationsStr.toInt(&ok);
+		if (!ok || settings.maxIterations < 1) {
+			qWarning() << "Invalid value:" << iterationsStr.toUtf8().constData();
+			return EXIT_FAILURE;
+		}
+
+		return Poster(settings).run() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	Widget widget;
 	if (parser.isSet(configOption)) {
 		const auto cfgPath = parser.value(configOption);